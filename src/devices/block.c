@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+#ifdef USERPROG
+#include "threads/thread.h"
+#include "userprog/process.h"
+#endif
 
 /* A block device. */
 struct block {
@@ -114,6 +118,23 @@ static void check_sector(struct block* block, block_sector_t sector) {
   }
 }
 
+/* Counts READ_CNT sectors read from BLOCK against the running
+   thread, which tells page faults that waited for a disk apart
+   from those that did not, and, if BLOCK is the file system
+   device, charges them and WRITE_CNT sectors written to the
+   thread's process, for getrusage(). */
+static void charge(struct block* block UNUSED, size_t read_cnt UNUSED, size_t write_cnt UNUSED) {
+#ifdef USERPROG
+  struct thread* t = thread_current();
+
+  t->read_cnt += read_cnt;
+  if (t->pcb != NULL && block == block_by_role[BLOCK_FILESYS]) {
+    t->pcb->rusage.sectors_read += read_cnt;
+    t->pcb->rusage.sectors_written += write_cnt;
+  }
+#endif
+}
+
 /* Reads sector SECTOR from BLOCK into BUFFER, which must
    have room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to block devices, so external
@@ -122,6 +143,7 @@ void block_read(struct block* block, block_sector_t sector, void* buffer) {
   check_sector(block, sector);
   block->ops->read(block->aux, sector, buffer);
   block->read_cnt++;
+  charge(block, 1, 0);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -134,6 +156,52 @@ void block_write(struct block* block, block_sector_t sector, const void* buffer)
   ASSERT(block->type != BLOCK_FOREIGN);
   block->ops->write(block->aux, sector, buffer);
   block->write_cnt++;
+  charge(block, 0, 1);
+}
+
+/* Reads the CNT sectors starting at SECTOR from BLOCK, the Ith
+   of them into BUFFERS[I], which must have room for
+   BLOCK_SECTOR_SIZE bytes.  A driver that supports it does so
+   with a single request, which is much faster than CNT calls to
+   block_read().
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void block_readv(struct block* block, block_sector_t sector, size_t cnt, void* const buffers[]) {
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector(block, sector + cnt - 1);
+  if (block->ops->readv != NULL)
+    block->ops->readv(block->aux, sector, cnt, buffers);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->read(block->aux, sector + i, buffers[i]);
+  block->read_cnt += cnt;
+  charge(block, cnt, 0);
+}
+
+/* Writes the CNT sectors starting at SECTOR to BLOCK, the Ith of
+   them from BUFFERS[I], which must contain BLOCK_SECTOR_SIZE
+   bytes, as block_readv() reads them.  Returns after the block
+   device has acknowledged receiving all the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void block_writev(struct block* block, block_sector_t sector, size_t cnt,
+                  const void* const buffers[]) {
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector(block, sector + cnt - 1);
+  ASSERT(block->type != BLOCK_FOREIGN);
+  if (block->ops->writev != NULL)
+    block->ops->writev(block->aux, sector, cnt, buffers);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->write(block->aux, sector + i, buffers[i]);
+  block->write_cnt += cnt;
+  charge(block, 0, cnt);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -165,7 +233,7 @@ void block_print_stats(void) {
    will be passed AUX in each function call. */
 struct block* block_register(const char* name, enum block_type type, const char* extra_info,
                              block_sector_t size, const struct block_operations* ops, void* aux) {
-  struct block* block = malloc(sizeof *block);
+  struct block* block = malloc_tagged(sizeof *block, MT_DEVICES);
   if (block == NULL)
     PANIC("Failed to allocate memory for block device descriptor");
 
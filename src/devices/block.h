@@ -52,6 +52,8 @@ struct block* block_next(struct block*);
 block_sector_t block_size(struct block*);
 void block_read(struct block*, block_sector_t, void*);
 void block_write(struct block*, block_sector_t, const void*);
+void block_readv(struct block*, block_sector_t, size_t cnt, void* const buffers[]);
+void block_writev(struct block*, block_sector_t, size_t cnt, const void* const buffers[]);
 const char* block_name(struct block*);
 enum block_type block_type(struct block*);
 
@@ -63,6 +65,11 @@ void block_print_stats(void);
 struct block_operations {
   void (*read)(void* aux, block_sector_t, void* buffer);
   void (*write)(void* aux, block_sector_t, const void* buffer);
+
+  /* Optional: transfer CNT consecutive sectors, the Ith of them
+     to or from BUFFERS[I], as a single request. */
+  void (*readv)(void* aux, block_sector_t, size_t cnt, void* const buffers[]);
+  void (*writev)(void* aux, block_sector_t, size_t cnt, const void* const buffers[]);
 };
 
 struct block* block_register(const char* name, enum block_type, const char* extra_info,
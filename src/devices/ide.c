@@ -50,6 +50,9 @@
 #define CMD_READ_SECTOR_RETRY 0x20  /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
 
+/* Most sectors that one READ or WRITE SECTOR command can move. */
+#define MAX_CMD_SECTORS 256
+
 /* An ATA device. */
 struct ata_disk {
   char name[8];            /* Name, e.g. "hda". */
@@ -83,7 +86,7 @@ static void reset_channel(struct channel*);
 static bool check_device_type(struct ata_disk*);
 static void identify_ata_device(struct ata_disk*);
 
-static void select_sector(struct ata_disk*, block_sector_t);
+static void select_sector(struct ata_disk*, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel*, uint8_t command);
 static void input_sector(struct channel*, void*);
 static void output_sector(struct channel*, const void*);
@@ -314,7 +317,7 @@ static void ide_read(void* d_, block_sector_t sec_no, void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_READ_SECTOR_RETRY);
   sema_down(&c->completion_wait);
   if (!wait_while_busy(d))
@@ -332,7 +335,7 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy(d))
     PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
@@ -341,18 +344,67 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   lock_release(&c->lock);
 }
 
-static struct block_operations ide_operations = {ide_read, ide_write};
+/* Reads the CNT sectors starting at SEC_NO from disk D, the Ith
+   of them into BUFFERS[I].  Each command transfers up to
+   MAX_CMD_SECTORS sectors, raising one interrupt per sector, so
+   a run of sectors costs one command setup instead of one per
+   sector. */
+static void ide_readv(void* d_, block_sector_t sec_no, size_t cnt, void* const buffers[]) {
+  struct ata_disk* d = d_;
+  struct channel* c = d->channel;
+  size_t i;
+
+  lock_acquire(&c->lock);
+  for (i = 0; i < cnt; i++) {
+    if (i % MAX_CMD_SECTORS == 0) {
+      size_t n = cnt - i < MAX_CMD_SECTORS ? cnt - i : MAX_CMD_SECTORS;
+      select_sector(d, sec_no + i, n);
+      issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+    }
+    sema_down(&c->completion_wait);
+    if (!wait_while_busy(d))
+      PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no + i);
+    input_sector(c, buffers[i]);
+  }
+  lock_release(&c->lock);
+}
+
+/* Writes the CNT sectors starting at SEC_NO to disk D, the Ith
+   of them from BUFFERS[I], as ide_readv() reads them.  Returns
+   after the disk has acknowledged receiving all the data. */
+static void ide_writev(void* d_, block_sector_t sec_no, size_t cnt, const void* const buffers[]) {
+  struct ata_disk* d = d_;
+  struct channel* c = d->channel;
+  size_t i;
+
+  lock_acquire(&c->lock);
+  for (i = 0; i < cnt; i++) {
+    if (i % MAX_CMD_SECTORS == 0) {
+      size_t n = cnt - i < MAX_CMD_SECTORS ? cnt - i : MAX_CMD_SECTORS;
+      select_sector(d, sec_no + i, n);
+      issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+    }
+    if (!wait_while_busy(d))
+      PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no + i);
+    output_sector(c, buffers[i]);
+    sema_down(&c->completion_wait);
+  }
+  lock_release(&c->lock);
+}
+
+static struct block_operations ide_operations = {ide_read, ide_write, ide_readv, ide_writev};
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct ata_disk* d, block_sector_t sec_no) {
+   writes SEC_NO and the number of sectors to transfer, CNT, to
+   the disk's sector selection registers.  (We use LBA mode.) */
+static void select_sector(struct ata_disk* d, block_sector_t sec_no, size_t cnt) {
   struct channel* c = d->channel;
 
   ASSERT(sec_no < (1UL << 28));
+  ASSERT(cnt > 0 && cnt <= MAX_CMD_SECTORS);
 
   select_device_wait(d);
-  outb(reg_nsect(c), 1);
+  outb(reg_nsect(c), cnt); /* 0 means 256. */
   outb(reg_lbal(c), sec_no);
   outb(reg_lbam(c), sec_no >> 8);
   outb(reg_lbah(c), (sec_no >> 16));
@@ -72,7 +72,7 @@ static void read_partition_table(struct block* block, block_sector_t sector,
 
   /* Read sector. */
   ASSERT(sizeof *pt == BLOCK_SECTOR_SIZE);
-  pt = malloc(sizeof *pt);
+  pt = malloc_tagged(sizeof *pt, MT_DEVICES);
   if (pt == NULL)
     PANIC("Failed to allocate memory for partition table.");
   block_read(block, 0, pt);
@@ -149,7 +149,7 @@ static void found_partition(struct block* block, uint8_t part_type, block_sector
     char extra_info[128];
     char name[16];
 
-    p = malloc(sizeof *p);
+    p = malloc_tagged(sizeof *p, MT_DEVICES);
     if (p == NULL)
       PANIC("Failed to allocate memory for partition descriptor");
     p->block = block;
@@ -286,4 +286,20 @@ static void partition_write(void* p_, block_sector_t sector, const void* buffer)
   block_write(p->block, p->start + sector, buffer);
 }
 
-static struct block_operations partition_operations = {partition_read, partition_write};
+/* Reads CNT sectors starting at SECTOR from partition P, as
+   block_readv(). */
+static void partition_readv(void* p_, block_sector_t sector, size_t cnt, void* const buffers[]) {
+  struct partition* p = p_;
+  block_readv(p->block, p->start + sector, cnt, buffers);
+}
+
+/* Writes CNT sectors starting at SECTOR to partition P, as
+   block_writev(). */
+static void partition_writev(void* p_, block_sector_t sector, size_t cnt,
+                             const void* const buffers[]) {
+  struct partition* p = p_;
+  block_writev(p->block, p->start + sector, cnt, buffers);
+}
+
+static struct block_operations partition_operations = {partition_read, partition_write,
+                                                       partition_readv, partition_writev};
@@ -5,14 +5,22 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/memtag.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/process.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -116,6 +124,10 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
   timer_print_stats();
   thread_print_stats();
+  palloc_print_stats();
+  malloc_print_stats();
+  kmem_print_stats();
+  memtag_print_stats();
 #ifdef FILESYS
   block_print_stats();
 #endif
@@ -123,5 +135,9 @@ static void print_stats(void) {
   kbd_print_stats();
 #ifdef USERPROG
   exception_print_stats();
+  process_print_stats();
+#endif
+#ifdef VM
+  page_print_stats();
 #endif
 }
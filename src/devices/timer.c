@@ -126,9 +126,9 @@ void timer_ndelay(int64_t ns) { real_time_delay(ns, 1000 * 1000 * 1000); }
 void timer_print_stats(void) { printf("Timer: %" PRId64 " ticks\n", timer_ticks()); }
 
 /* Timer interrupt handler. */
-static void timer_interrupt(struct intr_frame* args UNUSED) {
+static void timer_interrupt(struct intr_frame* args) {
   ticks++;
-  thread_tick();
+  thread_tick((args->cs & 3) != 0); /* Interrupted ring 3? */
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -26,4 +26,12 @@ void timer_ndelay(int64_t nanoseconds);
 
 void timer_print_stats(void);
 
+/* Returns the processor's time-stamp counter, which counts CPU
+   cycles, for timing intervals much shorter than a tick. */
+static inline uint64_t timer_cycles(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
 #endif /* devices/timer.h */
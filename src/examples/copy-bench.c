@@ -0,0 +1,94 @@
+/* copy-bench.c
+
+   Compares copying a file with read() and write(), as cp does,
+   against copying it through memory mappings, as mcp does.
+   Writes a SIZE_KB kB file of pseudo-random bytes, runs
+   "cp" and "mcp" on it in turn, checks both copies, and prints
+   the rdtsc cycles that each copy took, including exec and exit.
+
+   cp and mcp must be on the file system too, e.g.
+     pintos --filesys-size=16 -p cp -p mcp -p copy-bench -- -q -f run copy-bench */
+
+#include <cycles.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define SIZE_KB 4096 /* Size of the file to copy. */
+#define BUF_SIZE 4096
+
+/* Creates file NAME filled with SIZE_KB kB of pseudo-random
+   bytes.  Returns false on failure. */
+static bool make_file(const char* name) {
+  static char buf[BUF_SIZE];
+  int fd, i;
+
+  if (!create(name, 0) || (fd = open(name)) < 0)
+    return false;
+  random_init(0);
+  for (i = 0; i < SIZE_KB * 1024 / BUF_SIZE; i++) {
+    random_bytes(buf, sizeof buf);
+    if (write(fd, buf, sizeof buf) != sizeof buf) {
+      close(fd);
+      return false;
+    }
+  }
+  close(fd);
+  return true;
+}
+
+/* Returns true if files A and B have the same contents. */
+static bool same_files(const char* a, const char* b) {
+  static char buf_a[BUF_SIZE], buf_b[BUF_SIZE];
+  int fd_a = open(a), fd_b = open(b);
+  bool same = fd_a >= 0 && fd_b >= 0 && filesize(fd_a) == filesize(fd_b);
+  int n;
+
+  while (same && (n = read(fd_a, buf_a, sizeof buf_a)) > 0)
+    same = read(fd_b, buf_b, n) == n && !memcmp(buf_a, buf_b, n);
+  close(fd_a);
+  close(fd_b);
+  return same;
+}
+
+/* Runs COPIER to copy "copy-bench.in" to DST and returns the
+   cycles it took, or 0 on failure. */
+static uint64_t time_copy(const char* copier, const char* dst) {
+  char cmd[64];
+  uint64_t start, cycles;
+  pid_t pid;
+
+  snprintf(cmd, sizeof cmd, "%s copy-bench.in %s", copier, dst);
+  start = cycle_count();
+  pid = exec(cmd);
+  if (pid == PID_ERROR || wait(pid) != 0)
+    return 0;
+  cycles = cycle_count() - start;
+  return same_files("copy-bench.in", dst) ? cycles : 0;
+}
+
+int main(void) {
+  uint64_t cp_cycles, mcp_cycles;
+
+  if (!make_file("copy-bench.in")) {
+    printf("copy-bench: cannot create copy-bench.in\n");
+    return 1;
+  }
+
+  cp_cycles = time_copy("cp", "copy-bench.cp");
+  mcp_cycles = time_copy("mcp", "copy-bench.mcp");
+  remove("copy-bench.in");
+  remove("copy-bench.cp");
+  remove("copy-bench.mcp");
+  if (cp_cycles == 0 || mcp_cycles == 0) {
+    printf("copy-bench: copy failed\n");
+    return 1;
+  }
+
+  printf("copy-bench: %d kB with cp:  %llu cycles\n", SIZE_KB, cp_cycles);
+  printf("copy-bench: %d kB with mcp: %llu cycles (%llu%% of cp)\n", SIZE_KB, mcp_cycles,
+         mcp_cycles * 100 / cp_cycles);
+  return 0;
+}
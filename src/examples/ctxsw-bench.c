@@ -0,0 +1,80 @@
+/* ctxsw-bench.c
+
+   Measures the cost of a context switch between two threads of
+   one process, which share an address space and so should keep
+   their TLB entries across the switch.  The threads play
+   ping-pong ITERATIONS times with a pair of semaphores, first
+   doing nothing else and then each touching TOUCH_PAGES pages
+   of a shared buffer on every turn, so that any TLB entries lost
+   in the switch have to be refilled.  Prints the rdtsc cycles
+   per switch of each run.
+
+   Run with
+     pintos -p ctxsw-bench -- -q -f run ctxsw-bench */
+
+#include <cycles.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+
+#define ITERATIONS 10000
+#define TOUCH_PAGES 32 /* Pages touched per turn in the second run. */
+#define PAGE_SIZE 4096
+
+static char buffer[TOUCH_PAGES * PAGE_SIZE];
+static sema_t ping, pong;
+static int touch_cnt; /* Pages to touch per turn. */
+
+/* Reads one byte from each of the first TOUCH_CNT pages of
+   BUFFER. */
+static void touch(void) {
+  volatile char* p = buffer;
+  int i;
+
+  for (i = 0; i < touch_cnt; i++)
+    (void)p[i * PAGE_SIZE];
+}
+
+static void player(void* aux UNUSED) {
+  for (int i = 0; i < ITERATIONS; i++) {
+    sema_down(&ping);
+    touch();
+    sema_up(&pong);
+  }
+}
+
+/* Plays ITERATIONS rounds of ping-pong, touching PAGES pages per
+   turn, and returns the average cycles per switch. */
+static uint64_t time_switches(int pages) {
+  uint64_t start, cycles;
+  tid_t tid;
+
+  touch_cnt = pages;
+  sema_init(&ping, 0);
+  sema_init(&pong, 0);
+  tid = pthread_create(player, NULL);
+  start = cycle_count();
+  for (int i = 0; i < ITERATIONS; i++) {
+    sema_up(&ping);
+    sema_down(&pong);
+    touch();
+  }
+  cycles = cycle_count() - start;
+  pthread_join(tid);
+  return cycles / (2 * ITERATIONS);
+}
+
+int main(void) {
+  uint64_t bare, touching;
+
+  /* Fault the buffer in, so that the runs measure only the TLB. */
+  for (int i = 0; i < TOUCH_PAGES; i++)
+    buffer[i * PAGE_SIZE] = 1;
+
+  bare = time_switches(0);
+  touching = time_switches(TOUCH_PAGES);
+  printf("ctxsw-bench: switch:                   %llu cycles\n", bare);
+  printf("ctxsw-bench: switch + %d page touches:  %llu cycles\n", TOUCH_PAGES, touching);
+  return EXIT_SUCCESS;
+}
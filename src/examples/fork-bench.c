@@ -0,0 +1,67 @@
+/* fork-bench.c
+
+   Compares starting a child process with fork() against starting
+   one with exec().  Runs ITERATIONS children each way, every one
+   of which exits at once, waits for each, and prints the average
+   rdtsc cycles from start to the parent's wait() returning.
+
+   Run with
+     pintos -p fork-bench -- -q -f run fork-bench */
+
+#include <cycles.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define ITERATIONS 32
+
+/* Returns the average cycles that fork(), exit(), and wait()
+   took, or 0 on failure. */
+static uint64_t time_fork(void) {
+  uint64_t start = cycle_count();
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) {
+    pid_t pid = fork();
+    if (pid == 0)
+      exit(0);
+    if (pid == PID_ERROR || wait(pid) != 0)
+      return 0;
+  }
+  return (cycle_count() - start) / ITERATIONS;
+}
+
+/* Returns the average cycles that exec() of this program as a
+   child that exits at once, exit(), and wait() took, or 0 on
+   failure. */
+static uint64_t time_exec(void) {
+  uint64_t start = cycle_count();
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) {
+    pid_t pid = exec("fork-bench child");
+    if (pid == PID_ERROR || wait(pid) != 0)
+      return 0;
+  }
+  return (cycle_count() - start) / ITERATIONS;
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t fork_cycles, exec_cycles;
+
+  if (argc > 1 && !strcmp(argv[1], "child"))
+    return 0;
+
+  fork_cycles = time_fork();
+  exec_cycles = time_exec();
+  if (fork_cycles == 0 || exec_cycles == 0) {
+    printf("fork-bench: child failed\n");
+    return 1;
+  }
+
+  printf("fork-bench: fork+exit: %llu cycles\n", fork_cycles);
+  printf("fork-bench: exec+exit: %llu cycles (fork takes %llu%% as long)\n", exec_cycles,
+         fork_cycles * 100 / exec_cycles);
+  return 0;
+}
@@ -0,0 +1,60 @@
+/* green-bench.c
+
+   Compares the cost of a context switch between two green
+   threads with that of a switch between two kernel threads.
+   Each pair plays ping-pong ITERATIONS times; the green pair
+   hands off with green_yield(), the kernel pair with a pair of
+   semaphores. */
+
+#include <cycles.h>
+#include <green.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+
+#define ITERATIONS 10000
+
+static char stacks[2][GREEN_STACK_SIZE] __attribute__((aligned(GREEN_STACK_SIZE)));
+
+static void green_player(void* aux UNUSED) {
+  for (int i = 0; i < ITERATIONS; i++)
+    green_yield();
+}
+
+static sema_t ping, pong;
+
+static void kernel_player(void* aux UNUSED) {
+  for (int i = 0; i < ITERATIONS; i++) {
+    sema_down(&ping);
+    sema_up(&pong);
+  }
+}
+
+int main(void) {
+  uint64_t start, green_cycles, kernel_cycles;
+  tid_t tid;
+
+  /* Green threads on a single worker: every yield is a switch. */
+  green_create(stacks[0], green_player, NULL);
+  green_create(stacks[1], green_player, NULL);
+  start = cycle_count();
+  green_run(1);
+  green_cycles = cycle_count() - start;
+
+  /* Kernel threads: each round trip blocks and wakes twice. */
+  sema_init(&ping, 0);
+  sema_init(&pong, 0);
+  tid = pthread_create(kernel_player, NULL);
+  start = cycle_count();
+  for (int i = 0; i < ITERATIONS; i++) {
+    sema_up(&ping);
+    sema_down(&pong);
+  }
+  kernel_cycles = cycle_count() - start;
+  pthread_join(tid);
+
+  printf("green switch:  %llu cycles\n", green_cycles / (2 * ITERATIONS));
+  printf("kernel switch: %llu cycles\n", kernel_cycles / (2 * ITERATIONS));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/* swap-bench.c
+
+   Measures swap throughput under the workload of the
+   page-merge-par test: about 1 MB of pseudo-random data is split
+   into CHUNK_CNT chunks, a child process sorts each chunk while
+   the others run, and the parent merges the sorted chunks.  The
+   children are this same program, run as "swap-bench sort FILE".
+
+   Run it with a swap disk and with user memory limited (e.g. by
+   -ul=128) so that the working set does not fit, and with
+   -zswap=0 to measure the device alone.  It prints the pages
+   moved to and from the swap device, the device requests that
+   moved them, the pages kept in compressed swap instead, and
+   the resulting throughput in MB/s. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define CHUNK_SIZE (128 * 1024)
+#define CHUNK_CNT 8                        /* Number of chunks. */
+#define DATA_SIZE (CHUNK_CNT * CHUNK_SIZE) /* Buffer size. */
+
+static unsigned char buf1[DATA_SIZE], buf2[DATA_SIZE];
+static size_t histogram[256];
+
+/* Sorts the bytes of file NAME in place with counting sort,
+   reading them into BUF1.  Returns 0 if successful. */
+static int sort_file(const char* name) {
+  int handle = open(name);
+  unsigned char* p = buf1;
+  int size;
+  size_t i;
+
+  if (handle < 0)
+    return 1;
+  size = read(handle, buf1, CHUNK_SIZE);
+  for (i = 0; i < (size_t)size; i++)
+    histogram[buf1[i]]++;
+  for (i = 0; i < sizeof histogram / sizeof *histogram; i++) {
+    size_t j = histogram[i];
+    while (j-- > 0)
+      *p++ = i;
+  }
+  seek(handle, 0);
+  write(handle, buf1, size);
+  close(handle);
+  return 0;
+}
+
+/* Sorts each chunk of BUF1 in a child process.  Returns false
+   on failure. */
+static bool sort_chunks(void) {
+  pid_t children[CHUNK_CNT];
+  char name[32], cmd[64];
+  size_t i;
+  int handle;
+
+  for (i = 0; i < CHUNK_CNT; i++) {
+    snprintf(name, sizeof name, "swap-bench.%zu", i);
+    if (!create(name, CHUNK_SIZE) || (handle = open(name)) < 0)
+      return false;
+    write(handle, buf1 + CHUNK_SIZE * i, CHUNK_SIZE);
+    close(handle);
+
+    snprintf(cmd, sizeof cmd, "swap-bench sort %s", name);
+    if ((children[i] = exec(cmd)) == PID_ERROR)
+      return false;
+  }
+
+  for (i = 0; i < CHUNK_CNT; i++) {
+    if (wait(children[i]) != 0)
+      return false;
+    snprintf(name, sizeof name, "swap-bench.%zu", i);
+    if ((handle = open(name)) < 0)
+      return false;
+    read(handle, buf1 + CHUNK_SIZE * i, CHUNK_SIZE);
+    close(handle);
+    remove(name);
+  }
+  return true;
+}
+
+/* Merges the sorted chunks in BUF1 into BUF2 and checks that the
+   result is sorted. */
+static bool merge(void) {
+  unsigned char* mp[CHUNK_CNT];
+  size_t mp_left = CHUNK_CNT;
+  size_t i;
+
+  for (i = 0; i < CHUNK_CNT; i++)
+    mp[i] = buf1 + CHUNK_SIZE * i;
+  for (i = 0; mp_left > 0; i++) {
+    size_t min = 0;
+    size_t j;
+
+    for (j = 1; j < mp_left; j++)
+      if (*mp[j] < *mp[min])
+        min = j;
+    buf2[i] = *mp[min];
+    if ((++mp[min] - buf1) % CHUNK_SIZE == 0)
+      mp[min] = mp[--mp_left];
+  }
+
+  for (i = 1; i < DATA_SIZE; i++)
+    if (buf2[i - 1] > buf2[i])
+      return false;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  struct swapstat before, after;
+  long long pages, ticks, rate;
+
+  if (argc == 3 && !strcmp(argv[1], "sort"))
+    return sort_file(argv[2]);
+
+  if (!swapstat(&before)) {
+    printf("swap-bench: no swap device\n");
+    return 1;
+  }
+
+  random_init(0);
+  random_bytes(buf1, sizeof buf1);
+  if (!sort_chunks() || !merge()) {
+    printf("swap-bench: sort failed\n");
+    return 1;
+  }
+
+  swapstat(&after);
+  pages = (after.pages_written - before.pages_written) + (after.pages_read - before.pages_read);
+  ticks = after.ticks - before.ticks;
+  printf("swap-bench: %lld pages written in %lld requests, %lld read in %lld requests\n",
+         after.pages_written - before.pages_written,
+         after.write_requests - before.write_requests, after.pages_read - before.pages_read,
+         after.read_requests - before.read_requests);
+
+  printf("swap-bench: %lld pages kept in compressed swap instead, %lld of them zeros\n",
+         after.zswap_stores - before.zswap_stores,
+         after.zswap_zero_stores - before.zswap_zero_stores);
+
+  /* Throughput in hundredths of a MB/s. */
+  rate = ticks > 0 ? pages * 4096 * 100 * after.ticks_per_sec / ticks / (1024 * 1024) : 0;
+  printf("swap-bench: %lld.%02lld MB/s over %lld ticks\n", rate / 100, rate % 100, ticks);
+  return 0;
+}
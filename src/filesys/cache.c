@@ -5,7 +5,7 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 struct cache_block {
@@ -22,31 +22,46 @@ struct cache_block {
 
 struct list cache;
 struct lock cache_lock;
+static struct kmem_cache cache_block_cache;
 
 struct cache_block* new_cache_block();
 struct cache_block* find_block_and_acq_lock(block_sector_t bst, bool reader);
 
+/* Constructs a freshly carved cache block.  Blocks go back to
+   the slab cache with their lock released. */
+static void cache_block_ctor(void* b_) {
+  struct cache_block* b = b_;
+  rw_lock_init_fair(&b->lock);
+}
+
 /* make a new cache block */
 struct cache_block* new_cache_block() {
-  struct cache_block* b = (struct cache_block*)calloc(sizeof(struct cache_block), 1);
+  struct cache_block* b = kmem_cache_alloc(&cache_block_cache);
+  ASSERT(b != NULL);
   b->is_dirty = false;
   b->is_valid = false;
-  rw_lock_init(&b->lock);
   b->hit_cnt = 0;
   b->miss_cnt = 0;
   return b;
 }
 
-/* initialize 64 blocks in cache and the cache lock */
-void cache_init() {
-  list_init(&cache);
-  lock_init(&cache_lock);
+/* put 64 fresh blocks in the cache */
+static void cache_fill(void) {
   for (int i = 0; i < 64; i++) {
     struct cache_block* b = new_cache_block();
     list_push_front(&cache, &b->elem);
   }
 }
 
+/* initialize 64 blocks in cache and the cache lock */
+void cache_init() {
+  kmem_cache_create(&cache_block_cache, "cache_block", MT_CACHE, sizeof(struct cache_block),
+                    cache_block_ctor);
+  list_init(&cache);
+  lock_init(&cache_lock);
+  cache_fill();
+}
+
 void cache_read(void* dest, block_sector_t bst) {
   struct cache_block* b = find_block_and_acq_lock(bst, true);
   memcpy(dest, b->content, BLOCK_SECTOR_SIZE);
@@ -106,6 +121,24 @@ struct cache_block* find_block_and_acq_lock(block_sector_t bst, bool reader) {
   return b;
 }
 
+/* Drops sector BST from the cache without writing it back,
+   because it has been freed and may be reused for file data,
+   which does not go through this cache. */
+void cache_discard(block_sector_t bst) {
+  lock_acquire(&cache_lock);
+  for (struct list_elem* e = list_begin(&cache); e != list_end(&cache); e = list_next(e)) {
+    struct cache_block* b = list_entry(e, struct cache_block, elem);
+    if (b->is_valid && b->bst == bst) {
+      rw_lock_acquire(&b->lock, false);
+      b->is_valid = false;
+      b->is_dirty = false;
+      rw_lock_release(&b->lock, false);
+      break;
+    }
+  }
+  lock_release(&cache_lock);
+}
+
 void cache_destroy() {
   while (!list_empty(&cache)) {
     struct list_elem* e = list_pop_front(&cache);
@@ -120,14 +153,15 @@ void cache_destroy() {
     // can release the lock before destroying the block because thread holds the cache lock,
     // so no other thread can access the destroying block
     rw_lock_release(&b->lock, false);
-    free(b);
+    kmem_cache_free(&cache_block_cache, b);
   }
 }
 
 void cache_reset() {
   lock_acquire(&cache_lock);
   cache_destroy();
-  cache_init();
+  cache_fill();
+  lock_release(&cache_lock);
 }
 
 unsigned int get_cache_hit_cnt() {
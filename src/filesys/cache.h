@@ -12,5 +12,6 @@ unsigned int get_cache_hit_cnt(void);
 unsigned int get_cache_miss_cnt(void);
 void cache_read(void* dest, block_sector_t bst);
 void cache_write(void* src, block_sector_t bst);
+void cache_discard(block_sector_t bst);
 
 #endif
\ No newline at end of file
@@ -206,7 +206,7 @@ bool dir_create(block_sector_t sector, size_t entry_cnt) {
 /* Opens and returns the directory for the given INODE, of which
    it takes ownership.  Returns a null pointer on failure. */
 struct dir* dir_open(struct inode* inode) {
-  struct dir* dir = calloc(1, sizeof *dir);
+  struct dir* dir = calloc_tagged(1, sizeof *dir, MT_FILE);
   if (inode != NULL && dir != NULL) {
     dir->inode = inode;
     dir->pos = 0;
@@ -4,6 +4,7 @@
 #include "filesys/off_t.h"
 #include <list.h>
 #include "devices/block.h"
+#include "threads/rcu.h"
 
 struct inode;
 
@@ -12,11 +13,13 @@ struct file_descriptor {
   int fd;            /* File descriptor */
   struct file* file; /* File description */
   struct dir* dir;
-  struct list_elem elem;
-  bool is_directory; /* file or directory (for proj3 task3) */
+  bool is_directory;   /* file or directory (for proj3 task3) */
+  int ref_cnt;         /* The table's reference, plus one per lookup */
+  struct rcu_head rcu; /* Deferred free after close */
 };
 
 /* Opening and closing files. */
+void file_init(void);
 struct file* file_open(struct inode*);
 struct file* file_reopen(struct file*);
 void file_close(struct file*);
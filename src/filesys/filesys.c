@@ -6,9 +6,11 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "threads/memtag.h"
 #include "threads/thread.h"
 #include "userprog/process.h"
 #include "filesys/cache.h"
+#include "filesys/page-cache.h"
 
 /* Partition that contains the file system. */
 struct block* fs_device;
@@ -26,9 +28,11 @@ void filesys_init(bool format) {
   if (fs_device == NULL)
     PANIC("No file system device found, can't initialize file system.");
 
+  file_init();
   inode_init();
   free_map_init();
   cache_init();
+  page_cache_init();
 
   if (format)
     do_format();
@@ -38,10 +42,13 @@ void filesys_init(bool format) {
 }
 
 /* Shuts down the file system module, writing any unwritten data
-   to disk. */
+   to disk, and reports memory that should have been freed by
+   now. */
 void filesys_done(void) {
-  cache_destroy();
+  page_cache_done();
   free_map_close();
+  cache_destroy();
+  memtag_print_leaks();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -38,7 +38,7 @@ void fsutil_cat(char** argv) {
   file = filesys_open(file_name, NULL);
   if (file == NULL)
     PANIC("%s: open failed", file_name);
-  buffer = palloc_get_page(PAL_ASSERT);
+  buffer = palloc_get_page(PAL_ASSERT | PAL_TAG(MT_FILE));
   for (;;) {
     off_t pos = file_tell(file);
     off_t n = file_read(file, buffer, PGSIZE);
@@ -69,8 +69,8 @@ void fsutil_extract(char** argv UNUSED) {
   void *header, *data;
 
   /* Allocate buffers. */
-  header = malloc(BLOCK_SECTOR_SIZE);
-  data = malloc(BLOCK_SECTOR_SIZE);
+  header = malloc_tagged(BLOCK_SECTOR_SIZE, MT_FILE);
+  data = malloc_tagged(BLOCK_SECTOR_SIZE, MT_FILE);
   if (header == NULL || data == NULL)
     PANIC("couldn't allocate buffers");
 
@@ -158,7 +158,7 @@ void fsutil_append(char** argv) {
   printf("Appending '%s' to ustar archive on scratch device...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc(BLOCK_SECTOR_SIZE);
+  buffer = malloc_tagged(BLOCK_SECTOR_SIZE, MT_FILE);
   if (buffer == NULL)
     PANIC("couldn't allocate buffer");
 
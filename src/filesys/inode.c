@@ -5,9 +5,14 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "filesys/cache.h"
+#include "filesys/page-cache.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -55,6 +60,7 @@ struct inode {
   bool removed;           /* True if deleted, false otherwise. */
   int deny_write_cnt;     /* 0: writes ok, >0: deny writes. */
   struct lock inode_lock; /* Lock for each inode struct. */
+  struct rcu_head rcu;    /* Deferred free after last close. */
 };
 
 /* helper for proj3 task3 */
@@ -63,20 +69,11 @@ int get_open_cnt(struct inode* inode) { return inode->open_cnt; }
 int get_bst(struct inode* inode) { return inode->sector; }
 
 /* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
-static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
-  ASSERT(inode != NULL);
-  // Get inode on disk
-  struct inode_disk* inode_content = calloc(BLOCK_SECTOR_SIZE, 1);
-  if (inode_content == NULL) {
-    free(inode_content);
-    return -1;
-  }
-  cache_read((void*)inode_content, inode->sector);
+   within the file whose on-disk inode is INODE_CONTENT.
+   Returns -1 if the file does not contain data for a byte at
+   offset POS. */
+static block_sector_t disk_byte_to_sector(const struct inode_disk* inode_content, off_t pos) {
   if (pos >= inode_content->length) {
-    free(inode_content);
     return -1;
   }
 
@@ -86,7 +83,6 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
   if (sector_num <= DIR_NUM) {
     // The targeted sector is under direct pointer
     block_sector_t result = inode_content->direct[sector_num - 1];
-    free(inode_content);
     if (result == 0) {
       return -1;
     } else {
@@ -95,14 +91,13 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
   } else if (sector_num <= MAX_WITHOUT_D_INDIR) {
     // The targeted sector is under indirect pointer
     sector_num -= DIR_NUM;
-    block_sector_t* indir_content = calloc(BLOCK_SECTOR_SIZE, 1);
+    block_sector_t* indir_content = calloc_tagged(BLOCK_SECTOR_SIZE, 1, MT_INODE);
     if (indir_content == NULL) {
       return -1;
     }
     cache_read((void*)indir_content, inode_content->indirect);
     block_sector_t result = indir_content[sector_num - 1];
     free(indir_content);
-    free(inode_content);
     if (result == 0) {
       return -1;
     } else {
@@ -112,16 +107,20 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
     // The targeted sector is under doubly indirect pointer
     sector_num -= MAX_WITHOUT_D_INDIR;
     // Read first level indirect pointer
-    block_sector_t* indir_content = calloc(BLOCK_SECTOR_SIZE, 1);
+    block_sector_t* indir_content = calloc_tagged(BLOCK_SECTOR_SIZE, 1, MT_INODE);
+    block_sector_t* indir2_content = calloc_tagged(BLOCK_SECTOR_SIZE, 1, MT_INODE);
+    if (indir_content == NULL || indir2_content == NULL) {
+      free(indir_content);
+      free(indir2_content);
+      return -1;
+    }
     cache_read((void*)indir_content, inode_content->indirect_double);
 
     // Read second level indirect pointer
-    block_sector_t* indir2_content = calloc(BLOCK_SECTOR_SIZE, 1);
     cache_read((void*)indir2_content,
                indir_content[(sector_num - 1) / INUMBER_PER_BLOCK]); // Start from 0, no need to + 1
 
     block_sector_t result = indir2_content[(sector_num - 1) % INUMBER_PER_BLOCK];
-    free(inode_content);
     free(indir_content);
     free(indir2_content);
     if (result == 0) {
@@ -132,22 +131,108 @@ static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
   }
 }
 
+/* Data sectors in a page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Finds the data sectors of page INDEX of the file whose inode
+   is in sector INUMBER, stores them in SECTORS, and returns how
+   many of them are within the file.  Stores the file's length in
+   *LENGTH. */
+static size_t page_to_sectors(block_sector_t inumber, size_t index,
+                              block_sector_t sectors[SECTORS_PER_PAGE], off_t* length) {
+  struct inode_disk* ind_d = calloc_tagged(BLOCK_SECTOR_SIZE, 1, MT_INODE);
+  size_t cnt = 0;
+
+  *length = 0;
+  if (ind_d == NULL) {
+    return 0;
+  }
+  cache_read(ind_d, inumber);
+  *length = ind_d->length;
+  for (; cnt < SECTORS_PER_PAGE; cnt++) {
+    sectors[cnt] = disk_byte_to_sector(ind_d, index * PGSIZE + cnt * BLOCK_SECTOR_SIZE);
+    if ((int)sectors[cnt] < 0) {
+      break;
+    }
+  }
+  free(ind_d);
+  return cnt;
+}
+
+/* Transfers the CNT sectors in SECTORS to or from the
+   consecutive sectors of KPAGE, with one device request for each
+   run of consecutive sectors. */
+static void transfer_page(const block_sector_t sectors[], size_t cnt, uint8_t* kpage,
+                          bool write) {
+  size_t i, j;
+
+  for (i = 0; i < cnt; i = j) {
+    void* buffers[SECTORS_PER_PAGE];
+    for (j = i; j < cnt && sectors[j] == sectors[i] + (j - i); j++) {
+      buffers[j - i] = kpage + j * BLOCK_SECTOR_SIZE;
+    }
+    if (write) {
+      block_writev(fs_device, sectors[i], j - i, (const void* const*)buffers);
+    } else {
+      block_readv(fs_device, sectors[i], j - i, buffers);
+    }
+  }
+}
+
+/* Reads page INDEX of the file whose inode is in sector INUMBER
+   into KPAGE, for the page cache.  The part of the page past the
+   end of the file is zeroed. */
+void inode_read_page(block_sector_t inumber, size_t index, void* kpage) {
+  block_sector_t sectors[SECTORS_PER_PAGE];
+  off_t length;
+  size_t cnt = page_to_sectors(inumber, index, sectors, &length);
+  off_t file_left = length - (off_t)(index * PGSIZE);
+
+  transfer_page(sectors, cnt, kpage, false);
+  if (file_left < PGSIZE) {
+    memset((uint8_t*)kpage + (file_left > 0 ? file_left : 0), 0,
+           PGSIZE - (file_left > 0 ? file_left : 0));
+  }
+}
+
+/* Writes KPAGE back to the sectors of page INDEX of the file
+   whose inode is in sector INUMBER, for the page cache.  The part
+   of the page past the end of the file is not written. */
+void inode_write_page(block_sector_t inumber, size_t index, const void* kpage) {
+  block_sector_t sectors[SECTORS_PER_PAGE];
+  off_t length;
+  size_t cnt = page_to_sectors(inumber, index, sectors, &length);
+
+  transfer_page(sectors, cnt, (uint8_t*)kpage, true);
+}
+
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Lookups traverse it under
+   RCU; insertions and removals hold inode_list_lock and bump
+   open_inodes_seq. */
 static struct list open_inodes;
+static struct seqlock open_inodes_seq;
 
 /* Protect open inode list */
 struct lock inode_list_lock;
 
+/* Cache of struct inodes. */
+static struct kmem_cache inode_cache;
+
 /* Initializes the inode module. */
 void inode_init(void) {
+  kmem_cache_create(&inode_cache, "inode", MT_INODE, sizeof(struct inode), NULL);
   list_init(&open_inodes);
+  seqlock_init(&open_inodes_seq);
   lock_init(&inode_list_lock);
 }
 
+/* Zeroes newly allocated sector BST on disk.  Data sectors do
+   not go through the sector cache, which holds only metadata, so
+   the zeros are written directly. */
 void fill_sector_with_zeros(block_sector_t bst) {
   static char zeros[BLOCK_SECTOR_SIZE];
-  cache_write(zeros, bst);
+  block_write(fs_device, bst, zeros);
 }
 
 /* Call resize in inode_write and inode_create */
@@ -167,7 +252,7 @@ bool inode_resize(struct inode_disk* ind_d, off_t size) {
 
   size_t new_alloc_num = num_block_new > num_block_old ? (num_block_new - num_block_old) : 0;
   // list for storing allocated sector number
-  block_sector_t* new_block_list = malloc(new_alloc_num * sizeof(block_sector_t));
+  block_sector_t* new_block_list = malloc_tagged(new_alloc_num * sizeof(block_sector_t), MT_INODE);
   if (new_block_list == NULL && new_alloc_num != 0) {
     ind_d->length = old_size;
     return false;
@@ -194,9 +279,6 @@ bool inode_resize(struct inode_disk* ind_d, off_t size) {
     } else if (size > BLOCK_SECTOR_SIZE * i && ind_d->direct[i] == 0) {
       // Grow
       ind_d->direct[i] = new_block_list[new_list_i++];
-      // fill the new allocated sector with zero
-      static char zeros[BLOCK_SECTOR_SIZE];
-      cache_write(zeros, ind_d->direct[i]);
     }
   }
   // Check if the following block is necessary
@@ -206,7 +288,7 @@ bool inode_resize(struct inode_disk* ind_d, off_t size) {
   }
 
   // Handle indirect pointer, hit only if indir ptr is needed
-  block_sector_t* buffer = malloc(INUMBER_PER_BLOCK * sizeof(block_sector_t));
+  block_sector_t* buffer = malloc_tagged(INUMBER_PER_BLOCK * sizeof(block_sector_t), MT_INODE);
   if (buffer == NULL) {
     free(new_block_list);
     ind_d->length = old_size;
@@ -237,7 +319,7 @@ bool inode_resize(struct inode_disk* ind_d, off_t size) {
   }
 
   // Handle doubly indirect pointer, hit only if db indir ptr is needed
-  block_sector_t* buffer1 = malloc(INUMBER_PER_BLOCK * sizeof(block_sector_t));
+  block_sector_t* buffer1 = malloc_tagged(INUMBER_PER_BLOCK * sizeof(block_sector_t), MT_INODE);
   if (buffer1 == NULL) {
     free(new_block_list);
     ind_d->length = old_size;
@@ -259,7 +341,7 @@ bool inode_resize(struct inode_disk* ind_d, off_t size) {
       buffer1[i] = 0;
     } else if (size > (MAX_WITHOUT_D_INDIR + i * INUMBER_PER_BLOCK) * BLOCK_SECTOR_SIZE) {
       // Grow first pointer
-      block_sector_t* buffer2 = malloc(INUMBER_PER_BLOCK * sizeof(block_sector_t));
+      block_sector_t* buffer2 = malloc_tagged(INUMBER_PER_BLOCK * sizeof(block_sector_t), MT_INODE);
       if (buffer2 == NULL) {
         free(buffer1);
         free(new_block_list);
@@ -309,7 +391,7 @@ bool inode_create(block_sector_t sector, off_t length) {
      one sector in size, and you should fix that. */
   ASSERT(sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
-  disk_inode = calloc(1, sizeof *disk_inode);
+  disk_inode = calloc_tagged(1, sizeof *disk_inode, MT_INODE);
   if (disk_inode != NULL) {
     disk_inode->length = 0;
     disk_inode->magic = INODE_MAGIC;
@@ -324,27 +406,49 @@ bool inode_create(block_sector_t sector, off_t length) {
   return success;
 }
 
+/* Takes a new reference to INODE unless its last opener has
+   already closed it.  Returns true if successful. */
+static bool inode_get_unless_closed(struct inode* inode) {
+  enum intr_level old_level = intr_disable();
+  bool success = inode->open_cnt > 0;
+  if (success)
+    inode->open_cnt++;
+  intr_set_level(old_level);
+  return success;
+}
+
+/* Searches the open inode list for SECTOR and returns a new
+   reference to it, or a null pointer if it is not open.  The
+   caller must be in an RCU read-side section or hold
+   inode_list_lock. */
+static struct inode* inode_lookup(block_sector_t sector) {
+  struct list_elem* e;
+
+  for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
+    struct inode* inode = list_entry(e, struct inode, elem);
+    if (inode->sector == sector && inode_get_unless_closed(inode))
+      return inode;
+  }
+  return NULL;
+}
+
 /* Reads an inode from SECTOR
    and returns a `struct inode' that contains it.
    Returns a null pointer if memory allocation fails. */
 struct inode* inode_open(block_sector_t sector) {
-  struct list_elem* e;
   struct inode* inode;
+  unsigned seq;
 
   /* Check whether this inode is already open. */
-  lock_acquire(&inode_list_lock);
-  for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
-    inode = list_entry(e, struct inode, elem);
-    if (inode->sector == sector) {
-      inode_reopen(inode);
-      lock_release(&inode_list_lock);
-      return inode;
-    }
-  }
-  lock_release(&inode_list_lock);
+  seq = seqlock_read_begin(&open_inodes_seq);
+  rcu_read_lock();
+  inode = inode_lookup(sector);
+  rcu_read_unlock();
+  if (inode != NULL)
+    return inode;
 
   /* Allocate memory. */
-  inode = malloc(sizeof *inode);
+  inode = kmem_cache_alloc(&inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -357,23 +461,42 @@ struct inode* inode_open(block_sector_t sector) {
   lock_init(&inode->inode_lock);
 
   lock_acquire(&inode_list_lock);
+  if (seqlock_read_retry(&open_inodes_seq, seq)) {
+    /* The list changed while we were allocating, so another
+       thread may have opened the same inode. */
+    struct inode* other = inode_lookup(sector);
+    if (other != NULL) {
+      lock_release(&inode_list_lock);
+      kmem_cache_free(&inode_cache, inode);
+      return other;
+    }
+  }
+  seqlock_write_begin(&open_inodes_seq);
   list_push_front(&open_inodes, &inode->elem);
+  seqlock_write_end(&open_inodes_seq);
   lock_release(&inode_list_lock);
   return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode* inode_reopen(struct inode* inode) {
-  lock_acquire(&inode->inode_lock);
-  if (inode != NULL)
+  if (inode != NULL) {
+    enum intr_level old_level = intr_disable();
+    ASSERT(inode->open_cnt > 0);
     inode->open_cnt++;
-  lock_release(&inode->inode_lock);
+    intr_set_level(old_level);
+  }
   return inode;
 }
 
 /* Returns INODE's inode number. */
 block_sector_t inode_get_inumber(const struct inode* inode) { return inode->sector; }
 
+/* Frees an inode once no RCU reader can still see it. */
+static void inode_free_rcu(struct rcu_head* head) {
+  kmem_cache_free(&inode_cache, rcu_entry(head, struct inode, rcu));
+}
+
 /* Closes INODE and writes it to disk.
    If this was the last reference to INODE, frees its memory.
    If INODE was also a removed inode, frees its blocks. */
@@ -383,15 +506,23 @@ void inode_close(struct inode* inode) {
     return;
 
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0) {
-    /* Remove from inode list and release lock. */
+  enum intr_level old_level = intr_disable();
+  int open_cnt = --inode->open_cnt;
+  intr_set_level(old_level);
+  if (open_cnt == 0) {
+    /* Remove from inode list and release lock.  Lookups that
+       are still traversing the list may see INODE until the
+       next grace period, so its memory is freed through RCU. */
     lock_acquire(&inode_list_lock);
+    seqlock_write_begin(&open_inodes_seq);
     list_remove(&inode->elem);
+    seqlock_write_end(&open_inodes_seq);
     lock_release(&inode_list_lock);
 
     /* Deallocate blocks if removed. */
     if (inode->removed) {
-      struct inode_disk* ind_d = calloc(BLOCK_SECTOR_SIZE, 1);
+      page_cache_discard(inode->sector);
+      struct inode_disk* ind_d = calloc_tagged(BLOCK_SECTOR_SIZE, 1, MT_INODE);
       if (ind_d == NULL) {
         return;
       }
@@ -401,7 +532,7 @@ void inode_close(struct inode* inode) {
       free_map_release(inode->sector, 1);
       free(ind_d);
     }
-    free(inode);
+    call_rcu(&inode->rcu, inode_free_rcu);
   }
 }
 
@@ -418,128 +549,116 @@ void inode_remove(struct inode* inode) {
 off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset) {
   uint8_t* buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t* bounce = NULL;
+  off_t length = inode_length(inode);
 
   while (size > 0) {
-    /* Disk sector to read, starting byte offset within sector. */
-    block_sector_t sector_idx = byte_to_sector(inode, offset);
-    if ((int)sector_idx < 0) {
-      return bytes_read;
-    }
-
-    int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+    /* Page to read, starting byte offset within page. */
+    size_t page_idx = offset / PGSIZE;
+    int page_ofs = offset % PGSIZE;
 
-    /* Bytes left in inode, bytes left in sector, lesser of the two. */
-    off_t inode_left = inode_length(inode) - offset;
-    int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-    int min_left = inode_left < sector_left ? inode_left : sector_left;
+    /* Bytes left in inode, bytes left in page, lesser of the two. */
+    off_t inode_left = length - offset;
+    int page_left = PGSIZE - page_ofs;
+    int min_left = inode_left < page_left ? inode_left : page_left;
 
-    /* Number of bytes to actually copy out of this sector. */
+    /* Number of bytes to actually copy out of this page. */
     int chunk_size = size < min_left ? size : min_left;
     if (chunk_size <= 0)
       break;
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
-      /* Read full sector directly into caller's buffer. */
-      cache_read(buffer + bytes_read, sector_idx);
-    } else {
-      /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-      if (bounce == NULL) {
-        bounce = malloc(BLOCK_SECTOR_SIZE);
-        if (bounce == NULL)
-          break;
-      }
-      cache_read(bounce, sector_idx);
-      memcpy(buffer + bytes_read, bounce + sector_ofs, chunk_size);
-    }
+    struct cache_page* cp = page_cache_get(inode->sector, page_idx, true);
+    if (cp == NULL)
+      break;
+    memcpy(buffer + bytes_read, (uint8_t*)cp->kpage + page_ofs, chunk_size);
+    page_cache_put(cp, false);
 
     /* Advance. */
     size -= chunk_size;
     offset += chunk_size;
     bytes_read += chunk_size;
   }
-  free(bounce);
 
   return bytes_read;
 }
 
+/* Zeroes the part of INODE's page cache page that lies past
+   OLD_LENGTH, the end of file before a write extends it.  A
+   process that has the page mapped may have written there. */
+static void zero_page_tail(struct inode* inode, off_t old_length) {
+  int page_ofs = old_length % PGSIZE;
+  struct cache_page* cp;
+
+  if (page_ofs == 0)
+    return;
+  cp = page_cache_get(inode->sector, old_length / PGSIZE, true);
+  if (cp != NULL) {
+    memset((uint8_t*)cp->kpage + page_ofs, 0, PGSIZE - page_ofs);
+    page_cache_put(cp, true);
+  }
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   A write past end of file extends the inode. */
 off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t offset) {
   const uint8_t* buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t* bounce = NULL;
 
   if (inode->deny_write_cnt)
     return 0;
 
   // Resize inode if necessary
   off_t new_length = size + offset;
-  struct inode_disk* ind_d = calloc(BLOCK_SECTOR_SIZE, 1);
+  struct inode_disk* ind_d = calloc_tagged(BLOCK_SECTOR_SIZE, 1, MT_INODE);
   if (ind_d == NULL) {
     return 0;
   }
   cache_read(ind_d, inode->sector);
   // Acquire lock before resize the node
   lock_acquire(&inode->inode_lock);
-  if (new_length > ind_d->length) {
+  off_t old_length = ind_d->length;
+  if (new_length > old_length) {
     if (!inode_resize(ind_d, new_length)) {
       lock_release(&inode->inode_lock);
       free(ind_d);
       return 0;
     }
+    cache_write(ind_d, inode->sector);
+    zero_page_tail(inode, old_length);
   }
   lock_release(&inode->inode_lock);
-  cache_write(ind_d, inode->sector);
+  off_t length = ind_d->length;
+  free(ind_d);
 
   while (size > 0) {
-    /* Sector to write, starting byte offset within sector. */
-    block_sector_t sector_idx = byte_to_sector(inode, offset);
-    int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+    /* Page to write, starting byte offset within page. */
+    size_t page_idx = offset / PGSIZE;
+    int page_ofs = offset % PGSIZE;
 
-    /* Bytes left in inode, bytes left in sector, lesser of the two. */
-    off_t inode_left = inode_length(inode) - offset;
-    int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-    int min_left = inode_left < sector_left ? inode_left : sector_left;
+    /* Bytes left in inode, bytes left in page, lesser of the two. */
+    off_t inode_left = length - offset;
+    int page_left = PGSIZE - page_ofs;
+    int min_left = inode_left < page_left ? inode_left : page_left;
 
-    /* Number of bytes to actually write into this sector. */
+    /* Number of bytes to actually write into this page. */
     int chunk_size = size < min_left ? size : min_left;
     if (chunk_size <= 0)
       break;
 
-    if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
-      /* Write full sector directly to disk. */
-      cache_write((void*)(buffer + bytes_written), sector_idx);
-    } else {
-      /* We need a bounce buffer. */
-      if (bounce == NULL) {
-        bounce = malloc(BLOCK_SECTOR_SIZE);
-        if (bounce == NULL)
-          break;
-      }
-
-      /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-      if (sector_ofs > 0 || chunk_size < sector_left)
-        cache_read(bounce, sector_idx);
-      else
-        memset(bounce, 0, BLOCK_SECTOR_SIZE);
-      memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
-      cache_write(bounce, sector_idx);
-    }
+    /* A page that is about to be overwritten in full need not
+       be read first. */
+    struct cache_page* cp = page_cache_get(inode->sector, page_idx, chunk_size < PGSIZE);
+    if (cp == NULL)
+      break;
+    memcpy((uint8_t*)cp->kpage + page_ofs, buffer + bytes_written, chunk_size);
+    page_cache_put(cp, true);
 
     /* Advance. */
     size -= chunk_size;
     offset += chunk_size;
     bytes_written += chunk_size;
   }
-  free(ind_d);
-  free(bounce);
   return bytes_written;
 }
 
@@ -565,9 +684,20 @@ void inode_allow_write(struct inode* inode) {
   lock_release(&inode->inode_lock);
 }
 
+/* Returns true if writes to INODE are denied, as they are while
+   it is some process's executable. */
+bool inode_write_denied(struct inode* inode) {
+  bool denied;
+
+  lock_acquire(&inode->inode_lock);
+  denied = inode->deny_write_cnt > 0;
+  lock_release(&inode->inode_lock);
+  return denied;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t inode_length(const struct inode* inode) {
-  struct inode_disk* ind_d = calloc(BLOCK_SECTOR_SIZE, 1);
+  struct inode_disk* ind_d = calloc_tagged(BLOCK_SECTOR_SIZE, 1, MT_INODE);
   if (ind_d == NULL) {
     return -1;
   }
@@ -2,6 +2,7 @@
 #define FILESYS_INODE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "filesys/off_t.h"
 #include "devices/block.h"
 
@@ -18,7 +19,10 @@ off_t inode_read_at(struct inode*, void*, off_t size, off_t offset);
 off_t inode_write_at(struct inode*, const void*, off_t size, off_t offset);
 void inode_deny_write(struct inode*);
 void inode_allow_write(struct inode*);
+bool inode_write_denied(struct inode*);
 off_t inode_length(const struct inode*);
+void inode_read_page(block_sector_t inumber, size_t index, void* kpage);
+void inode_write_page(block_sector_t inumber, size_t index, const void* kpage);
 
 /* helper for proj3 task3 */
 int get_open_cnt(struct inode*);
@@ -0,0 +1,307 @@
+#include "filesys/page-cache.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/inode.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+/* The page cache.
+
+   File data is cached a page at a time, keyed by the sector of
+   the file's inode and the page's number within the file.
+   inode_read_at() and inode_write_at() copy to and from these
+   pages, and the pages of a memory-mapped file are mapped
+   straight into the process (see vm/page.c), so that one copy
+   of each page of file data serves both.  The sector cache in
+   cache.c is left with only inodes and indirect blocks.
+
+   A page is read in all at once, its sectors fetched with as few
+   device requests as their layout on disk allows, and a dirty
+   page is written back the same way when it is evicted, when the
+   cache is reset, or at shutdown.  Pages outlive the inodes that
+   read them, so that a file that is closed and opened again
+   finds its data still cached; the pages of a removed file are
+   discarded when it is finally closed.
+
+   The cache keeps up to PAGE_CACHE_SIZE pages and evicts the
+   least recently used one that nobody holds.  A page stays in
+   the cache while anyone holds it with page_cache_get(), such as
+   a process that has it mapped, and if all the pages are held
+   the cache grows past its size, shrinking back as they are
+   released.  Processes running the same executable all hold the
+   same pages of its code this way.
+
+   CACHE_LOCK protects everything but the pages' contents, which
+   are copied in and out without it, so that copying to a user
+   buffer may fault. */
+
+static struct hash pages;      /* All cached pages. */
+static struct list lru;        /* Cached pages, most recently used first. */
+static size_t page_cnt;        /* Number of cached pages. */
+static struct lock cache_lock; /* Protects the members above. */
+static struct kmem_cache cache_page_cache;
+
+/* Statistics, protected by CACHE_LOCK. */
+static unsigned int hit_cnt;
+static unsigned int miss_cnt;
+
+static hash_hash_func cache_page_hash;
+static hash_less_func cache_page_less;
+
+/* Constructs a freshly carved cache page. */
+static void cache_page_ctor(void* cp_) {
+  struct cache_page* cp = cp_;
+  lock_init(&cp->load_lock);
+}
+
+/* Initializes the page cache. */
+void page_cache_init(void) {
+  kmem_cache_create(&cache_page_cache, "cache_page", MT_CACHE, sizeof(struct cache_page),
+                    cache_page_ctor);
+  if (!hash_init(&pages, cache_page_hash, cache_page_less, NULL))
+    PANIC("page cache hash table creation failed");
+  list_init(&lru);
+  lock_init(&cache_lock);
+}
+
+/* Returns the cached page INDEX of the file whose inode is in
+   sector INUMBER, or a null pointer if it is not cached.
+   CACHE_LOCK must be held. */
+static struct cache_page* lookup(block_sector_t inumber, size_t index) {
+  struct cache_page cp;
+  struct hash_elem* e;
+
+  cp.inumber = inumber;
+  cp.index = index;
+  e = hash_find(&pages, &cp.elem);
+  return e != NULL ? hash_entry(e, struct cache_page, elem) : NULL;
+}
+
+/* Writes page CP back to its file if it is dirty.  CACHE_LOCK
+   must be held. */
+static void write_back(struct cache_page* cp) {
+  if (cp->dirty) {
+    inode_write_page(cp->inumber, cp->index, cp->kpage);
+    cp->dirty = false;
+  }
+}
+
+/* Removes page CP from the cache, writing it back first if
+   WRITE is true.  CACHE_LOCK must be held. */
+static void remove_page(struct cache_page* cp, bool write) {
+  ASSERT(cp->ref_cnt == 0);
+
+  if (write)
+    write_back(cp);
+  hash_delete(&pages, &cp->elem);
+  list_remove(&cp->lru_elem);
+}
+
+/* Frees page CP, which must already be removed from the cache.
+   CACHE_LOCK must be held. */
+static void free_page(struct cache_page* cp) {
+  palloc_free_page(cp->kpage);
+  kmem_cache_free(&cache_page_cache, cp);
+  page_cnt--;
+}
+
+/* Evicts the least recently used page that nobody holds and
+   returns it for reuse, or returns a null pointer if every page
+   is held.  CACHE_LOCK must be held. */
+static struct cache_page* evict(void) {
+  struct list_elem* e;
+
+  for (e = list_rbegin(&lru); e != list_rend(&lru); e = list_prev(e)) {
+    struct cache_page* cp = list_entry(e, struct cache_page, lru_elem);
+    if (cp->ref_cnt == 0) {
+      remove_page(cp, true);
+      return cp;
+    }
+  }
+  return NULL;
+}
+
+/* Obtains a page for the cache, a new one while the cache is
+   below its size or every page is held, and an evicted one
+   otherwise.  Returns a null pointer if memory runs out and no
+   page can be evicted.  CACHE_LOCK must be held. */
+static struct cache_page* new_page(void) {
+  struct cache_page* cp;
+  void* kpage;
+
+  if (page_cnt >= PAGE_CACHE_SIZE && (cp = evict()) != NULL)
+    return cp;
+
+  kpage = palloc_get_page(0);
+  if (kpage != NULL) {
+    cp = kmem_cache_alloc(&cache_page_cache);
+    if (cp != NULL) {
+      cp->kpage = kpage;
+      page_cnt++;
+      return cp;
+    }
+    palloc_free_page(kpage);
+  }
+  return evict();
+}
+
+/* Looks up page INDEX of the file whose inode is in sector
+   INUMBER.  If it is cached, counts a hit, takes a reference to
+   it for the caller, moves it to the front of the LRU list, and
+   releases CACHE_LOCK, then waits for the page to be read in if
+   it is still being read, and returns it.  Otherwise returns a
+   null pointer with CACHE_LOCK still held.  CACHE_LOCK must be
+   held on entry. */
+static struct cache_page* get_cached(block_sector_t inumber, size_t index) {
+  struct cache_page* cp = lookup(inumber, index);
+
+  if (cp == NULL)
+    return NULL;
+  hit_cnt++;
+  cp->ref_cnt++;
+  list_remove(&cp->lru_elem);
+  list_push_front(&lru, &cp->lru_elem);
+  lock_release(&cache_lock);
+
+  lock_acquire(&cp->load_lock);
+  lock_release(&cp->load_lock);
+  return cp;
+}
+
+/* Returns page INDEX of the file whose inode is in sector
+   INUMBER, reading it in if it is not cached.  If FILL is false,
+   the caller is about to overwrite the whole page, so a page
+   that is not cached starts out as zeros instead of being read.
+   The page stays in the cache, at the same address, until the
+   caller releases it with page_cache_put().  Returns a null
+   pointer if memory is not available. */
+struct cache_page* page_cache_get(block_sector_t inumber, size_t index, bool fill) {
+  struct cache_page* cp;
+
+  lock_acquire(&cache_lock);
+  cp = get_cached(inumber, index);
+  if (cp != NULL)
+    return cp;
+
+  miss_cnt++;
+  cp = new_page();
+  if (cp == NULL) {
+    lock_release(&cache_lock);
+    return NULL;
+  }
+  cp->inumber = inumber;
+  cp->index = index;
+  cp->ref_cnt = 1;
+  cp->dirty = false;
+  hash_insert(&pages, &cp->elem);
+  list_push_front(&lru, &cp->lru_elem);
+  lock_acquire(&cp->load_lock);
+  lock_release(&cache_lock);
+
+  if (fill)
+    inode_read_page(inumber, index, cp->kpage);
+  else
+    memset(cp->kpage, 0, PGSIZE);
+  lock_release(&cp->load_lock);
+  return cp;
+}
+
+/* Returns page INDEX of the file whose inode is in sector
+   INUMBER, like page_cache_get(), if it is cached, or a null
+   pointer without reading anything if it is not. */
+struct cache_page* page_cache_lookup(block_sector_t inumber, size_t index) {
+  struct cache_page* cp;
+
+  lock_acquire(&cache_lock);
+  cp = get_cached(inumber, index);
+  if (cp == NULL)
+    lock_release(&cache_lock);
+  return cp;
+}
+
+/* Releases page CP, obtained from page_cache_get() or
+   page_cache_lookup(), marking it
+   for write-back if DIRTY is true. */
+void page_cache_put(struct cache_page* cp, bool dirty) {
+  lock_acquire(&cache_lock);
+  ASSERT(cp->ref_cnt > 0);
+  if (dirty)
+    cp->dirty = true;
+  if (--cp->ref_cnt == 0 && page_cnt > PAGE_CACHE_SIZE) {
+    remove_page(cp, true);
+    free_page(cp);
+  }
+  lock_release(&cache_lock);
+}
+
+/* Drops the cached pages of the file whose inode is in sector
+   INUMBER, without writing them back, because the file has been
+   removed and its sectors are about to be freed. */
+void page_cache_discard(block_sector_t inumber) {
+  struct list_elem* e;
+
+  lock_acquire(&cache_lock);
+  for (e = list_begin(&lru); e != list_end(&lru);) {
+    struct cache_page* cp = list_entry(e, struct cache_page, lru_elem);
+    e = list_next(e);
+    if (cp->inumber == inumber) {
+      remove_page(cp, false);
+      free_page(cp);
+    }
+  }
+  lock_release(&cache_lock);
+}
+
+/* Writes back and drops every page that nobody holds, and resets
+   the hit and miss counts. */
+void page_cache_reset(void) {
+  struct list_elem* e;
+
+  lock_acquire(&cache_lock);
+  for (e = list_begin(&lru); e != list_end(&lru);) {
+    struct cache_page* cp = list_entry(e, struct cache_page, lru_elem);
+    e = list_next(e);
+    if (cp->ref_cnt == 0) {
+      remove_page(cp, true);
+      free_page(cp);
+    }
+  }
+  hit_cnt = miss_cnt = 0;
+  lock_release(&cache_lock);
+}
+
+/* Writes every dirty page back to disk, at shutdown. */
+void page_cache_done(void) {
+  struct list_elem* e;
+
+  lock_acquire(&cache_lock);
+  for (e = list_begin(&lru); e != list_end(&lru); e = list_next(e))
+    write_back(list_entry(e, struct cache_page, lru_elem));
+  lock_release(&cache_lock);
+}
+
+/* Returns true if pages that are held have pushed the cache to
+   twice its size, so that holders that can let go of pages, such
+   as the frame table, should. */
+bool page_cache_crowded(void) { return page_cnt >= 2 * PAGE_CACHE_SIZE; }
+
+/* Returns the number of lookups that found their page cached. */
+unsigned int page_cache_hit_cnt(void) { return hit_cnt; }
+
+/* Returns the number of lookups that had to read their page. */
+unsigned int page_cache_miss_cnt(void) { return miss_cnt; }
+
+/* Returns a hash value for the page at E. */
+static unsigned cache_page_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct cache_page* cp = hash_entry(e, struct cache_page, elem);
+  return hash_int(cp->inumber) ^ hash_bytes(&cp->index, sizeof cp->index);
+}
+
+/* Returns true if page A precedes page B. */
+static bool cache_page_less(const struct hash_elem* a_, const struct hash_elem* b_,
+                            void* aux UNUSED) {
+  const struct cache_page* a = hash_entry(a_, struct cache_page, elem);
+  const struct cache_page* b = hash_entry(b_, struct cache_page, elem);
+  return a->inumber != b->inumber ? a->inumber < b->inumber : a->index < b->index;
+}
@@ -0,0 +1,38 @@
+#ifndef FILESYS_PAGE_CACHE_H
+#define FILESYS_PAGE_CACHE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+
+/* Number of pages the cache keeps.  More may be in use at once,
+   while pages are mapped into processes. */
+#define PAGE_CACHE_SIZE 32
+
+/* A page of file data in the page cache. */
+struct cache_page {
+  block_sector_t inumber;    /* Sector of the file's inode. */
+  size_t index;              /* Page number within the file. */
+  void* kpage;               /* The page's data. */
+  int ref_cnt;               /* Users of the page; 0 if evictable. */
+  bool dirty;                /* Modified since last written back? */
+  struct lock load_lock;     /* Held while the page is read in. */
+  struct hash_elem elem;     /* Element in the cache's hash table. */
+  struct list_elem lru_elem; /* Element in the cache's LRU list. */
+};
+
+void page_cache_init(void);
+void page_cache_done(void);
+struct cache_page* page_cache_get(block_sector_t inumber, size_t index, bool fill);
+struct cache_page* page_cache_lookup(block_sector_t inumber, size_t index);
+void page_cache_put(struct cache_page*, bool dirty);
+void page_cache_discard(block_sector_t inumber);
+void page_cache_reset(void);
+bool page_cache_crowded(void);
+unsigned int page_cache_hit_cnt(void);
+unsigned int page_cache_miss_cnt(void);
+
+#endif /* filesys/page-cache.h */
@@ -0,0 +1,146 @@
+#include "lzf.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* LZF compression.
+
+   Compressed data is a sequence of runs, each starting with a
+   control byte C:
+
+     - C < 32: C + 1 literal bytes follow, to be copied as is.
+
+     - Otherwise, a back-reference: copy LEN + 2 bytes starting
+       OFS + 1 bytes back in the output, where LEN is C >> 5,
+       plus the byte that follows if that is 7, and OFS is
+       (C & 0x1f) << 8 plus the byte after that.  The copy may
+       overlap its own output, to repeat a short pattern.
+
+   The compressor finds matches through a hash table of the most
+   recent position of each 3-byte sequence, so it runs in one
+   pass without searching.  It gives up on a match as soon as it
+   finds one, which keeps it fast at some cost in ratio. */
+
+#define MAX_LIT 32                /* Longest literal run. */
+#define MAX_OFF (1 << 13)         /* Farthest back-reference. */
+#define MAX_REF (7 + 255 + 2)     /* Longest back-reference. */
+
+/* Returns the hash table index for the 3 bytes at P. */
+static unsigned hash3(const uint8_t* p) {
+  unsigned v = (p[0] << 16) | (p[1] << 8) | p[2];
+  return ((v * 2654435761u) >> 20) & (LZF_HTAB_SIZE - 1);
+}
+
+/* Copies IN[*LIT...IP) to OUT at *OP as literal runs and
+   advances *LIT to IP.  Returns false if that would take OUT
+   past OUT_LEN. */
+static bool put_literals(const uint8_t* in, size_t* lit, size_t ip, uint8_t* out, size_t* op,
+                         size_t out_len) {
+  while (*lit < ip) {
+    size_t n = ip - *lit < MAX_LIT ? ip - *lit : MAX_LIT;
+
+    if (*op + 1 + n > out_len)
+      return false;
+    out[(*op)++] = n - 1;
+    memcpy(out + *op, in + *lit, n);
+    *op += n;
+    *lit += n;
+  }
+  return true;
+}
+
+/* Compresses the IN_LEN bytes at IN into the OUT_LEN bytes at
+   OUT, using HTAB as scratch space.  IN_LEN must be less than
+   65535.  Returns the size of the compressed data, or 0 if it
+   does not fit in OUT_LEN bytes. */
+size_t lzf_compress(const void* in_, size_t in_len, void* out_, size_t out_len,
+                    uint16_t htab[LZF_HTAB_SIZE]) {
+  const uint8_t* in = in_;
+  uint8_t* out = out_;
+  size_t ip = 0;  /* Next input byte to look at. */
+  size_t lit = 0; /* First input byte not yet output. */
+  size_t op = 0;  /* Next output byte. */
+
+  ASSERT(in_len < UINT16_MAX);
+
+  /* Positions are stored plus 1, so that 0 means none. */
+  memset(htab, 0, LZF_HTAB_SIZE * sizeof *htab);
+  while (ip + 2 < in_len) {
+    unsigned h = hash3(in + ip);
+    size_t ref = htab[h];
+
+    htab[h] = ip + 1;
+    if (ref-- != 0 && ip - ref <= MAX_OFF && !memcmp(in + ref, in + ip, 3)) {
+      size_t max = in_len - ip < MAX_REF ? in_len - ip : MAX_REF;
+      size_t len = 3;
+      size_t ofs = ip - ref - 1;
+
+      while (len < max && in[ref + len] == in[ip + len])
+        len++;
+      if (!put_literals(in, &lit, ip, out, &op, out_len) || op + 3 > out_len)
+        return 0;
+      if (len - 2 < 7)
+        out[op++] = ((len - 2) << 5) | (ofs >> 8);
+      else {
+        out[op++] = (7 << 5) | (ofs >> 8);
+        out[op++] = len - 2 - 7;
+      }
+      out[op++] = ofs & 0xff;
+
+      /* Remember the positions that the match skips over, so
+         that later data can refer back into it. */
+      for (ip++, len--; len > 0 && ip + 2 < in_len; ip++, len--)
+        htab[hash3(in + ip)] = ip + 1;
+      ip += len;
+      lit = ip;
+    } else
+      ip++;
+  }
+  if (!put_literals(in, &lit, in_len, out, &op, out_len))
+    return 0;
+  return op;
+}
+
+/* Decompresses the IN_LEN bytes at IN, produced by
+   lzf_compress(), into the OUT_LEN bytes at OUT.  Returns the
+   size of the decompressed data, or 0 if it would not fit or IN
+   is corrupt. */
+size_t lzf_decompress(const void* in_, size_t in_len, void* out_, size_t out_len) {
+  const uint8_t* in = in_;
+  uint8_t* out = out_;
+  size_t ip = 0, op = 0;
+
+  while (ip < in_len) {
+    unsigned c = in[ip++];
+
+    if (c < MAX_LIT) {
+      size_t n = c + 1;
+      if (ip + n > in_len || op + n > out_len)
+        return 0;
+      memcpy(out + op, in + ip, n);
+      ip += n;
+      op += n;
+    } else {
+      size_t len = c >> 5;
+      size_t back;
+
+      if (len == 7) {
+        if (ip >= in_len)
+          return 0;
+        len += in[ip++];
+      }
+      if (ip >= in_len)
+        return 0;
+      back = ((c & 0x1f) << 8) + in[ip++] + 1;
+      len += 2;
+      if (back > op || op + len > out_len)
+        return 0;
+
+      /* Byte by byte, since the source may overlap the
+         destination. */
+      for (; len > 0; len--, op++)
+        out[op] = out[op - back];
+    }
+  }
+  return op;
+}
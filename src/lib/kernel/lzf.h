@@ -0,0 +1,18 @@
+#ifndef __LIB_KERNEL_LZF_H
+#define __LIB_KERNEL_LZF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* LZF compression, a fast member of the LZ77 family.  Data
+   compressed by lzf_compress() is in the format of Marc
+   Lehmann's liblzf. */
+
+/* Entries in the hash table that lzf_compress() works in. */
+#define LZF_HTAB_SIZE 4096
+
+size_t lzf_compress(const void* in, size_t in_len, void* out, size_t out_len,
+                    uint16_t htab[LZF_HTAB_SIZE]);
+size_t lzf_decompress(const void* in, size_t in_len, void* out, size_t out_len);
+
+#endif /* lib/kernel/lzf.h */
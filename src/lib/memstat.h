@@ -0,0 +1,44 @@
+#ifndef __LIB_MEMSTAT_H
+#define __LIB_MEMSTAT_H
+
+#include <stddef.h>
+
+/* Kernel memory statistics, as returned by the memstat(),
+   heapstat(), and swapstat() system calls. */
+
+#define MEMSTAT_NAME_MAX 15
+
+/* Memory allocated on behalf of one kernel subsystem.  Counts
+   are kept only if the kernel was booted with -memtag. */
+struct memstat {
+  char name[MEMSTAT_NAME_MAX + 1]; /* Subsystem name. */
+  size_t live_bytes;               /* Bytes currently allocated. */
+  size_t peak_bytes;               /* Maximum of LIVE_BYTES. */
+  size_t alloc_cnt;                /* Allocations so far. */
+  size_t free_cnt;                 /* Frees so far. */
+};
+
+/* Utilization of one malloc() size class. */
+struct heapstat {
+  size_t block_size;       /* Size of each block in bytes. */
+  size_t blocks_per_arena; /* Number of blocks in an arena. */
+  size_t arena_cnt;        /* Arenas currently allocated. */
+  size_t peak_arena_cnt;   /* Maximum of ARENA_CNT. */
+  size_t used_cnt;         /* Blocks currently in use. */
+};
+
+/* Swap traffic since boot, with the time at which it was read
+   so that callers can compute throughput. */
+struct swapstat {
+  long long pages_written;     /* Pages written to the swap device. */
+  long long pages_read;        /* Pages read from the swap device. */
+  long long write_requests;    /* Device requests that wrote them. */
+  long long read_requests;     /* Device requests that read them. */
+  long long zswap_stores;      /* Pages kept in compressed swap instead. */
+  long long zswap_zero_stores; /* Of those, pages of zeros. */
+  long long zswap_bytes;       /* Compressed size of the others. */
+  long long ticks;             /* Timer ticks since boot. */
+  int ticks_per_sec;           /* Timer ticks per second. */
+};
+
+#endif /* lib/memstat.h */
@@ -0,0 +1,24 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stddef.h>
+
+/* System calls numbered below this are counted one by one. */
+#define RUSAGE_SYSCALL_CNT 48
+
+/* Resources used by a process, as returned by the getrusage()
+   system call and printed at exit by a kernel booted with
+   -rusage. */
+struct rusage {
+  long long user_ticks;                   /* Timer ticks in user mode. */
+  long long kernel_ticks;                 /* Timer ticks in the kernel. */
+  long long minor_faults;                 /* Page faults served from memory. */
+  long long major_faults;                 /* Page faults that read a disk. */
+  long long sectors_read;                 /* File system sectors read. */
+  long long sectors_written;              /* File system sectors written. */
+  size_t resident_pages;                  /* User pages in memory now. */
+  size_t peak_resident_pages;             /* Maximum of RESIDENT_PAGES. */
+  long long syscalls[RUSAGE_SYSCALL_CNT]; /* Calls of each system call. */
+};
+
+#endif /* lib/rusage.h */
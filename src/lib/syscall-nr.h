@@ -22,12 +22,8 @@ enum {
   SYS_PT_CREATE,    /* Creates a new thread */
   SYS_PT_EXIT,      /* Exits the current thread */
   SYS_PT_JOIN,      /* Waits for thread to finish */
-  SYS_LOCK_INIT,    /* Initializes a lock */
-  SYS_LOCK_ACQUIRE, /* Acquires a lock */
-  SYS_LOCK_RELEASE, /* Releases a lock */
-  SYS_SEMA_INIT,    /* Initializes a semaphore */
-  SYS_SEMA_DOWN,    /* Downs a semaphore */
-  SYS_SEMA_UP,      /* Ups a semaphore */
+  SYS_FUTEX_WAIT,   /* Sleeps if a user word holds a value */
+  SYS_FUTEX_WAKE,   /* Wakes threads sleeping on a user word */
   SYS_GET_TID,      /* Gets TID of the current thread */
 
   /* Project 3 and optionally project 4. */
@@ -45,7 +41,14 @@ enum {
   SYS_CACHE_HIT,
   SYS_CACHE_MISS,
   SYS_BLOCK_READ,
-  SYS_BLOCK_WRITE
+  SYS_BLOCK_WRITE,
+
+  SYS_MEMSTAT,  /* Reads one subsystem's kernel memory use. */
+  SYS_HEAPSTAT, /* Reads one malloc() size class's utilization. */
+  SYS_SWAPSTAT, /* Reads swap traffic. */
+
+  SYS_FORK,      /* Duplicates this process. */
+  SYS_GETRUSAGE, /* Reads this process's resource usage. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,27 @@
+#ifndef __LIB_USER_ATOMIC_H
+#define __LIB_USER_ATOMIC_H
+
+/* Atomic read-modify-write operations on a word of user memory,
+   shared by the user-level synchronization code. */
+
+/* Atomically sets *P to NEW if it equals OLD.
+   Returns the previous value of *P. */
+static inline int atomic_cmpxchg(int* p, int old, int new) {
+  int prev;
+  asm volatile("lock cmpxchgl %2, %1" : "=a"(prev), "+m"(*p) : "r"(new), "0"(old) : "memory");
+  return prev;
+}
+
+/* Atomically sets *P to V and returns its previous value. */
+static inline int atomic_xchg(int* p, int v) {
+  asm volatile("xchgl %0, %1" : "+r"(v), "+m"(*p) : : "memory");
+  return v;
+}
+
+/* Atomically adds V to *P and returns its previous value. */
+static inline int atomic_fetch_add(int* p, int v) {
+  asm volatile("lock xaddl %0, %1" : "+r"(v), "+m"(*p) : : "memory");
+  return v;
+}
+
+#endif /* lib/user/atomic.h */
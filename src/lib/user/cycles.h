@@ -0,0 +1,14 @@
+#ifndef __LIB_USER_CYCLES_H
+#define __LIB_USER_CYCLES_H
+
+#include <stdint.h>
+
+/* Returns the processor's time-stamp counter, which counts CPU
+   cycles, for timing short stretches of user code. */
+static inline uint64_t cycle_count(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+#endif /* lib/user/cycles.h */
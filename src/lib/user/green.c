@@ -0,0 +1,427 @@
+#include <green.h>
+#include <pthread.h>
+#include <string.h>
+#include <syscall.h>
+#include "atomic.h"
+
+/* Green thread runtime.
+
+   Every green thread that is ready to run sits on a single FIFO
+   run queue shared by all workers.  A worker repeatedly pops a
+   thread and switches to it; the thread runs until it yields,
+   blocks, or exits, all of which switch back to the worker's own
+   context.  Only then does the worker requeue a yielding thread
+   or publish a blocked one, so that no other worker can resume a
+   thread whose registers have not been saved yet.
+
+   The short critical sections of the runtime are protected by
+   "guards": futex-based locks without owner tracking, since a
+   guard taken on a green thread's stack is often released by the
+   worker that switched away from it. */
+
+/* Random value for struct green_thread's `magic' member.
+   Used to detect stack overflow. */
+#define GREEN_MAGIC 0x67726e74 /* "grnt" */
+
+/* States in a green thread's life cycle. */
+enum green_state {
+  GREEN_READY,   /* On the run queue, or about to be put there. */
+  GREEN_RUNNING, /* Running on some worker. */
+  GREEN_BLOCKED, /* Waiting on a mutex, channel, or join. */
+  GREEN_DYING,   /* Exited; its worker has not noticed yet. */
+  GREEN_DEAD     /* Gone; its stack may be reused. */
+};
+
+/* A green thread.  Lives at the base of the thread's stack, so
+   the stack can grow down to just above it. */
+struct green_thread {
+  uint32_t* sp;                /* Saved stack pointer. */
+  enum green_state state;      /* Thread state. */
+  green_fun* fun;              /* Function to run. */
+  void* aux;                   /* Argument to FUN. */
+  struct green_worker* worker; /* Worker running this thread. */
+  int* release;                /* Guard to release once switched out. */
+  int guard;                   /* Protects DEAD state and JOINER. */
+  struct green_thread* joiner; /* Thread blocked in green_join(). */
+  struct green_thread* next;   /* Next thread in a green_queue. */
+  unsigned magic;              /* Detects stack overflow. */
+};
+
+/* A kernel thread that runs green threads. */
+struct green_worker {
+  uint32_t* sp; /* Saved stack pointer of the scheduler loop. */
+};
+
+static struct green_worker workers[GREEN_MAX_WORKERS];
+
+/* Run queue and the bookkeeping protected by READY_GUARD. */
+static int ready_guard;
+static struct green_queue ready_queue;
+static int ready_seq;     /* Bumped on each enqueue; idle workers sleep on it. */
+static int idle_workers;  /* Workers sleeping on READY_SEQ. */
+static int live_threads;  /* Threads created but not yet dead. */
+
+/* Saves the callee-saved registers of the running context on its
+   stack, stores its stack pointer into *CUR_SP, and resumes the
+   context whose saved stack pointer is NEXT_SP.  Returns when
+   another context switches back to this one.  The stack layout
+   is the same as for switch_threads() in the kernel. */
+void green_switch(uint32_t** cur_sp, uint32_t* next_sp);
+asm(".text\n"
+    ".globl green_switch\n"
+    ".type green_switch, @function\n"
+    "green_switch:\n"
+    "  movl 4(%esp), %eax\n"
+    "  movl 8(%esp), %edx\n"
+    "  pushl %ebp\n"
+    "  pushl %ebx\n"
+    "  pushl %esi\n"
+    "  pushl %edi\n"
+    "  movl %esp, (%eax)\n"
+    "  movl %edx, %esp\n"
+    "  popl %edi\n"
+    "  popl %esi\n"
+    "  popl %ebx\n"
+    "  popl %ebp\n"
+    "  ret\n");
+
+/* Acquires GUARD, sleeping in the kernel if it is contended.
+   0 means free, 1 held, 2 held with possible sleepers. */
+static void guard_acquire(int* guard) {
+  int c = atomic_cmpxchg(guard, 0, 1);
+  if (c != 0) {
+    if (c != 2)
+      c = atomic_xchg(guard, 2);
+    while (c != 0) {
+      futex_wait(guard, 2);
+      c = atomic_xchg(guard, 2);
+    }
+  }
+}
+
+/* Releases GUARD, waking a sleeper if there may be one. */
+static void guard_release(int* guard) {
+  if (atomic_xchg(guard, 0) == 2)
+    futex_wake(guard, 1);
+}
+
+/* Appends T to Q. */
+static void queue_push(struct green_queue* q, struct green_thread* t) {
+  t->next = NULL;
+  if (q->tail != NULL)
+    q->tail->next = t;
+  else
+    q->head = t;
+  q->tail = t;
+}
+
+/* Removes and returns the first thread in Q, or a null pointer
+   if Q is empty. */
+static struct green_thread* queue_pop(struct green_queue* q) {
+  struct green_thread* t = q->head;
+  if (t != NULL) {
+    q->head = t->next;
+    if (q->head == NULL)
+      q->tail = NULL;
+  }
+  return t;
+}
+
+/* Puts T on the run queue and wakes an idle worker to run it. */
+static void make_ready(struct green_thread* t) {
+  guard_acquire(&ready_guard);
+  t->state = GREEN_READY;
+  queue_push(&ready_queue, t);
+  ready_seq++;
+  if (idle_workers > 0)
+    futex_wake(&ready_seq, 1);
+  guard_release(&ready_guard);
+}
+
+/* Switches from the running green thread back to its worker.
+   The thread's state must already say why. */
+static void switch_out(struct green_thread* self) {
+  green_switch(&self->sp, self->worker->sp);
+}
+
+/* Blocks the running green thread.  GUARD, which the caller
+   holds, is released only after the thread has been switched
+   out, so whoever later wakes the thread under GUARD finds its
+   context saved. */
+static void block(int* guard) {
+  struct green_thread* self = green_self();
+  self->state = GREEN_BLOCKED;
+  self->release = guard;
+  switch_out(self);
+}
+
+/* Completes the switch away from T, which just gave up the
+   running worker. */
+static void finish_switch(struct green_thread* t) {
+  struct green_thread* joiner;
+
+  switch (t->state) {
+    case GREEN_READY:
+      make_ready(t);
+      break;
+
+    case GREEN_BLOCKED:
+      guard_release(t->release);
+      break;
+
+    case GREEN_DYING:
+      /* T's stack may be reused as soon as the guard is
+         released, so read everything we need first. */
+      guard_acquire(&t->guard);
+      t->state = GREEN_DEAD;
+      joiner = t->joiner;
+      guard_release(&t->guard);
+      if (joiner != NULL)
+        make_ready(joiner);
+
+      guard_acquire(&ready_guard);
+      if (--live_threads == 0) {
+        ready_seq++;
+        futex_wake(&ready_seq, GREEN_MAX_WORKERS);
+      }
+      guard_release(&ready_guard);
+      break;
+
+    default:
+      NOT_REACHED();
+  }
+}
+
+/* Scheduler loop of worker W.  Runs green threads until none are
+   left alive. */
+static void worker_loop(struct green_worker* w) {
+  for (;;) {
+    struct green_thread* t;
+
+    guard_acquire(&ready_guard);
+    while ((t = queue_pop(&ready_queue)) == NULL) {
+      int seq;
+
+      if (live_threads == 0) {
+        guard_release(&ready_guard);
+        return;
+      }
+
+      /* Nothing to run but threads are still alive: sleep until
+         one is made ready.  futex_wait() returns at once if
+         READY_SEQ moved after we dropped the guard. */
+      seq = ready_seq;
+      idle_workers++;
+      guard_release(&ready_guard);
+      futex_wait(&ready_seq, seq);
+      guard_acquire(&ready_guard);
+      idle_workers--;
+    }
+    guard_release(&ready_guard);
+
+    t->state = GREEN_RUNNING;
+    t->worker = w;
+    green_switch(&w->sp, t->sp);
+    finish_switch(t);
+  }
+}
+
+/* Kernel thread entry point for workers other than the first. */
+static void worker_start(void* w) { worker_loop(w); }
+
+/* Runs the green thread function, then exits the thread. */
+static void green_entry(void) {
+  struct green_thread* self = green_self();
+  self->fun(self->aux);
+  green_exit();
+}
+
+/* Creates a green thread that runs FUN(AUX) on STACK, which must
+   be GREEN_STACK_SIZE bytes aligned on a GREEN_STACK_SIZE
+   boundary, and makes it ready.  May be called before
+   green_run() or from a green thread.  Returns the new thread,
+   or a null pointer if STACK is unsuitable. */
+struct green_thread* green_create(void* stack, green_fun* fun, void* aux) {
+  struct green_thread* t = stack;
+  uint32_t* sp;
+
+  if (stack == NULL || ((uintptr_t)stack & (GREEN_STACK_SIZE - 1)) != 0 || fun == NULL)
+    return NULL;
+
+  memset(t, 0, sizeof *t);
+  t->fun = fun;
+  t->aux = aux;
+  t->magic = GREEN_MAGIC;
+
+  /* Build a frame for green_switch() to "return" into
+     green_entry(), with the stack aligned as the ABI expects at
+     a function's entry. */
+  sp = (uint32_t*)((char*)stack + GREEN_STACK_SIZE) - 4;
+  *--sp = 0;                       /* Fake return address. */
+  *--sp = (uint32_t)green_entry;   /* eip. */
+  *--sp = 0;                       /* ebp. */
+  *--sp = 0;                       /* ebx. */
+  *--sp = 0;                       /* esi. */
+  *--sp = 0;                       /* edi. */
+  t->sp = sp;
+
+  guard_acquire(&ready_guard);
+  live_threads++;
+  guard_release(&ready_guard);
+  make_ready(t);
+  return t;
+}
+
+/* Runs green threads on WORKERS kernel threads, the calling
+   thread included, until every green thread has exited.  WORKERS
+   is clamped to 1...GREEN_MAX_WORKERS.  Must not be called from
+   a green thread. */
+void green_run(int workers_cnt) {
+  tid_t tids[GREEN_MAX_WORKERS];
+  int i;
+
+  if (workers_cnt < 1)
+    workers_cnt = 1;
+  if (workers_cnt > GREEN_MAX_WORKERS)
+    workers_cnt = GREEN_MAX_WORKERS;
+
+  for (i = 1; i < workers_cnt; i++)
+    tids[i] = pthread_create(worker_start, &workers[i]);
+  worker_loop(&workers[0]);
+  for (i = 1; i < workers_cnt; i++)
+    if (tids[i] != TID_ERROR)
+      pthread_join(tids[i]);
+}
+
+/* Returns the running green thread.  Must be called from a green
+   thread. */
+struct green_thread* green_self(void) {
+  uintptr_t sp;
+  struct green_thread* t;
+
+  asm("mov %%esp, %0" : "=g"(sp));
+  t = (struct green_thread*)(sp & ~(uintptr_t)(GREEN_STACK_SIZE - 1));
+  ASSERT(t->magic == GREEN_MAGIC);
+  return t;
+}
+
+/* Lets other ready green threads run.  Returns at once if there
+   are none. */
+void green_yield(void) {
+  struct green_thread* self = green_self();
+
+  /* An unlocked peek is only a hint, but a thread made ready
+     after it is at most one yield late. */
+  if (ready_queue.head == NULL)
+    return;
+
+  self->state = GREEN_READY;
+  switch_out(self);
+}
+
+/* Exits the running green thread. */
+void green_exit(void) {
+  struct green_thread* self = green_self();
+  self->state = GREEN_DYING;
+  switch_out(self);
+  NOT_REACHED();
+}
+
+/* Waits for green thread T to exit.  At most one thread may join
+   a given thread. */
+void green_join(struct green_thread* t) {
+  guard_acquire(&t->guard);
+  if (t->state == GREEN_DEAD) {
+    guard_release(&t->guard);
+    return;
+  }
+  ASSERT(t->joiner == NULL);
+  t->joiner = green_self();
+  block(&t->guard);
+}
+
+/* Initializes M as unlocked. */
+void green_mutex_init(struct green_mutex* m) {
+  m->guard = 0;
+  m->locked = false;
+  m->waiters.head = m->waiters.tail = NULL;
+}
+
+/* Acquires M, running other green threads while it is held. */
+void green_mutex_lock(struct green_mutex* m) {
+  guard_acquire(&m->guard);
+  if (!m->locked) {
+    m->locked = true;
+    guard_release(&m->guard);
+  } else {
+    /* green_mutex_unlock() hands M directly to us. */
+    queue_push(&m->waiters, green_self());
+    block(&m->guard);
+  }
+}
+
+/* Releases M, handing it to the longest waiter, if any. */
+void green_mutex_unlock(struct green_mutex* m) {
+  struct green_thread* t;
+
+  guard_acquire(&m->guard);
+  ASSERT(m->locked);
+  t = queue_pop(&m->waiters);
+  if (t == NULL)
+    m->locked = false;
+  guard_release(&m->guard);
+  if (t != NULL)
+    make_ready(t);
+}
+
+/* Initializes CH to buffer up to CAPACITY messages in BUF. */
+void green_chan_init(struct green_channel* ch, void** buf, size_t capacity) {
+  ASSERT(buf != NULL && capacity > 0);
+  ch->guard = 0;
+  ch->buf = buf;
+  ch->capacity = capacity;
+  ch->head = ch->count = 0;
+  ch->senders.head = ch->senders.tail = NULL;
+  ch->receivers.head = ch->receivers.tail = NULL;
+}
+
+/* Sends MSG on CH, running other green threads while CH is
+   full. */
+void green_chan_send(struct green_channel* ch, void* msg) {
+  struct green_thread* receiver;
+
+  guard_acquire(&ch->guard);
+  while (ch->count == ch->capacity) {
+    queue_push(&ch->senders, green_self());
+    block(&ch->guard);
+    guard_acquire(&ch->guard);
+  }
+  ch->buf[(ch->head + ch->count) % ch->capacity] = msg;
+  ch->count++;
+  receiver = queue_pop(&ch->receivers);
+  guard_release(&ch->guard);
+  if (receiver != NULL)
+    make_ready(receiver);
+}
+
+/* Receives and returns the oldest message on CH, running other
+   green threads while CH is empty. */
+void* green_chan_recv(struct green_channel* ch) {
+  struct green_thread* sender;
+  void* msg;
+
+  guard_acquire(&ch->guard);
+  while (ch->count == 0) {
+    queue_push(&ch->receivers, green_self());
+    block(&ch->guard);
+    guard_acquire(&ch->guard);
+  }
+  msg = ch->buf[ch->head];
+  ch->head = (ch->head + 1) % ch->capacity;
+  ch->count--;
+  sender = queue_pop(&ch->senders);
+  guard_release(&ch->guard);
+  if (sender != NULL)
+    make_ready(sender);
+  return msg;
+}
@@ -0,0 +1,76 @@
+#ifndef __LIB_USER_GREEN_H
+#define __LIB_USER_GREEN_H
+
+#include <debug.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Green threads: an M:N threading runtime in the user library.
+
+   Any number of green threads are multiplexed onto a few kernel
+   threads ("workers").  Switching between green threads never
+   enters the kernel; a worker sleeps in futex_wait() only when
+   it finds nothing to run.  Scheduling is cooperative: a green
+   thread runs until it yields, blocks, or exits.
+
+   Each green thread runs on a stack supplied by its creator.
+   The stack must be GREEN_STACK_SIZE bytes long and aligned on a
+   GREEN_STACK_SIZE boundary, because the thread's control block
+   lives at its base and green_self() finds it by rounding down
+   the stack pointer, e.g.:
+
+        static char stack[GREEN_STACK_SIZE]
+          __attribute__((aligned(GREEN_STACK_SIZE)));
+
+   A stack may be reused once green_join() on its thread has
+   returned, or once green_run() has returned. */
+
+#define GREEN_STACK_SIZE 8192 /* Bytes per green thread stack. */
+#define GREEN_MAX_WORKERS 8   /* Maximum kernel threads per run. */
+
+typedef void green_fun(void* aux);
+
+struct green_thread;
+
+/* FIFO of green threads. */
+struct green_queue {
+  struct green_thread* head;
+  struct green_thread* tail;
+};
+
+/* Mutex for green threads.  Blocking on it switches to another
+   green thread instead of sleeping the kernel thread. */
+struct green_mutex {
+  int guard;                  /* Protects the members below. */
+  bool locked;                /* Held by some green thread? */
+  struct green_queue waiters; /* Green threads waiting for it. */
+};
+
+/* Bounded channel of pointers between green threads. */
+struct green_channel {
+  int guard;                  /* Protects the members below. */
+  void** buf;                 /* Ring buffer of CAPACITY slots. */
+  size_t capacity;            /* Number of slots in BUF. */
+  size_t head;                /* Index of the oldest message. */
+  size_t count;               /* Number of messages in BUF. */
+  struct green_queue senders; /* Blocked in green_chan_send(). */
+  struct green_queue receivers; /* Blocked in green_chan_recv(). */
+};
+
+struct green_thread* green_create(void* stack, green_fun*, void* aux);
+void green_run(int workers);
+struct green_thread* green_self(void);
+void green_yield(void);
+void green_exit(void) NO_RETURN;
+void green_join(struct green_thread*);
+
+void green_mutex_init(struct green_mutex*);
+void green_mutex_lock(struct green_mutex*);
+void green_mutex_unlock(struct green_mutex*);
+
+void green_chan_init(struct green_channel*, void** buf, size_t capacity);
+void green_chan_send(struct green_channel*, void* msg);
+void* green_chan_recv(struct green_channel*);
+
+#endif /* lib/user/green.h */
@@ -1,5 +1,14 @@
 #include <pthread.h>
 #include <syscall.h>
+#include "atomic.h"
+
+/* Offsets of the words the kernel fills in at the start of each
+   thread's TLS block. */
+#define TLS_SELF 0 /* Address of the block itself. */
+#define TLS_TID 4  /* Thread's TID. */
+
+/* Offset of the first unallocated byte in every TLS block. */
+static int tls_next = 8;
 
 void _pthread_start_stub(pthread_fun fun, void* arg);
 
@@ -27,3 +36,35 @@ void _pthread_start_stub(pthread_fun fun, void* arg) {
   (*fun)(arg);    // Invoke the thread function
   pthread_exit(); // Call pthread_exit
 }
+
+/* Returns the TID of the running thread, without a system call. */
+tid_t pthread_self(void) {
+  tid_t tid;
+  asm("movl %%gs:%c1, %0" : "=r"(tid) : "i"(TLS_TID));
+  return tid;
+}
+
+/* Reserves SIZE bytes, rounded up to a multiple of 4, at the same
+   offset in every thread's TLS block, for a per-thread variable.
+   Every thread, existing or future, sees the variable initially
+   zeroed.  Returns the offset to pass to pthread_tls_get(), or 0
+   if the blocks are full. */
+size_t pthread_tls_alloc(size_t size) {
+  int ofs;
+
+  size = (size + 3) & ~(size_t)3;
+  do {
+    ofs = tls_next;
+    if (size > PTHREAD_TLS_SIZE - (size_t)ofs)
+      return 0;
+  } while (atomic_cmpxchg(&tls_next, ofs, ofs + size) != ofs);
+  return ofs;
+}
+
+/* Returns the running thread's copy of the per-thread variable
+   at OFFSET, as returned by pthread_tls_alloc(). */
+void* pthread_tls_get(size_t offset) {
+  uint8_t* tls;
+  asm("movl %%gs:%c1, %0" : "=r"(tls) : "i"(TLS_SELF));
+  return tls + offset;
+}
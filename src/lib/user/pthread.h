@@ -3,6 +3,8 @@
 
 #include <debug.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /* Thread identifiers and thread function */
 typedef void (*pthread_fun)(void*);
@@ -10,8 +12,26 @@ typedef void (*stub_fun)(pthread_fun, void*);
 typedef int tid_t;
 #define TID_ERROR ((tid_t)-1)
 
+/* Each thread's user stack occupies its own fixed-size slot
+   below PHYS_BASE, the main thread's first.  Must agree with
+   MAX_STACK_PAGES in userprog/process.h. */
+#define PTHREAD_STACK_TOP ((uintptr_t)0xc0000000)
+#define PTHREAD_STACK_SIZE ((uintptr_t)(1 << 11) * 4096)
+
+/* Each thread has a TLS block of PTHREAD_TLS_SIZE bytes at the
+   top of its stack slot, addressed through %gs.  The kernel
+   zeroes it when the thread starts and stores the block's own
+   address and the thread's TID in its first two words.  Must
+   agree with USER_TLS_SIZE in userprog/process.h. */
+#define PTHREAD_TLS_SIZE 512
+
 tid_t pthread_create(pthread_fun fun, void* arg);
 void pthread_exit(void) NO_RETURN;
 bool pthread_join(tid_t);
+tid_t pthread_self(void);
+
+/* Per-thread variables, in the spirit of __thread. */
+size_t pthread_tls_alloc(size_t size);
+void* pthread_tls_get(size_t offset);
 
 #endif /* lib/user/pthread.h */
@@ -0,0 +1,112 @@
+#include <syscall.h>
+#include <pthread.h>
+#include <stddef.h>
+#include "atomic.h"
+
+/* User-level locks and semaphores.
+
+   Both are a few words of user memory updated with atomic
+   instructions.  Acquiring a free lock, releasing a lock nobody
+   is waiting for, and downing or upping a semaphore that does
+   not need to block never enter the kernel.  Only a thread that
+   must sleep calls futex_wait(), and only a thread that knows of
+   a sleeper calls futex_wake(). */
+
+#define LOCK_MAGIC 0x6c6f636b /* "lock" */
+#define SEMA_MAGIC 0x73656d61 /* "sema" */
+
+/* Lock states. */
+#define LOCK_FREE 0      /* Not held. */
+#define LOCK_HELD 1      /* Held, nobody waiting. */
+#define LOCK_CONTENDED 2 /* Held, possibly with waiters. */
+
+/* Initializes LOCK.  Returns false if LOCK is a null pointer. */
+bool lock_init(lock_t* lock) {
+  if (lock == NULL)
+    return false;
+  lock->state = LOCK_FREE;
+  lock->owner = 0;
+  lock->magic = LOCK_MAGIC;
+  return true;
+}
+
+/* Acquires LOCK, sleeping until it becomes available if
+   necessary.  Exits the process with status 1 if LOCK was never
+   initialized or is already held by the running thread. */
+void lock_acquire(lock_t* lock) {
+  int self = pthread_self();
+  int c;
+
+  if (lock == NULL || lock->magic != LOCK_MAGIC || lock->owner == self)
+    exit(1);
+
+  c = atomic_cmpxchg(&lock->state, LOCK_FREE, LOCK_HELD);
+  if (c != LOCK_FREE) {
+    /* Contended: mark the lock so that its holder wakes us on
+       release, then sleep until we find it free. */
+    if (c != LOCK_CONTENDED)
+      c = atomic_xchg(&lock->state, LOCK_CONTENDED);
+    while (c != LOCK_FREE) {
+      futex_wait(&lock->state, LOCK_CONTENDED);
+      c = atomic_xchg(&lock->state, LOCK_CONTENDED);
+    }
+  }
+  lock->owner = self;
+}
+
+/* Releases LOCK, waking one waiter if there may be any.  Exits
+   the process with status 1 if LOCK was never initialized or is
+   not held by the running thread. */
+void lock_release(lock_t* lock) {
+  if (lock == NULL || lock->magic != LOCK_MAGIC || lock->state == LOCK_FREE ||
+      lock->owner != pthread_self())
+    exit(1);
+
+  lock->owner = 0;
+  if (atomic_xchg(&lock->state, LOCK_FREE) == LOCK_CONTENDED)
+    futex_wake(&lock->state, 1);
+}
+
+/* Initializes SEMA to VAL.  Returns false if SEMA is a null
+   pointer or VAL is negative. */
+bool sema_init(sema_t* sema, int val) {
+  if (sema == NULL || val < 0)
+    return false;
+  sema->value = val;
+  sema->waiters = 0;
+  sema->magic = SEMA_MAGIC;
+  return true;
+}
+
+/* Waits for SEMA's value to become positive and then
+   atomically decrements it.  Exits the process with status 1 if
+   SEMA was never initialized. */
+void sema_down(sema_t* sema) {
+  if (sema == NULL || sema->magic != SEMA_MAGIC)
+    exit(1);
+
+  for (;;) {
+    int v = sema->value;
+    if (v > 0) {
+      if (atomic_cmpxchg(&sema->value, v, v - 1) == v)
+        return;
+    } else {
+      /* futex_wait() returns at once if an up raced with us. */
+      atomic_fetch_add(&sema->waiters, 1);
+      futex_wait(&sema->value, 0);
+      atomic_fetch_add(&sema->waiters, -1);
+    }
+  }
+}
+
+/* Increments SEMA's value and wakes one sleeping thread, if
+   any.  Exits the process with status 1 if SEMA was never
+   initialized. */
+void sema_up(sema_t* sema) {
+  if (sema == NULL || sema->magic != SEMA_MAGIC)
+    exit(1);
+
+  atomic_fetch_add(&sema->value, 1);
+  if (sema->waiters > 0)
+    futex_wake(&sema->value, 1);
+}
@@ -78,6 +78,8 @@ void exit(int status) {
 
 pid_t exec(const char* file) { return (pid_t)syscall1(SYS_EXEC, file); }
 
+pid_t fork(void) { return (pid_t)syscall0(SYS_FORK); }
+
 int wait(pid_t pid) { return syscall1(SYS_WAIT, pid); }
 
 bool create(const char* file, unsigned initial_size) {
@@ -129,38 +131,22 @@ void sys_pthread_exit() {
 
 tid_t sys_pthread_join(tid_t tid) { return syscall1(SYS_PT_JOIN, tid); }
 
-bool lock_init(lock_t* lock) { return syscall1(SYS_LOCK_INIT, lock); }
+tid_t get_tid(void) { return syscall0(SYS_GET_TID); }
 
-void lock_acquire(lock_t* lock) {
-  bool success = syscall1(SYS_LOCK_ACQUIRE, lock);
-  if (!success)
-    exit(1);
-}
+int futex_wait(int* addr, int val) { return syscall2(SYS_FUTEX_WAIT, addr, val); }
 
-void lock_release(lock_t* lock) {
-  bool success = syscall1(SYS_LOCK_RELEASE, lock);
-  if (!success)
-    exit(1);
-}
+int futex_wake(int* addr, int cnt) { return syscall2(SYS_FUTEX_WAKE, addr, cnt); }
 
-bool sema_init(sema_t* sema, int val) { return syscall2(SYS_SEMA_INIT, sema, val); }
+unsigned int cache_hit_cnt(void) { return syscall0(SYS_CACHE_HIT); }
 
-void sema_down(sema_t* sema) {
-  bool success = syscall1(SYS_SEMA_DOWN, sema);
-  if (!success)
-    exit(1);
-}
+void cache_reset(void) { syscall0(SYS_CACHE_RESET); }
 
-void sema_up(sema_t* sema) {
-  bool success = syscall1(SYS_SEMA_UP, sema);
-  if (!success)
-    exit(1);
-}
+unsigned int fs_device_write_cnt(void) { return syscall0(SYS_BLOCK_WRITE); }
 
-tid_t get_tid(void) { return syscall0(SYS_GET_TID); }
+bool memstat(int tag, struct memstat* st) { return syscall2(SYS_MEMSTAT, tag, st); }
 
-unsigned int cache_hit_cnt(void) { return syscall0(SYS_CACHE_HIT); }
+bool heapstat(int class, struct heapstat* st) { return syscall2(SYS_HEAPSTAT, class, st); }
 
-void cache_reset(void) { syscall0(SYS_CACHE_RESET); }
+bool swapstat(struct swapstat* st) { return syscall1(SYS_SWAPSTAT, st); }
 
-unsigned int fs_device_write_cnt(void) { return syscall0(SYS_BLOCK_WRITE); }
+void getrusage(struct rusage* ru) { syscall1(SYS_GETRUSAGE, ru); }
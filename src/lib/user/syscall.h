@@ -3,15 +3,28 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <memstat.h>
+#include <rusage.h>
 #include <pthread.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t)-1)
 
-/* Synchronization Types */
-typedef char lock_t;
-typedef char sema_t;
+/* Synchronization Types.  Both live entirely in user memory and
+   only enter the kernel, through futex_wait() and futex_wake(),
+   when a thread has to sleep or wake a sleeper (see synch.c). */
+typedef struct {
+  int state;      /* 0: free, 1: held, 2: held and maybe contended. */
+  int owner;      /* Holder's thread identity, 0 if free. */
+  unsigned magic; /* Detects uninitialized locks. */
+} lock_t;
+
+typedef struct {
+  int value;      /* Current value. */
+  int waiters;    /* Number of threads sleeping in sema_down(). */
+  unsigned magic; /* Detects uninitialized semaphores. */
+} sema_t;
 
 /* Map region identifier. */
 typedef int mapid_t;
@@ -28,6 +41,7 @@ typedef int mapid_t;
 void halt(void) NO_RETURN;
 void exit(int status) NO_RETURN;
 pid_t exec(const char* file);
+pid_t fork(void);
 int wait(pid_t);
 bool create(const char* file, unsigned initial_size);
 bool remove(const char* file);
@@ -50,10 +64,16 @@ bool sema_init(sema_t* sema, int val);
 void sema_down(sema_t* sema);
 void sema_up(sema_t* sema);
 tid_t get_tid(void);
+int futex_wait(int* addr, int val);
+int futex_wake(int* addr, int cnt);
 
 unsigned int cache_hit_cnt(void);
 void cache_reset(void);
 unsigned int fs_device_write_cnt(void);
+bool memstat(int tag, struct memstat*);
+bool heapstat(int class, struct heapstat*);
+bool swapstat(struct swapstat*);
+void getrusage(struct rusage*);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap(int fd, void* addr);
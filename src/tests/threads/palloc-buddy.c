@@ -0,0 +1,104 @@
+/* Checks that the buddy page allocator gives back the unused
+   tail of a non-power-of-2 request and merges freed blocks, then
+   times allocations in a kernel pool riddled with single-page
+   holes.  For comparison, it times the same requests against a
+   bitmap with the same holes, scanned from the start as the old
+   allocator did. */
+
+#include <bitmap.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define HOLE_CNT 1024 /* Single-page holes to punch. */
+#define REQ_CNT 64    /* Timed requests of each size. */
+
+static void* pages[2 * HOLE_CNT];
+static void* reqs[REQ_CNT];
+
+/* Times REQ_CNT palloc requests of PAGE_CNT pages each and
+   returns the average in cycles.  Frees them afterward. */
+static uint64_t time_palloc(size_t page_cnt) {
+  uint64_t start, total;
+  int i;
+
+  start = timer_cycles();
+  for (i = 0; i < REQ_CNT; i++)
+    reqs[i] = palloc_get_multiple(PAL_ASSERT, page_cnt);
+  total = timer_cycles() - start;
+  for (i = 0; i < REQ_CNT; i++)
+    palloc_free_multiple(reqs[i], page_cnt);
+  return total / REQ_CNT;
+}
+
+/* Times REQ_CNT first-fit scans of BM for PAGE_CNT pages each
+   and returns the average in cycles.  Clears them afterward. */
+static uint64_t time_bitmap(struct bitmap* bm, size_t page_cnt) {
+  size_t idx[REQ_CNT];
+  uint64_t start, total;
+  int i;
+
+  start = timer_cycles();
+  for (i = 0; i < REQ_CNT; i++)
+    idx[i] = bitmap_scan_and_flip(bm, 0, page_cnt, false);
+  total = timer_cycles() - start;
+  for (i = 0; i < REQ_CNT; i++)
+    if (idx[i] != BITMAP_ERROR)
+      bitmap_set_multiple(bm, idx[i], page_cnt, false);
+  return total / REQ_CNT;
+}
+
+void test_palloc_buddy(void) {
+  struct palloc_stats before, after;
+  struct bitmap* bm;
+  size_t used;
+  void* p;
+  int i;
+
+  /* A 3-page request takes exactly 3 pages, and freeing it
+     restores the pool. */
+  palloc_get_stats(0, &before);
+  p = palloc_get_multiple(PAL_ASSERT, 3);
+  palloc_get_stats(0, &after);
+  if (before.free_cnt - after.free_cnt != 3)
+    fail("3-page request took %zu pages", before.free_cnt - after.free_cnt);
+  palloc_free_multiple(p, 3);
+  palloc_get_stats(0, &after);
+  if (after.free_cnt != before.free_cnt || after.largest_free != before.largest_free)
+    fail("freed blocks did not merge back");
+  msg("Odd-sized request trimmed and merged back.");
+
+  /* Punch HOLE_CNT single-page holes. */
+  for (i = 0; i < 2 * HOLE_CNT; i++)
+    pages[i] = palloc_get_page(PAL_ASSERT);
+  for (i = 0; i < 2 * HOLE_CNT; i += 2)
+    palloc_free_page(pages[i]);
+
+  /* Build a bitmap with the same layout: the pages in use
+     before we started, then alternating holes. */
+  used = before.page_cnt - before.free_cnt;
+  bm = bitmap_create(before.page_cnt);
+  if (bm == NULL)
+    fail("bitmap_create failed");
+  bitmap_set_multiple(bm, 0, used, true);
+  for (i = 0; i < 2 * HOLE_CNT; i += 2)
+    bitmap_mark(bm, used + i + 1);
+
+  printf("1-page: buddy %llu cycles, bitmap scan %llu cycles\n", time_palloc(1),
+         time_bitmap(bm, 1));
+  printf("4-page: buddy %llu cycles, bitmap scan %llu cycles\n", time_palloc(4),
+         time_bitmap(bm, 4));
+  palloc_print_stats();
+
+  bitmap_destroy(bm);
+  for (i = 1; i < 2 * HOLE_CNT; i += 2)
+    palloc_free_page(pages[i]);
+  palloc_get_stats(0, &after);
+  if (after.free_cnt != before.free_cnt)
+    fail("%zu pages leaked", before.free_cnt - after.free_cnt);
+  msg("All pages returned.");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# Timings and pool statistics vary from run to run.
+grep (/^\d+-page: buddy \d+ cycles, bitmap scan \d+ cycles$/, @output) == 2
+  or fail "Allocation timings missing from output.\n";
+@output = grep (!/cycles|pages free|pages pre-zeroed/, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Odd-sized request trimmed and merged back.
+(palloc-buddy) All pages returned.
+(palloc-buddy) end
+EOF
+pass;
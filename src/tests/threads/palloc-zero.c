@@ -0,0 +1,55 @@
+/* Drains the kernel pool's pre-zeroed page stock below its low
+   watermark, checks that every PAL_ZERO page really is zero even
+   after the stock runs out, and checks that the pagezero thread
+   refills the stock once the system goes idle. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 80
+
+static uint8_t* pages[PAGE_CNT];
+
+/* Returns true if all of PAGE is zero. */
+static bool is_zero(const uint8_t* page) {
+  size_t i;
+  for (i = 0; i < PGSIZE; i++)
+    if (page[i] != 0)
+      return false;
+  return true;
+}
+
+void test_palloc_zero(void) {
+  struct palloc_stats before, after;
+  int i;
+
+  /* Give the pagezero thread time to fill the stock. */
+  timer_sleep(100);
+  palloc_get_stats(0, &before);
+  if (before.zeroed_cnt == 0)
+    fail("no pre-zeroed pages after going idle");
+
+  for (i = 0; i < PAGE_CNT; i++) {
+    pages[i] = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+    if (!is_zero(pages[i]))
+      fail("PAL_ZERO page %d is not zero", i);
+    memset(pages[i], 0x5a, PGSIZE);
+  }
+  palloc_get_stats(0, &after);
+  if (after.zero_hits == before.zero_hits)
+    fail("no PAL_ZERO request was served from the stock");
+  msg("%d PAL_ZERO pages were all zero.", PAGE_CNT);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page(pages[i]);
+  timer_sleep(100);
+  palloc_get_stats(0, &after);
+  if (after.zeroed_cnt != before.zeroed_cnt)
+    fail("stock refilled to %zu pages, not %zu", after.zeroed_cnt, before.zeroed_cnt);
+  msg("Stock refilled while idle.");
+}
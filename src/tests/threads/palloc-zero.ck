@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) 80 PAL_ZERO pages were all zero.
+(palloc-zero) Stock refilled while idle.
+(palloc-zero) end
+EOF
+pass;
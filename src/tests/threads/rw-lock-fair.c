@@ -0,0 +1,69 @@
+/* Checks that a phase-fair readers-writers lock alternates
+   between reader and writer phases.
+
+   The main thread holds the lock for reading while a writer, a
+   reader, another writer, and another reader queue up behind it,
+   in that order.  When the main thread releases the lock, the
+   first writer must run next, then both waiting readers together
+   (even though the second reader arrived after the second
+   writer), and finally the second writer. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rw_thread_data {
+  int id;                  /* Reader or writer ID. */
+  bool reader;             /* Acquire for reading or writing? */
+  struct rw_lock* rw_lock; /* Lock under test. */
+  struct semaphore* done;  /* Upped once the lock is released. */
+};
+
+static thread_func rw_thread_func;
+
+void test_rw_lock_fair(void) {
+  struct rw_thread_data data[4];
+  struct rw_lock rw_lock;
+  struct semaphore done;
+  int i;
+
+  /* The queueing order below relies on FIFO scheduling. */
+  ASSERT(active_sched_policy == SCHED_FIFO);
+
+  rw_lock_init_fair(&rw_lock);
+  sema_init(&done, 0);
+
+  rw_lock_acquire(&rw_lock, RW_READER);
+  for (i = 0; i < 4; i++) {
+    struct rw_thread_data* d = data + i;
+    char name[16];
+
+    d->reader = i % 2 == 1;
+    d->id = i / 2 + (d->reader ? 0 : 1);
+    d->rw_lock = &rw_lock;
+    d->done = &done;
+    snprintf(name, sizeof name, "%s %d", d->reader ? "reader" : "writer", d->id);
+    thread_create(name, PRI_DEFAULT, rw_thread_func, d);
+
+    /* Let the new thread run until it blocks on the lock. */
+    thread_yield();
+  }
+  rw_lock_release(&rw_lock, RW_READER);
+
+  for (i = 0; i < 4; i++)
+    sema_down(&done);
+}
+
+static void rw_thread_func(void* d_) {
+  struct rw_thread_data* d = d_;
+
+  rw_lock_acquire(d->rw_lock, d->reader);
+  msg("%s %d acquired.", d->reader ? "Reader" : "Writer", d->id);
+
+  /* Let the rest of a reader batch in before releasing. */
+  thread_yield();
+  rw_lock_release(d->rw_lock, d->reader);
+  sema_up(d->done);
+}
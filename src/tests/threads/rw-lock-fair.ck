@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rw-lock-fair) begin
+(rw-lock-fair) Writer 1 acquired.
+(rw-lock-fair) Reader 0 acquired.
+(rw-lock-fair) Reader 1 acquired.
+(rw-lock-fair) Writer 2 acquired.
+(rw-lock-fair) end
+EOF
+pass;
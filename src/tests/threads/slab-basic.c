@@ -0,0 +1,65 @@
+/* Allocates many objects from a kmem_cache with a constructor
+   and checks that they are distinct, constructed exactly once,
+   and that a freed object is reused without reconstruction. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 200
+#define OBJ_MAGIC 0x0b1ec7ed
+
+/* An object with an awkward size for malloc(). */
+struct test_obj {
+  unsigned magic; /* Set by the constructor. */
+  int id;         /* Set by the test. */
+  char pad[92];
+};
+
+static int ctor_cnt;
+
+static void test_obj_ctor(void* obj_) {
+  struct test_obj* obj = obj_;
+  obj->magic = OBJ_MAGIC;
+  ctor_cnt++;
+}
+
+void test_slab_basic(void) {
+  static struct test_obj* objs[OBJ_CNT];
+  static struct kmem_cache cache; /* Stays on the list of caches. */
+  struct test_obj* again;
+  int i, carved;
+
+  kmem_cache_create(&cache, "test_obj", MT_OTHER, sizeof(struct test_obj), test_obj_ctor);
+
+  for (i = 0; i < OBJ_CNT; i++) {
+    objs[i] = kmem_cache_alloc(&cache);
+    if (objs[i] == NULL)
+      fail("allocation %d failed", i);
+    if (objs[i]->magic != OBJ_MAGIC)
+      fail("object %d was not constructed", i);
+    objs[i]->id = i;
+  }
+  for (i = 0; i < OBJ_CNT; i++)
+    if (objs[i]->id != i)
+      fail("object %d overlaps another object", i);
+  if (ctor_cnt < OBJ_CNT)
+    fail("constructor ran only %d times for %d objects", ctor_cnt, OBJ_CNT);
+  msg("Allocated %d distinct constructed objects.", OBJ_CNT);
+
+  carved = ctor_cnt;
+  kmem_cache_free(&cache, objs[OBJ_CNT / 2]);
+  again = kmem_cache_alloc(&cache);
+  if (again != objs[OBJ_CNT / 2])
+    fail("freed object was not reused");
+  if (ctor_cnt != carved || again->magic != OBJ_MAGIC)
+    fail("reused object was reconstructed");
+  msg("Freed object reused without reconstruction.");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free(&cache, objs[i]);
+  if (cache.obj_cnt != 0 || cache.slab_cnt != 1)
+    fail("%zu objects in %zu slabs left after freeing all", cache.obj_cnt, cache.slab_cnt);
+  msg("All but one slab returned.");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-basic) begin
+(slab-basic) Allocated 200 distinct constructed objects.
+(slab-basic) Freed object reused without reconstruction.
+(slab-basic) All but one slab returned.
+(slab-basic) end
+EOF
+pass;
@@ -52,5 +52,9 @@ extern test_func test_smfs_hierarchy_16;
 extern test_func test_smfs_hierarchy_32;
 extern test_func test_smfs_hierarchy_64;
 extern test_func test_smfs_hierarchy_256;
+extern test_func test_rw_lock_fair;
+extern test_func test_slab_basic;
+extern test_func test_palloc_buddy;
+extern test_func test_palloc_zero;
 
 #endif /* tests/threads/tests.h */
@@ -0,0 +1,25 @@
+/* Forks a child that overwrites a global and a local variable,
+   and checks that the parent still sees its own values. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int global = 42;
+
+void test_main(void) {
+  int local = 7;
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    if (global != 42 || local != 7)
+      fail("child sees global=%d local=%d", global, local);
+    global = 1;
+    local = 2;
+    exit(81);
+  }
+  if (pid == PID_ERROR)
+    fail("fork failed");
+  CHECK(wait(pid) == 81, "wait for child");
+  CHECK(global == 42 && local == 7, "parent still sees its own values");
+}
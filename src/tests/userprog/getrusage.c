@@ -0,0 +1,26 @@
+/* Reads the process's resource usage around a few system calls
+   and checks that they were counted. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void) {
+  struct rusage before, after;
+  char buf[16] = "rusage";
+  int fd, i;
+
+  CHECK(create("data", sizeof buf), "create \"data\"");
+  CHECK((fd = open("data")) > 1, "open \"data\"");
+  getrusage(&before);
+  for (i = 0; i < 3; i++)
+    write(fd, buf, sizeof buf);
+  getrusage(&after);
+  close(fd);
+
+  CHECK(after.syscalls[SYS_WRITE] - before.syscalls[SYS_WRITE] == 3, "counted 3 writes");
+  CHECK(after.syscalls[SYS_GETRUSAGE] == 2, "counted 2 getrusage calls");
+  CHECK(after.resident_pages > 0 && after.peak_resident_pages >= after.resident_pages,
+        "resident pages counted");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) create "data"
+(getrusage) open "data"
+(getrusage) counted 3 writes
+(getrusage) counted 2 getrusage calls
+(getrusage) resident pages counted
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Reads the kernel's memory statistics, which the kernel keeps
+   when booted with -memtag, and checks them for consistency. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void) {
+  struct memstat ms;
+  struct heapstat hs;
+  bool user_live = false;
+  size_t block_size = 0;
+  int i;
+
+  for (i = 0; memstat(i, &ms); i++) {
+    if (ms.live_bytes > ms.peak_bytes)
+      fail("%s: %zu bytes live but only %zu peak", ms.name, ms.live_bytes, ms.peak_bytes);
+    if (ms.free_cnt > ms.alloc_cnt)
+      fail("%s: %zu frees but only %zu allocs", ms.name, ms.free_cnt, ms.alloc_cnt);
+    if (!strcmp(ms.name, "user") && ms.live_bytes > 0)
+      user_live = true;
+  }
+  CHECK(i > 0, "memstat reports memory tags");
+  CHECK(user_live, "our own pages are tagged as user memory");
+
+  for (i = 0; heapstat(i, &hs); i++) {
+    if (hs.block_size <= block_size)
+      fail("size class %d is not larger than the one before", i);
+    if (hs.used_cnt > hs.arena_cnt * hs.blocks_per_arena)
+      fail("%zu-byte blocks: %zu used but only %zu exist", hs.block_size, hs.used_cnt,
+           hs.arena_cnt * hs.blocks_per_arena);
+    if (hs.arena_cnt > hs.peak_arena_cnt)
+      fail("%zu-byte blocks: %zu arenas but only %zu peak", hs.block_size, hs.arena_cnt,
+           hs.peak_arena_cnt);
+    block_size = hs.block_size;
+  }
+  CHECK(i > 0, "heapstat reports size classes");
+  CHECK(!memstat(-1, &ms) && !heapstat(i, &hs), "out-of-range queries fail");
+}
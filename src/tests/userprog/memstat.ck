@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(memstat) begin
+(memstat) memstat reports memory tags
+(memstat) our own pages are tagged as user memory
+(memstat) heapstat reports size classes
+(memstat) out-of-range queries fail
+(memstat) end
+memstat: exit(0)
+EOF
+pass;
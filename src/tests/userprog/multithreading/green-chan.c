@@ -0,0 +1,54 @@
+/* Runs producers and a consumer as green threads on three
+   kernel threads.  The producers send over a small channel and
+   bump a counter under a green mutex, yielding inside the
+   critical section to force contention. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <green.h>
+
+#define NUM_PRODUCERS 4
+#define NUM_MSGS 50
+#define NUM_WORKERS 3
+
+static char stacks[NUM_PRODUCERS + 1][GREEN_STACK_SIZE]
+    __attribute__((aligned(GREEN_STACK_SIZE)));
+
+static struct green_channel chan;
+static void* chan_buf[4];
+static struct green_mutex mutex;
+static int counter;
+static int sum;
+
+static void producer(void* aux UNUSED) {
+  for (int i = 1; i <= NUM_MSGS; i++) {
+    green_mutex_lock(&mutex);
+    int c = counter;
+    green_yield();
+    counter = c + 1;
+    green_mutex_unlock(&mutex);
+
+    green_chan_send(&chan, (void*)i);
+  }
+}
+
+static void consumer(void* aux UNUSED) {
+  for (int i = 0; i < NUM_PRODUCERS * NUM_MSGS; i++)
+    sum += (int)green_chan_recv(&chan);
+}
+
+void test_main(void) {
+  green_chan_init(&chan, chan_buf, sizeof chan_buf / sizeof *chan_buf);
+  green_mutex_init(&mutex);
+
+  if (green_create(stacks[0], consumer, NULL) == NULL)
+    fail("green_create failed");
+  for (int i = 1; i <= NUM_PRODUCERS; i++)
+    if (green_create(stacks[i], producer, NULL) == NULL)
+      fail("green_create failed");
+
+  green_run(NUM_WORKERS);
+
+  msg("counter is %d", counter);
+  msg("sum is %d", sum);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(green-chan) begin
+(green-chan) counter is 200
+(green-chan) sum is 5100
+(green-chan) end
+green-chan: exit(0)
+EOF
+pass;
@@ -0,0 +1,62 @@
+/* Checks that pthread_self() matches the kernel's idea of each
+   thread's TID and that per-thread variables stay private to
+   their threads while all of them are alive at once. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <syscall.h>
+#include <pthread.h>
+
+#define NUM_THREADS 5
+
+static size_t var;
+static sema_t started;
+static sema_t go;
+static tid_t self_tids[NUM_THREADS];
+static bool ok[NUM_THREADS];
+
+void thread_function(void* arg_);
+
+/* Stores a value private to this thread, waits until every
+   thread has done the same, and checks that its value is
+   intact. */
+void thread_function(void* arg_) {
+  int i = (int)arg_;
+  int* mine = pthread_tls_get(var);
+
+  ok[i] = *mine == 0 && pthread_self() == get_tid();
+  *mine = i + 100;
+  self_tids[i] = pthread_self();
+  sema_up(&started);
+  sema_down(&go);
+  ok[i] = ok[i] && *(int*)pthread_tls_get(var) == i + 100;
+}
+
+void test_main(void) {
+  tid_t tids[NUM_THREADS];
+
+  var = pthread_tls_alloc(sizeof(int));
+  if (var == 0)
+    fail("pthread_tls_alloc failed");
+  if (pthread_self() != get_tid())
+    fail("pthread_self() disagrees with get_tid() in main");
+  *(int*)pthread_tls_get(var) = -1;
+
+  sema_check_init(&started, 0);
+  sema_check_init(&go, 0);
+  for (int i = 0; i < NUM_THREADS; i++)
+    tids[i] = pthread_check_create(thread_function, (void*)i);
+  for (int i = 0; i < NUM_THREADS; i++)
+    sema_down(&started);
+  for (int i = 0; i < NUM_THREADS; i++)
+    sema_up(&go);
+  for (int i = 0; i < NUM_THREADS; i++)
+    pthread_check_join(tids[i]);
+
+  for (int i = 0; i < NUM_THREADS; i++)
+    if (!ok[i] || self_tids[i] != tids[i])
+      fail("thread %d saw the wrong TID or TLS", i);
+  if (*(int*)pthread_tls_get(var) != -1)
+    fail("main thread's TLS was clobbered");
+  msg("PASS");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(tls-simple) begin
+(tls-simple) PASS
+(tls-simple) end
+tls-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,22 @@
+/* Opens a file three times, closes the middle descriptor, and
+   checks that the next open reuses it, since open() returns the
+   lowest free descriptor. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void) {
+  int h1, h2, h3, h4;
+
+  CHECK((h1 = open("sample.txt")) > 1, "open \"sample.txt\" once");
+  CHECK((h2 = open("sample.txt")) > 1, "open \"sample.txt\" twice");
+  CHECK((h3 = open("sample.txt")) > 1, "open \"sample.txt\" three times");
+  msg("close second descriptor");
+  close(h2);
+  CHECK((h4 = open("sample.txt")) > 1, "open \"sample.txt\" again");
+  if (h4 != h2)
+    fail("open() returned %d instead of freed %d", h4, h2);
+  if (h4 == h1 || h4 == h3)
+    fail("open() returned %d, which is still open", h4);
+}
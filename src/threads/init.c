@@ -20,8 +20,10 @@
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/memtag.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/rcu.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -40,6 +42,12 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t* init_page_dir;
@@ -60,6 +68,9 @@ static const char* swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -memtag: Track kernel memory by subsystem? */
+static bool track_memory;
+
 static void bss_init(void);
 static void paging_init(void);
 
@@ -94,6 +105,8 @@ int main(void) {
 
   /* Initialize memory system. */
   palloc_init(user_page_limit);
+  if (track_memory)
+    memtag_init();
   malloc_init();
   paging_init();
 
@@ -117,6 +130,8 @@ int main(void) {
   thread_start();
   serial_init_queue();
   timer_calibrate();
+  rcu_init();
+  palloc_start_zeroing();
 
 #ifdef USERPROG
   /* Give main thread a minimal PCB so it can launch the first process */
@@ -130,6 +145,12 @@ int main(void) {
   filesys_init(format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize virtual memory. */
+  frame_init();
+  swap_init();
+#endif
+
   printf("Boot complete.\n");
 
   /* Run actions specified on kernel command line. */
@@ -151,30 +172,74 @@ static void bss_init(void) {
   memset(&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* CPUID feature flags in EDX, leaf 1.  See [IA32-v2a] "CPUID". */
+#define CPUID_PSE 0x00000008 /* 4 MB pages. */
+#define CPUID_PGE 0x00002000 /* Global pages. */
+
+/* CR4 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE 0x00000010 /* Page Size Extensions. */
+#define CR4_PGE 0x00000080 /* Page Global Enable. */
+
+/* Returns the CPU's feature flags from CPUID leaf 1, EDX. */
+static uint32_t cpu_features(void) {
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+  return edx;
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   Where the CPU allows, every 4 MB of RAM that lies outside the
+   kernel's text is mapped by a single large-page PDE, and every
+   kernel mapping is global.  Every process's page directory
+   shares these mappings, so with both, the whole of kernel
+   memory fits in a handful of TLB entries that survive the CR3
+   reload of a switch between processes. */
 static void paging_init(void) {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpu_features();
+  bool large = (features & CPUID_PSE) != 0;
+  uint32_t global = (features & CPUID_PGE) != 0 ? PTE_G : 0;
 
-  pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+  pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO | PAL_TAG(MT_PAGEDIR));
   pt = NULL;
-  for (page = 0; page < init_ram_pages; page++) {
+  for (page = 0; page < init_ram_pages;) {
     uintptr_t paddr = page * PGSIZE;
     char* vaddr = ptov(paddr);
     size_t pde_idx = pd_no(vaddr);
     size_t pte_idx = pt_no(vaddr);
     bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+    /* The kernel's text stays in 4 kB pages, so that it can be
+       mapped read-only without taking the data around it along. */
+    if (large && pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages &&
+        (pde_idx < pd_no(&_start) || pde_idx > pd_no(&_end_kernel_text - 1))) {
+      pd[pde_idx] = pde_create_large(vaddr, true) | global;
+      page += PTSPAN / PGSIZE;
+      continue;
+    }
+
     if (pd[pde_idx] == 0) {
-      pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+      pt = palloc_get_page(PAL_ASSERT | PAL_ZERO | PAL_TAG(MT_PAGEDIR));
       pd[pde_idx] = pde_create(pt);
     }
 
-    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text);
+    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text) | global;
+    page++;
+  }
+
+  /* Turn on large and global pages before the page directory
+     that uses them. */
+  if (large || global) {
+    uint32_t cr4;
+    asm volatile("movl %%cr4, %0" : "=r"(cr4));
+    cr4 |= (large ? CR4_PSE : 0) | (global ? CR4_PGE : 0);
+    asm volatile("movl %0, %%cr4" : : "r"(cr4));
   }
 
   /* Store the physical address of the page directory into CR3
@@ -243,10 +308,16 @@ static char** parse_options(char** argv) {
 #ifdef VM
     else if (!strcmp(name, "-swap"))
       swap_bdev_name = value;
+    else if (!strcmp(name, "-fault-around"))
+      fault_around_pages = atoi(value) > 1 ? atoi(value) : 1;
+    else if (!strcmp(name, "-zswap"))
+      zswap_pool_pages = atoi(value) > 0 ? atoi(value) : 0;
 #endif
 #endif
     else if (!strcmp(name, "-rs"))
       random_init(atoi(value));
+    else if (!strcmp(name, "-memtag"))
+      track_memory = true;
     else if (!strcmp(name, "-sched")) {
       if (!strcmp(value, "fifo"))
         scheduler_flags[SCHED_FIFO] = 1;
@@ -262,6 +333,8 @@ static char** parse_options(char** argv) {
 #ifdef USERPROG
     else if (!strcmp(name, "-ul"))
       user_page_limit = atoi(value);
+    else if (!strcmp(name, "-rusage"))
+      print_rusage = true;
 #endif
     else
       PANIC("unknown option `%s' (use -h for help)", name);
@@ -422,9 +495,12 @@ static void usage(void) {
          "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
          "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+         "  -fault-around=N    Map up to N pages around each page fault (default 16).\n"
+         "  -zswap=N           Keep up to N pages of compressed swap in memory (default 64).\n"
 #endif // VM
 #endif // FILESYS
          "  -rs=SEED           Set random number seed to SEED.\n"
+         "  -memtag            Track kernel memory use by subsystem.\n"
          "  -sched-fair        Use alternate non-strict priority scheduler. Mutually exclusive "
          "with \"-sched-mlfqs\", \"-sched-prio\".\n"
          "  -sched-mlfqs       Use multi-level feedback queue scheduler. Mutually exclusive with "
@@ -433,6 +509,7 @@ static void usage(void) {
          "\"-sched-fair\", \"-sched-mlfqs\".\n"
 #ifdef USERPROG
          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+         "  -rusage            Print each process's resource usage when it exits.\n"
 #endif // USERPROG
   );
   shutdown_power_off();
@@ -11,6 +11,7 @@
 #include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Programmable Interrupt Controller (PIC) registers.
@@ -355,6 +356,13 @@ void intr_handler(struct intr_frame* frame) {
     if (yield_on_return)
       thread_yield();
   }
+
+#ifdef USERPROG
+  /* A thread whose process is being torn down must not return
+     to user mode. */
+  if (frame->cs == SEL_UCSEG)
+    process_check_exiting();
+#endif
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
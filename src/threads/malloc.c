@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/memtag.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -32,7 +33,12 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Arena pages are allocated as MT_HEAP, and each block as it is
+   handed out is recorded under the tag its caller passed to
+   malloc_tagged() or calloc_tagged(), or MT_OTHER for plain
+   malloc() and calloc().  See memtag.c. */
 
 /* Descriptor. */
 struct desc {
@@ -40,6 +46,9 @@ struct desc {
   size_t blocks_per_arena; /* Number of blocks in an arena. */
   struct list free_list;   /* List of free blocks. */
   struct lock lock;        /* Lock. */
+  size_t arena_cnt;        /* Arenas currently allocated. */
+  size_t peak_arena_cnt;   /* Maximum of ARENA_CNT. */
+  size_t used_cnt;         /* Blocks currently in use. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -78,9 +87,10 @@ void malloc_init(void) {
   }
 }
 
-/* Obtains and returns a new block of at least SIZE bytes.
-   Returns a null pointer if memory is not available. */
-void* malloc(size_t size) {
+/* Obtains and returns a new block of at least SIZE bytes for
+   TAG, recording it as allocated from CALLER.  Returns a null
+   pointer if memory is not available. */
+static void* do_malloc(size_t size, enum mem_tag tag, void* caller) {
   struct desc* d;
   struct block* b;
   struct arena* a;
@@ -98,7 +108,7 @@ void* malloc(size_t size) {
     /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
     size_t page_cnt = DIV_ROUND_UP(size + sizeof *a, PGSIZE);
-    a = palloc_get_multiple(0, page_cnt);
+    a = palloc_get_multiple(PAL_TAG(MT_HEAP), page_cnt);
     if (a == NULL)
       return NULL;
 
@@ -107,6 +117,7 @@ void* malloc(size_t size) {
     a->magic = ARENA_MAGIC;
     a->desc = NULL;
     a->free_cnt = page_cnt;
+    memtag_alloc(a + 1, PGSIZE * page_cnt - sizeof *a, tag, caller);
     return a + 1;
   }
 
@@ -117,7 +128,7 @@ void* malloc(size_t size) {
     size_t i;
 
     /* Allocate a page. */
-    a = palloc_get_page(0);
+    a = palloc_get_page(PAL_TAG(MT_HEAP));
     if (a == NULL) {
       lock_release(&d->lock);
       return NULL;
@@ -131,19 +142,33 @@ void* malloc(size_t size) {
       struct block* b = arena_to_block(a, i);
       list_push_back(&d->free_list, &b->free_elem);
     }
+    if (++d->arena_cnt > d->peak_arena_cnt)
+      d->peak_arena_cnt = d->arena_cnt;
   }
 
   /* Get a block from free list and return it. */
   b = list_entry(list_pop_front(&d->free_list), struct block, free_elem);
   a = block_to_arena(b);
   a->free_cnt--;
+  d->used_cnt++;
   lock_release(&d->lock);
+  memtag_alloc(b, d->block_size, tag, caller);
   return b;
 }
 
-/* Allocates and return A times B bytes initialized to zeroes.
+/* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
-void* calloc(size_t a, size_t b) {
+void* malloc(size_t size) { return do_malloc(size, MT_OTHER, __builtin_return_address(0)); }
+
+/* Like malloc(), but attributes the block to TAG. */
+void* malloc_tagged(size_t size, enum mem_tag tag) {
+  return do_malloc(size, tag, __builtin_return_address(0));
+}
+
+/* Allocates A times B bytes initialized to zeroes for TAG,
+   recording them as allocated from CALLER.  Returns a null
+   pointer if memory is not available. */
+static void* do_calloc(size_t a, size_t b, enum mem_tag tag, void* caller) {
   void* p;
   size_t size;
 
@@ -153,13 +178,35 @@ void* calloc(size_t a, size_t b) {
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc(size);
+  p = do_malloc(size, tag, caller);
   if (p != NULL)
     memset(p, 0, size);
 
   return p;
 }
 
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void* calloc(size_t a, size_t b) { return do_calloc(a, b, MT_OTHER, __builtin_return_address(0)); }
+
+/* Like calloc(), but attributes the block to TAG. */
+void* calloc_tagged(size_t a, size_t b, enum mem_tag tag) {
+  return do_calloc(a, b, tag, __builtin_return_address(0));
+}
+
+/* Returns the number of pages that CNT blocks of SIZE bytes each
+   would occupy if allocated with malloc() and packed into as few
+   arenas as possible.  Used to compare other allocators against
+   this one. */
+size_t malloc_pages(size_t size, size_t cnt) {
+  struct desc* d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->block_size >= size)
+      return DIV_ROUND_UP(cnt, d->blocks_per_arena);
+  return cnt * DIV_ROUND_UP(size + sizeof(struct arena), PGSIZE);
+}
+
 /* Returns the number of bytes allocated for BLOCK. */
 static size_t block_size(void* block) {
   struct block* b = block;
@@ -174,13 +221,15 @@ static size_t block_size(void* block) {
    If successful, returns the new block; on failure, returns a
    null pointer.
    A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
-   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK).
+   The new block keeps OLD_BLOCK's tag. */
 void* realloc(void* old_block, size_t new_size) {
   if (new_size == 0) {
     free(old_block);
     return NULL;
   } else {
-    void* new_block = malloc(new_size);
+    void* new_block =
+        do_malloc(new_size, memtag_lookup(old_block), __builtin_return_address(0));
     if (old_block != NULL && new_block != NULL) {
       size_t old_size = block_size(old_block);
       size_t min_size = new_size < old_size ? new_size : old_size;
@@ -199,6 +248,7 @@ void free(void* p) {
     struct arena* a = block_to_arena(b);
     struct desc* d = a->desc;
 
+    memtag_free(p);
     if (d != NULL) {
       /* It's a normal block.  We handle it here. */
 
@@ -211,6 +261,7 @@ void free(void* p) {
 
       /* Add block to free list. */
       list_push_front(&d->free_list, &b->free_elem);
+      d->used_cnt--;
 
       /* If the arena is now entirely unused, free it. */
       if (++a->free_cnt >= d->blocks_per_arena) {
@@ -221,6 +272,7 @@ void free(void* p) {
           struct block* b = arena_to_block(a, i);
           list_remove(&b->free_elem);
         }
+        d->arena_cnt--;
         palloc_free_page(a);
       }
 
@@ -233,6 +285,38 @@ void free(void* p) {
   }
 }
 
+/* Stores the utilization of the IDX'th size class in *S.
+   Returns false if there is no such size class. */
+bool malloc_get_stats(int idx, struct heapstat* s) {
+  struct desc* d;
+
+  if (idx < 0 || (size_t)idx >= desc_cnt)
+    return false;
+
+  d = &descs[idx];
+  lock_acquire(&d->lock);
+  s->block_size = d->block_size;
+  s->blocks_per_arena = d->blocks_per_arena;
+  s->arena_cnt = d->arena_cnt;
+  s->peak_arena_cnt = d->peak_arena_cnt;
+  s->used_cnt = d->used_cnt;
+  lock_release(&d->lock);
+  return true;
+}
+
+/* Prints the utilization of each size class that was ever
+   used. */
+void malloc_print_stats(void) {
+  struct heapstat s;
+  int i;
+
+  for (i = 0; malloc_get_stats(i, &s); i++)
+    if (s.peak_arena_cnt > 0)
+      printf("Heap %zu-byte blocks: %zu of %zu used in %zu arenas, peak %zu arenas\n",
+             s.block_size, s.used_cnt, s.arena_cnt * s.blocks_per_arena, s.arena_cnt,
+             s.peak_arena_cnt);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena* block_to_arena(struct block* b) {
   struct arena* a = pg_round_down(b);
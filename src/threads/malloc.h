@@ -2,12 +2,20 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <memstat.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include "threads/memtag.h"
 
 void malloc_init(void);
 void* malloc(size_t) __attribute__((malloc));
 void* calloc(size_t, size_t) __attribute__((malloc));
 void* realloc(void*, size_t);
 void free(void*);
+void* malloc_tagged(size_t, enum mem_tag) __attribute__((malloc));
+void* calloc_tagged(size_t, size_t, enum mem_tag) __attribute__((malloc));
+size_t malloc_pages(size_t size, size_t cnt);
+bool malloc_get_stats(int idx, struct heapstat*);
+void malloc_print_stats(void);
 
 #endif /* threads/malloc.h */
@@ -0,0 +1,220 @@
+#include "threads/memtag.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Kernel memory accounting.
+
+   With the -memtag kernel option, every allocation from palloc,
+   malloc() and the slab caches is recorded in a table keyed by
+   its address, along with its size, the subsystem it was
+   allocated for, and the address it was allocated from.  Freeing
+   the memory removes the record.  Each subsystem's live bytes,
+   peak bytes, and allocation and free counts follow from the
+   records.
+
+   Memory is counted at the level its caller sees it: the pages
+   that malloc() and the slab caches carve up count as MT_HEAP,
+   and the blocks and objects carved from them count under the
+   subsystem that asked for them.  So the heap's live bytes, less
+   the blocks and objects counted elsewhere, is what those
+   allocators lose to fragmentation and free space.
+
+   The table is an open-addressed hash table with linear
+   probing, allocated once at boot from the kernel pool.  An
+   allocation that finds the table full goes unrecorded and is
+   counted as such.  Allocations made before memtag_init() are
+   never recorded, and frees of unrecorded memory are ignored. */
+
+/* Number of records in the table.  Must be a power of 2. */
+#define TABLE_SIZE 16384
+
+/* One live allocation. */
+struct record {
+  void* ptr;        /* Allocated memory, or null if slot is empty. */
+  void* caller;     /* Return address of the allocation call. */
+  uint32_t size;    /* Size in bytes. */
+  enum mem_tag tag; /* Subsystem. */
+};
+
+/* Tag names.  Persistent tags hold memory that the kernel keeps
+   until it powers off, so it is not reported as leaked. */
+static const struct tag_info {
+  const char* name;
+  bool persistent;
+} tag_info[MT_CNT] = {
+    [MT_OTHER] = {"other", true},     [MT_HEAP] = {"heap", true},
+    [MT_THREAD] = {"thread", true},   [MT_PAGEDIR] = {"pagedir", true},
+    [MT_USER] = {"user", false},      [MT_VM] = {"vm", false},
+    [MT_PROCESS] = {"process", false}, [MT_FD] = {"fd", false},
+    [MT_FILE] = {"file", false},      [MT_INODE] = {"inode", false},
+    [MT_CACHE] = {"cache", true},     [MT_DEVICES] = {"devices", true},
+};
+
+static struct record* table; /* Null unless tagging is enabled. */
+static size_t record_cnt;    /* Records in TABLE. */
+static struct memstat stats[MT_CNT];
+static size_t untracked_cnt; /* Allocations that found the table full. */
+
+/* Enables allocation tagging. */
+void memtag_init(void) {
+  size_t page_cnt = TABLE_SIZE * sizeof *table / PGSIZE;
+  int i;
+
+  for (i = 0; i < MT_CNT; i++)
+    strlcpy(stats[i].name, tag_info[i].name, sizeof stats[i].name);
+  table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, page_cnt);
+}
+
+/* Returns the slot where P's record belongs. */
+static size_t slot_for(const void* p) {
+  return ((uintptr_t)p >> 4) * 2654435761u & (TABLE_SIZE - 1);
+}
+
+/* Returns P's record, or the empty slot where it would go. */
+static struct record* find(const void* p) {
+  size_t i;
+
+  for (i = slot_for(p); table[i].ptr != NULL && table[i].ptr != p; i = (i + 1) & (TABLE_SIZE - 1))
+    continue;
+  return &table[i];
+}
+
+/* Records that SIZE bytes at P were allocated for TAG by the
+   function that returns to CALLER. */
+void memtag_alloc(void* p, size_t size, enum mem_tag tag, void* caller) {
+  struct memstat* s = &stats[tag];
+  enum intr_level old_level;
+  struct record* r;
+
+  ASSERT(tag < MT_CNT);
+  if (table == NULL || p == NULL)
+    return;
+
+  old_level = intr_disable();
+  r = find(p);
+  ASSERT(r->ptr == NULL);
+  if (record_cnt < TABLE_SIZE - 1) {
+    record_cnt++;
+    r->ptr = p;
+    r->caller = caller;
+    r->size = size;
+    r->tag = tag;
+    s->alloc_cnt++;
+    s->live_bytes += size;
+    if (s->live_bytes > s->peak_bytes)
+      s->peak_bytes = s->live_bytes;
+  } else
+    untracked_cnt++;
+  intr_set_level(old_level);
+}
+
+/* Removes the record of the allocation at P, if there is one. */
+void memtag_free(void* p) {
+  enum intr_level old_level;
+  struct record* r;
+
+  if (table == NULL || p == NULL)
+    return;
+
+  old_level = intr_disable();
+  r = find(p);
+  if (r->ptr != NULL) {
+    struct memstat* s = &stats[r->tag];
+    size_t hole = r - table;
+    size_t i;
+
+    record_cnt--;
+    s->free_cnt++;
+    s->live_bytes -= r->size;
+
+    /* Close the hole by moving up any later record in the same
+       probe run that cannot be found past it. */
+    for (i = (hole + 1) & (TABLE_SIZE - 1); table[i].ptr != NULL; i = (i + 1) & (TABLE_SIZE - 1)) {
+      size_t home = slot_for(table[i].ptr);
+      if (((i - home) & (TABLE_SIZE - 1)) >= ((i - hole) & (TABLE_SIZE - 1))) {
+        table[hole] = table[i];
+        hole = i;
+      }
+    }
+    table[hole].ptr = NULL;
+  }
+  intr_set_level(old_level);
+}
+
+/* Returns the tag P was allocated with, or MT_OTHER if P's
+   allocation was not recorded. */
+enum mem_tag memtag_lookup(const void* p) {
+  enum intr_level old_level;
+  enum mem_tag tag;
+  struct record* r;
+
+  if (table == NULL || p == NULL)
+    return MT_OTHER;
+
+  old_level = intr_disable();
+  r = find(p);
+  tag = r->ptr != NULL ? r->tag : MT_OTHER;
+  intr_set_level(old_level);
+  return tag;
+}
+
+/* Stores the statistics for TAG in *S.  Returns false if TAG is
+   not a valid tag. */
+bool memtag_get_stats(int tag, struct memstat* s) {
+  enum intr_level old_level;
+
+  if (tag < 0 || tag >= MT_CNT)
+    return false;
+
+  old_level = intr_disable();
+  *s = stats[tag];
+  intr_set_level(old_level);
+  strlcpy(s->name, tag_info[tag].name, sizeof s->name);
+  return true;
+}
+
+/* Prints the statistics for each tag that was ever used. */
+void memtag_print_stats(void) {
+  int i;
+
+  if (table == NULL)
+    return;
+
+  for (i = 0; i < MT_CNT; i++) {
+    struct memstat* s = &stats[i];
+    if (s->alloc_cnt > 0)
+      printf("Memory %s: %zu bytes live, %zu peak, %zu allocs, %zu frees\n", s->name,
+             s->live_bytes, s->peak_bytes, s->alloc_cnt, s->free_cnt);
+  }
+  if (untracked_cnt > 0)
+    printf("Memory: %zu allocations not tracked\n", untracked_cnt);
+}
+
+/* Prints each allocation that is still live under a tag whose
+   memory should all have been freed by now.  The address it was
+   allocated from can be resolved with the "backtrace" tool.
+   Should be called only once the system is quiescent. */
+void memtag_print_leaks(void) {
+  size_t leak_cnt = 0, leak_bytes = 0;
+  size_t i;
+
+  if (table == NULL)
+    return;
+
+  for (i = 0; i < TABLE_SIZE; i++) {
+    struct record* r = &table[i];
+    if (r->ptr != NULL && !tag_info[r->tag].persistent) {
+      if (leak_cnt++ < 20)
+        printf("Leak: %" PRIu32 " bytes of %s at %p, allocated from %p\n", r->size,
+               tag_info[r->tag].name, r->ptr, r->caller);
+      leak_bytes += r->size;
+    }
+  }
+  printf("Leak check: %zu objects, %zu bytes still allocated\n", leak_cnt, leak_bytes);
+}
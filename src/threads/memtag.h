@@ -0,0 +1,36 @@
+#ifndef THREADS_MEMTAG_H
+#define THREADS_MEMTAG_H
+
+#include <memstat.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Kernel subsystems that memory is allocated on behalf of.
+   palloc callers name one with PAL_TAG(), malloc callers with
+   malloc_tagged() or calloc_tagged(), and slab caches when they
+   are created. */
+enum mem_tag {
+  MT_OTHER,   /* Not attributed to any subsystem. */
+  MT_HEAP,    /* Pages backing malloc() and slab caches. */
+  MT_THREAD,  /* Thread structures and kernel stacks. */
+  MT_PAGEDIR, /* Page directories and page tables. */
+  MT_USER,    /* User pages. */
+  MT_VM,      /* Supplemental page table entries and frames. */
+  MT_PROCESS, /* Process control blocks and exec arguments. */
+  MT_FD,      /* File descriptor tables. */
+  MT_FILE,    /* Open files and directories. */
+  MT_INODE,   /* In-memory inodes and indirect blocks. */
+  MT_CACHE,   /* Buffer cache. */
+  MT_DEVICES, /* Block devices and partitions. */
+  MT_CNT      /* Number of tags. */
+};
+
+void memtag_init(void);
+void memtag_alloc(void*, size_t size, enum mem_tag, void* caller);
+void memtag_free(void*);
+enum mem_tag memtag_lookup(const void*);
+bool memtag_get_stats(int tag, struct memstat*);
+void memtag_print_stats(void);
+void memtag_print_leaks(void);
+
+#endif /* threads/memtag.h */
@@ -2,13 +2,17 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/memtag.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,20 +27,76 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a binary buddy system.  Its free pages
+   are kept as blocks of 2**ORDER pages, each aligned, relative to
+   the pool's base, on a multiple of its own size, on one free
+   list per order.  An allocation takes a block from the smallest
+   order that fits, splitting larger blocks as needed, and gives
+   back any pages beyond the request.  A freed block merges with
+   its "buddy", the other half of the block it was split from,
+   for as long as the buddy is free too.  Both take O(log n)
+   time, and a single page usually comes straight off the order-0
+   list.
+
+   A free list links blocks through their first page.  A byte per
+   page in the pool's header records whether the page heads a
+   free block, and of which order, so that a buddy can be checked
+   in constant time.  A bitmap of allocated pages is kept for
+   sanity checks.
+
+   Each pool also keeps a stock of free pages that are already
+   zeroed, so that single-page PAL_ZERO requests, such as thread
+   stacks, page tables, and user stacks, need not clear a page on
+   the spot.  A background "pagezero" thread tops the stock up to
+   ZERO_HIGH_WATER pages, one page per time slice, and sleeps
+   until an allocation drains it below ZERO_LOW_WATER.  The stock
+   still counts as free memory: any request that the buddy lists
+   cannot satisfy falls back on it. */
+
+/* Largest block order: blocks of up to 2**PALLOC_MAX_ORDER pages. */
+#define MAX_ORDER PALLOC_MAX_ORDER
+
+/* Page info bits. */
+#define PI_FREE 0x80       /* Page heads a free block. */
+#define PI_ORDER_MASK 0x1f /* Order of that block. */
+
+/* Pre-zeroed page stock watermarks, in pages per pool. */
+#define ZERO_HIGH_WATER 64
+#define ZERO_LOW_WATER 16
+
+/* A free block, overlaying its first page. */
+struct free_block {
+  struct list_elem elem; /* Element in pool's free list. */
+};
 
 /* A memory pool. */
 struct pool {
-  struct lock lock;        /* Mutual exclusion. */
-  struct bitmap* used_map; /* Bitmap of free pages. */
-  uint8_t* base;           /* Base of pool. */
+  struct lock lock;                      /* Mutual exclusion. */
+  struct bitmap* used_map;               /* Bitmap of allocated pages. */
+  uint8_t* page_info;                    /* PI_* bits for each page. */
+  size_t page_cnt;                       /* Number of pages in pool. */
+  size_t free_cnt;                       /* Number of free pages. */
+  struct list free_lists[MAX_ORDER + 1]; /* Free blocks of each order. */
+  struct list zeroed;                    /* Pre-zeroed free pages. */
+  size_t zeroed_cnt;                     /* Number of pages in ZEROED. */
+  size_t zeroing_cnt;                    /* Pages being zeroed for ZEROED. */
+  size_t zero_hits;                      /* PAL_ZERO pages served from ZEROED. */
+  size_t zero_misses;                    /* PAL_ZERO pages zeroed on the spot. */
+  uint8_t* base;                         /* Base of pool. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* The pagezero thread sleeps on ZERO_SEMA when ZERO_IDLE. */
+static struct semaphore zero_sema;
+static bool zero_idle;
+
 static void init_pool(struct pool*, void* base, size_t page_cnt, const char* name);
 static bool page_from_pool(const struct pool*, void* page);
+static void free_range(struct pool*, size_t page_idx, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -56,14 +116,141 @@ void palloc_init(size_t user_page_limit) {
   init_pool(&user_pool, free_start + kernel_pages * PGSIZE, user_pages, "user pool");
 }
 
-/* Obtains and returns a group of PAGE_CNT contiguous free pages.
-   If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
-void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int order_for(size_t page_cnt) {
+  int order = 0;
+  while (((size_t)1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Returns the free block that starts at PAGE_IDX in POOL. */
+static struct free_block* idx_to_block(struct pool* pool, size_t page_idx) {
+  return (struct free_block*)(pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the page index in POOL of free block B. */
+static size_t block_to_idx(struct pool* pool, struct free_block* b) {
+  return pg_no(b) - pg_no(pool->base);
+}
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX on POOL's free
+   list for ORDER. */
+static void push_block(struct pool* pool, size_t page_idx, int order) {
+  pool->page_info[page_idx] = PI_FREE | order;
+  list_push_front(&pool->free_lists[order], &idx_to_block(pool, page_idx)->elem);
+}
+
+/* Takes the free block at PAGE_IDX off its free list. */
+static void pop_block(struct pool* pool, size_t page_idx) {
+  list_remove(&idx_to_block(pool, page_idx)->elem);
+  pool->page_info[page_idx] = 0;
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX, merging it with
+   its buddy as long as the buddy is free and of the same order.
+   POOL's lock must be held. */
+static void free_block(struct pool* pool, size_t page_idx, int order) {
+  while (order < MAX_ORDER) {
+    size_t buddy = page_idx ^ ((size_t)1 << order);
+    if (buddy + ((size_t)1 << order) > pool->page_cnt ||
+        pool->page_info[buddy] != (PI_FREE | order))
+      break;
+    pop_block(pool, buddy);
+    if (buddy < page_idx)
+      page_idx = buddy;
+    order++;
+  }
+  push_block(pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, as the largest
+   aligned blocks that cover them.  POOL's lock must be held. */
+static void free_range(struct pool* pool, size_t page_idx, size_t page_cnt) {
+  pool->free_cnt += page_cnt;
+  while (page_cnt > 0) {
+    int order = 0;
+    while (order < MAX_ORDER && (page_idx & ((size_t)1 << order)) == 0 &&
+           ((size_t)2 << order) <= page_cnt)
+      order++;
+    free_block(pool, page_idx, order);
+    page_idx += (size_t)1 << order;
+    page_cnt -= (size_t)1 << order;
+  }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is big
+   enough.  POOL's lock must be held. */
+static size_t alloc_range(struct pool* pool, size_t page_cnt) {
+  int want = order_for(page_cnt);
+  int order;
+  size_t page_idx;
+
+  if (want > MAX_ORDER)
+    return BITMAP_ERROR;
+
+  /* Find the smallest free block that is big enough. */
+  for (order = want; order <= MAX_ORDER; order++)
+    if (!list_empty(&pool->free_lists[order]))
+      break;
+  if (order > MAX_ORDER)
+    return BITMAP_ERROR;
+
+  page_idx = block_to_idx(
+      pool, list_entry(list_front(&pool->free_lists[order]), struct free_block, elem));
+  pop_block(pool, page_idx);
+
+  /* Split it down to the order we want, freeing upper halves. */
+  while (order > want) {
+    order--;
+    push_block(pool, page_idx + ((size_t)1 << order), order);
+  }
+  pool->free_cnt -= (size_t)1 << order;
+
+  /* Give back whatever the request does not need. */
+  if (page_cnt < ((size_t)1 << order))
+    free_range(pool, page_idx + page_cnt, ((size_t)1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Returns true if POOL's pre-zeroed stock is low and there is
+   free memory to replenish it with. */
+static bool wants_zeroing(const struct pool* pool) {
+  return pool->zeroed_cnt < ZERO_LOW_WATER && pool->free_cnt > 0;
+}
+
+/* Wakes the pagezero thread if it sleeps and POOL needs it. */
+static void wake_zeroer(struct pool* pool) {
+  if (zero_idle && wants_zeroing(pool)) {
+    zero_idle = false;
+    sema_up(&zero_sema);
+  }
+}
+
+/* Takes a page from POOL's pre-zeroed stock and returns its
+   index.  The stock must not be empty.  POOL's lock must be
+   held. */
+static size_t pop_zeroed(struct pool* pool) {
+  struct free_block* b = list_entry(list_pop_front(&pool->zeroed), struct free_block, elem);
+  pool->zeroed_cnt--;
+  memset(b, 0, sizeof *b);
+  return block_to_idx(pool, b);
+}
+
+/* Returns POOL's whole pre-zeroed stock to the buddy lists.
+   POOL's lock must be held. */
+static void release_zeroed(struct pool* pool) {
+  while (pool->zeroed_cnt > 0)
+    free_range(pool, pop_zeroed(pool), 1);
+}
+
+/* Allocates PAGE_CNT pages for palloc_get_multiple(), recording
+   them as allocated from CALLER. */
+static void* get_pages(enum palloc_flags flags, size_t page_cnt, void* caller) {
   struct pool* pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum mem_tag tag = flags >> 8;
+  bool zeroed = false;
   void* pages;
   size_t page_idx;
 
@@ -71,7 +258,33 @@ void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     return NULL;
 
   lock_acquire(&pool->lock);
-  page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
+  if (page_cnt == 1 && (flags & PAL_ZERO) && pool->zeroed_cnt > 0) {
+    page_idx = pop_zeroed(pool);
+    zeroed = true;
+  } else {
+    page_idx = alloc_range(pool, page_cnt);
+    if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) {
+      /* Out of buddy memory: fall back on the zeroed stock. */
+      if (page_cnt == 1) {
+        page_idx = pop_zeroed(pool);
+        zeroed = true;
+      } else {
+        release_zeroed(pool);
+        page_idx = alloc_range(pool, page_cnt);
+      }
+    }
+  }
+  if (page_idx != BITMAP_ERROR) {
+    ASSERT(bitmap_none(pool->used_map, page_idx, page_cnt));
+    bitmap_set_multiple(pool->used_map, page_idx, page_cnt, true);
+    if (flags & PAL_ZERO) {
+      if (zeroed)
+        pool->zero_hits++;
+      else
+        pool->zero_misses += page_cnt;
+    }
+  }
+  wake_zeroer(pool);
   lock_release(&pool->lock);
 
   if (page_idx != BITMAP_ERROR)
@@ -80,8 +293,11 @@ void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     pages = NULL;
 
   if (pages != NULL) {
-    if (flags & PAL_ZERO)
+    if ((flags & PAL_ZERO) && !zeroed)
       memset(pages, 0, PGSIZE * page_cnt);
+    if (tag == MT_OTHER && (flags & PAL_USER))
+      tag = MT_USER;
+    memtag_alloc(pages, PGSIZE * page_cnt, tag, caller);
   } else {
     if (flags & PAL_ASSERT)
       PANIC("palloc_get: out of pages");
@@ -90,6 +306,16 @@ void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
   return pages;
 }
 
+/* Obtains and returns a group of PAGE_CNT contiguous free pages.
+   If PAL_USER is set, the pages are obtained from the user pool,
+   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   then the pages are filled with zeros.  If too few pages are
+   available, returns a null pointer, unless PAL_ASSERT is set in
+   FLAGS, in which case the kernel panics. */
+void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
+  return get_pages(flags, page_cnt, __builtin_return_address(0));
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -97,7 +323,9 @@ void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
    then the page is filled with zeros.  If no pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
-void* palloc_get_page(enum palloc_flags flags) { return palloc_get_multiple(flags, 1); }
+void* palloc_get_page(enum palloc_flags flags) {
+  return get_pages(flags, 1, __builtin_return_address(0));
+}
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void palloc_free_multiple(void* pages, size_t page_cnt) {
@@ -116,35 +344,157 @@ void palloc_free_multiple(void* pages, size_t page_cnt) {
     NOT_REACHED();
 
   page_idx = pg_no(pages) - pg_no(pool->base);
+  memtag_free(pages);
 
 #ifndef NDEBUG
   memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  lock_acquire(&pool->lock);
   ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+  free_range(pool, page_idx, page_cnt);
+  wake_zeroer(pool);
+  lock_release(&pool->lock);
+}
+
+/* Zeroes one page for POOL's pre-zeroed stock, if the stock is
+   below ZERO_HIGH_WATER and a free page is available.  Returns
+   true if it zeroed a page. */
+static bool zero_one(struct pool* pool) {
+  size_t page_idx;
+  struct free_block* b;
+
+  lock_acquire(&pool->lock);
+  page_idx = pool->zeroed_cnt < ZERO_HIGH_WATER ? alloc_range(pool, 1) : BITMAP_ERROR;
+  if (page_idx != BITMAP_ERROR)
+    pool->zeroing_cnt++;
+  lock_release(&pool->lock);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  /* The page belongs to no list while we clear it, but still
+     counts as free, via ZEROING_CNT. */
+  b = idx_to_block(pool, page_idx);
+  memset(b, 0, PGSIZE);
+
+  lock_acquire(&pool->lock);
+  list_push_front(&pool->zeroed, &b->elem);
+  pool->zeroing_cnt--;
+  pool->zeroed_cnt++;
+  lock_release(&pool->lock);
+  return true;
+}
+
+/* Keeps both pools' pre-zeroed stocks topped up, yielding after
+   every page so that it mostly uses time nobody else wants. */
+static void pagezero_thread(void* aux UNUSED) {
+  for (;;) {
+    bool kernel_zeroed = zero_one(&kernel_pool);
+    bool user_zeroed = zero_one(&user_pool);
+
+    if (kernel_zeroed || user_zeroed)
+      thread_yield();
+    else {
+      /* Both stocks are full, or memory is.  Sleep until an
+         allocation leaves a stock low with memory to refill it. */
+      enum intr_level old_level = intr_disable();
+      if (!wants_zeroing(&kernel_pool) && !wants_zeroing(&user_pool)) {
+        zero_idle = true;
+        sema_down(&zero_sema);
+      }
+      intr_set_level(old_level);
+    }
+  }
+}
+
+/* Starts the thread that keeps pre-zeroed pages in stock.  Must
+   be called after thread_start(). */
+void palloc_start_zeroing(void) {
+  sema_init(&zero_sema, 0);
+  thread_create("pagezero", PRI_MIN, pagezero_thread, NULL);
 }
 
 /* Frees the page at PAGE. */
 void palloc_free_page(void* page) { palloc_free_multiple(page, 1); }
 
+/* Fills in *STATS for the user pool if PAL_USER is set in FLAGS,
+   otherwise for the kernel pool. */
+void palloc_get_stats(enum palloc_flags flags, struct palloc_stats* stats) {
+  struct pool* pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  int order;
+
+  lock_acquire(&pool->lock);
+  stats->page_cnt = pool->page_cnt;
+  stats->free_cnt = pool->free_cnt + pool->zeroed_cnt + pool->zeroing_cnt;
+  stats->zeroed_cnt = pool->zeroed_cnt + pool->zeroing_cnt;
+  stats->zero_hits = pool->zero_hits;
+  stats->zero_misses = pool->zero_misses;
+  stats->largest_free = 0;
+  for (order = 0; order <= MAX_ORDER; order++) {
+    stats->free_blocks[order] = list_size(&pool->free_lists[order]);
+    if (stats->free_blocks[order] > 0)
+      stats->largest_free = (size_t)1 << order;
+  }
+  lock_release(&pool->lock);
+}
+
+/* Prints free memory and external fragmentation of POOL, named
+   NAME, and how often its pre-zeroed stock served PAL_ZERO.
+   Fragmentation is the share of free pages on the buddy lists
+   that lie outside the largest free block. */
+static void print_pool_stats(const char* name, enum palloc_flags flags) {
+  struct palloc_stats s;
+  size_t blocks = 0;
+  size_t buddy_free;
+  int order;
+
+  palloc_get_stats(flags, &s);
+  for (order = 0; order <= MAX_ORDER; order++)
+    blocks += s.free_blocks[order];
+  buddy_free = s.free_cnt - s.zeroed_cnt;
+  printf("%s: %zu of %zu pages free in %zu blocks, largest %zu, %zu%% fragmented\n", name,
+         s.free_cnt, s.page_cnt, blocks + s.zeroed_cnt, s.largest_free,
+         buddy_free > 0 ? (buddy_free - s.largest_free) * 100 / buddy_free : 0);
+  printf("%s: %zu pages pre-zeroed, PAL_ZERO served %zu from stock, zeroed %zu\n", name,
+         s.zeroed_cnt, s.zero_hits, s.zero_misses);
+}
+
+/* Prints page allocator statistics. */
+void palloc_print_stats(void) {
+  print_pool_stats("Kernel pool", 0);
+  print_pool_stats("User pool", PAL_USER);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* name) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map and page_info at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t bm_size = ROUND_UP(bitmap_buf_size(page_cnt), sizeof(long));
+  size_t hdr_pages = DIV_ROUND_UP(bm_size + page_cnt, PGSIZE);
+  int order;
+
+  if (hdr_pages > page_cnt)
     PANIC("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= hdr_pages;
 
   printf("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
   lock_init(&p->lock);
-  p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->used_map = bitmap_create_in_buf(page_cnt, base, bm_size);
+  p->page_info = (uint8_t*)base + bm_size;
+  memset(p->page_info, 0, page_cnt);
+  p->base = base + hdr_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init(&p->free_lists[order]);
+  list_init(&p->zeroed);
+  p->zeroed_cnt = p->zeroing_cnt = p->zero_hits = p->zero_misses = 0;
+  free_range(p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -152,7 +502,7 @@ static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* n
 static bool page_from_pool(const struct pool* pool, void* page) {
   size_t page_no = pg_no(page);
   size_t start_page = pg_no(pool->base);
-  size_t end_page = start_page + bitmap_size(pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
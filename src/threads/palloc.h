@@ -3,6 +3,9 @@
 
 #include <stddef.h>
 
+/* Largest block the page allocator manages: 2**16 pages. */
+#define PALLOC_MAX_ORDER 16
+
 /* How to allocate pages. */
 enum palloc_flags {
   PAL_ASSERT = 001, /* Panic on failure. */
@@ -10,10 +13,30 @@ enum palloc_flags {
   PAL_USER = 004    /* User page. */
 };
 
+/* Attributes the pages to memory tag T (see memtag.h).  Pages
+   without a tag count as MT_USER if PAL_USER is set, otherwise
+   as MT_OTHER. */
+#define PAL_TAG(T) ((T) << 8)
+
 void palloc_init(size_t user_page_limit);
 void* palloc_get_page(enum palloc_flags);
 void* palloc_get_multiple(enum palloc_flags, size_t page_cnt);
 void palloc_free_page(void*);
 void palloc_free_multiple(void*, size_t page_cnt);
 
+/* Page allocator statistics for one pool. */
+struct palloc_stats {
+  size_t page_cnt;                              /* Pages in pool. */
+  size_t free_cnt;                              /* Free pages. */
+  size_t largest_free;                          /* Pages in largest free block. */
+  size_t zeroed_cnt;                            /* Free pages zeroed or being zeroed. */
+  size_t zero_hits;                             /* PAL_ZERO pages served pre-zeroed. */
+  size_t zero_misses;                           /* PAL_ZERO pages zeroed on demand. */
+  size_t free_blocks[PALLOC_MAX_ORDER + 1];     /* Free blocks of each order. */
+};
+
+void palloc_start_zeroing(void);
+void palloc_get_stats(enum palloc_flags, struct palloc_stats*);
+void palloc_print_stats(void);
+
 #endif /* threads/palloc.h */
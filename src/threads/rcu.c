@@ -0,0 +1,144 @@
+#include "threads/rcu.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Quiescent-state read-copy-update for a uniprocessor.
+
+   A read-side critical section may not sleep or yield, and the
+   timer does not preempt a thread inside one (see thread_tick()).
+   So once the CPU has switched threads, no read-side section
+   that was running before the switch can still be in progress.
+   Each context switch therefore ends a grace period, and a
+   callback queued during one grace period may run in any later
+   one.
+
+   Callbacks run in a dedicated kernel thread, so they may sleep
+   and may call free() and the like. */
+
+/* Number of completed grace periods, i.e. context switches. */
+static unsigned grace_period;
+
+/* Callbacks waiting for their grace period to end, oldest first. */
+static struct list pending_list;
+
+/* Thread that runs callbacks, and whether it is waiting for work. */
+static struct thread* reclaim_thread;
+static bool reclaim_idle;
+
+static thread_func rcu_reclaim;
+
+/* Initializes RCU and starts the reclaim thread.  Must be called
+   after thread_start(). */
+void rcu_init(void) {
+  struct semaphore started;
+
+  list_init(&pending_list);
+  sema_init(&started, 0);
+  thread_create("rcu", PRI_DEFAULT, rcu_reclaim, &started);
+  sema_down(&started);
+}
+
+/* Enters an RCU read-side critical section.  Sections nest.
+   Until the matching rcu_read_unlock(), the caller must not
+   sleep or yield. */
+void rcu_read_lock(void) {
+  thread_current()->rcu_read_depth++;
+  barrier();
+}
+
+/* Leaves an RCU read-side critical section.  If the timer wanted
+   to preempt us while we were inside, yields now. */
+void rcu_read_unlock(void) {
+  struct thread* t = thread_current();
+
+  ASSERT(t->rcu_read_depth > 0);
+
+  barrier();
+  if (--t->rcu_read_depth == 0 && t->rcu_yield_pending) {
+    t->rcu_yield_pending = false;
+    if (intr_context())
+      intr_yield_on_return();
+    else
+      thread_yield();
+  }
+}
+
+/* Notes that the CPU has switched threads, ending the current
+   grace period.  Called by the scheduler with interrupts off. */
+void rcu_note_context_switch(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  grace_period++;
+}
+
+/* Arranges for FUNC to be called with HEAD once every RCU reader
+   that might hold a reference to the object containing HEAD has
+   left its read-side critical section.  Does not sleep. */
+void call_rcu(struct rcu_head* head, rcu_func* func) {
+  enum intr_level old_level;
+
+  ASSERT(head != NULL);
+  ASSERT(func != NULL);
+
+  old_level = intr_disable();
+  head->func = func;
+  head->grace_period = grace_period;
+  list_push_back(&pending_list, &head->elem);
+  if (reclaim_idle) {
+    reclaim_idle = false;
+    thread_unblock(reclaim_thread);
+  }
+  intr_set_level(old_level);
+}
+
+/* Waits until every RCU read-side critical section in progress
+   at the time of the call has completed. */
+void synchronize_rcu(void) {
+  unsigned start = grace_period;
+
+  ASSERT(!intr_context());
+  ASSERT(thread_current()->rcu_read_depth == 0);
+
+  while (grace_period == start)
+    thread_yield();
+}
+
+/* Reclaim thread.  Runs callbacks whose grace period has ended,
+   and blocks when there are none left. */
+static void rcu_reclaim(void* started_) {
+  struct semaphore* started = started_;
+
+  reclaim_thread = thread_current();
+  sema_up(started);
+
+  for (;;) {
+    struct list ready_list;
+    enum intr_level old_level;
+
+    list_init(&ready_list);
+    old_level = intr_disable();
+    while (list_empty(&pending_list)) {
+      reclaim_idle = true;
+      thread_block();
+    }
+    while (!list_empty(&pending_list)) {
+      struct rcu_head* head = list_entry(list_front(&pending_list), struct rcu_head, elem);
+      if (head->grace_period == grace_period)
+        break;
+      list_push_back(&ready_list, list_pop_front(&pending_list));
+    }
+    intr_set_level(old_level);
+
+    while (!list_empty(&ready_list)) {
+      struct rcu_head* head = list_entry(list_pop_front(&ready_list), struct rcu_head, elem);
+      head->func(head);
+    }
+
+    /* Callbacks queued since we were last scheduled must wait
+       for another context switch. */
+    if (!list_empty(&pending_list))
+      thread_yield();
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef THREADS_RCU_H
+#define THREADS_RCU_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Read-copy-update.
+
+   Readers of an RCU-protected structure bracket their accesses
+   with rcu_read_lock() and rcu_read_unlock() and take no lock.
+   Writers still exclude each other, but instead of freeing a
+   removed object immediately they pass it to call_rcu(), which
+   frees it once every reader that might still see it is done. */
+
+struct rcu_head;
+typedef void rcu_func(struct rcu_head*);
+
+/* Embedded in an object whose reclamation is deferred. */
+struct rcu_head {
+  struct list_elem elem; /* Element in pending callback list. */
+  unsigned grace_period; /* Grace period in which it was queued. */
+  rcu_func* func;        /* Reclaims the object. */
+};
+
+/* Converts pointer to rcu_head HEAD into a pointer to the
+   structure that HEAD is embedded inside, as list_entry(). */
+#define rcu_entry(HEAD, STRUCT, MEMBER)                                                            \
+  ((STRUCT*)((uint8_t*)(HEAD)-offsetof(STRUCT, MEMBER)))
+
+void rcu_init(void);
+void rcu_read_lock(void);
+void rcu_read_unlock(void);
+void rcu_note_context_switch(void);
+void call_rcu(struct rcu_head*, rcu_func*);
+void synchronize_rcu(void);
+
+#endif /* threads/rcu.h */
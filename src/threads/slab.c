@@ -0,0 +1,191 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for fixed-size kernel objects.
+
+   malloc() rounds every request up to a power of 2, so an object
+   of just over half a block size wastes nearly half its block,
+   and every allocation size class shares one descriptor lock.  A
+   kmem_cache instead holds objects of exactly one size, packed
+   into "slabs" of one page each, and has a lock of its own.
+
+   Each slab begins with a header, followed by as many objects as
+   fit in the rest of the page.  Free objects in a slab form a
+   singly linked list through a link word.  The link normally
+   overlays the start of the free object.  If the cache has a
+   constructor, the link goes just past the object instead, so
+   that a freed object keeps its constructed state and the
+   constructor need run only once, when the slab is carved.
+
+   The cache keeps a list of slabs that have free objects.  Full
+   slabs are not tracked; an object's slab is found by rounding
+   its address down to a page boundary.  A slab that becomes
+   entirely free goes back to the page allocator, unless it is
+   the cache's only slab with free objects.
+
+   Slab pages count as MT_HEAP for memtag.c, and each object as
+   it is handed out counts under its cache's tag. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of each slab's page. */
+struct slab {
+  unsigned magic;           /* Always set to SLAB_MAGIC. */
+  struct kmem_cache* cache; /* Owning cache. */
+  struct list_elem elem;    /* Element in cache's partial list. */
+  size_t free_cnt;          /* Number of free objects. */
+  void* free;               /* First free object. */
+};
+
+/* Offset of the first object in a slab. */
+#define SLAB_OBJ_OFS ROUND_UP(sizeof(struct slab), sizeof(void*))
+
+/* All caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER(all_caches);
+
+/* Returns a pointer to the free-list link of free object OBJ. */
+static inline void** obj_link(struct kmem_cache* c, void* obj) {
+  return (void**)((uint8_t*)obj + c->link_ofs);
+}
+
+/* Returns the slab that contains OBJ. */
+static inline struct slab* obj_to_slab(void* obj) {
+  struct slab* s = pg_round_down(obj);
+  ASSERT(s->magic == SLAB_MAGIC);
+  return s;
+}
+
+/* Initializes cache C for objects of SIZE bytes, calling CTOR,
+   if it is nonnull, on each object when its slab is carved.
+   Objects are attributed to TAG.  NAME is used only for
+   statistics and must stay valid. */
+void kmem_cache_create(struct kmem_cache* c, const char* name, enum mem_tag tag, size_t size,
+                       kmem_ctor* ctor) {
+  ASSERT(c != NULL && size > 0);
+
+  c->name = name;
+  c->tag = tag;
+  c->obj_size = size;
+  c->ctor = ctor;
+  c->stride = ROUND_UP(size, sizeof(void*));
+  if (ctor != NULL) {
+    c->link_ofs = c->stride;
+    c->stride += sizeof(void*);
+  } else
+    c->link_ofs = 0;
+  c->objs_per_slab = (PGSIZE - SLAB_OBJ_OFS) / c->stride;
+  ASSERT(c->objs_per_slab > 0);
+
+  lock_init(&c->lock);
+  list_init(&c->partial);
+  c->slab_cnt = c->obj_cnt = 0;
+  c->peak_slab_cnt = c->peak_obj_cnt = 0;
+  list_push_back(&all_caches, &c->elem);
+}
+
+/* Carves a new slab for cache C and puts it on C's partial list.
+   Returns false if no page is available.  C's lock must be
+   held. */
+static bool grow(struct kmem_cache* c) {
+  struct slab* s = palloc_get_page(PAL_TAG(MT_HEAP));
+  uint8_t* obj;
+  size_t i;
+
+  if (s == NULL)
+    return false;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  s->free = NULL;
+
+  /* Link the objects in address order, last first, so that the
+     first allocation gets the lowest address. */
+  obj = (uint8_t*)s + SLAB_OBJ_OFS + (c->objs_per_slab - 1) * c->stride;
+  for (i = 0; i < c->objs_per_slab; i++, obj -= c->stride) {
+    if (c->ctor != NULL)
+      c->ctor(obj);
+    *obj_link(c, obj) = s->free;
+    s->free = obj;
+  }
+
+  list_push_front(&c->partial, &s->elem);
+  if (++c->slab_cnt > c->peak_slab_cnt)
+    c->peak_slab_cnt = c->slab_cnt;
+  return true;
+}
+
+/* Obtains and returns an object from cache C, in its constructed
+   state if C has a constructor and otherwise uninitialized.
+   Returns a null pointer if memory is not available. */
+void* kmem_cache_alloc(struct kmem_cache* c) {
+  struct slab* s;
+  void* obj;
+
+  lock_acquire(&c->lock);
+  if (list_empty(&c->partial) && !grow(c)) {
+    lock_release(&c->lock);
+    return NULL;
+  }
+
+  s = list_entry(list_front(&c->partial), struct slab, elem);
+  obj = s->free;
+  s->free = *obj_link(c, obj);
+  if (--s->free_cnt == 0)
+    list_remove(&s->elem);
+
+  if (++c->obj_cnt > c->peak_obj_cnt)
+    c->peak_obj_cnt = c->obj_cnt;
+  lock_release(&c->lock);
+  memtag_alloc(obj, c->obj_size, c->tag, __builtin_return_address(0));
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  If C has a constructor, OBJ must be in its constructed
+   state.  A null OBJ is ignored. */
+void kmem_cache_free(struct kmem_cache* c, void* obj) {
+  struct slab* s;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab(obj);
+  ASSERT(s->cache == c);
+  memtag_free(obj);
+
+  lock_acquire(&c->lock);
+  *obj_link(c, obj) = s->free;
+  s->free = obj;
+  c->obj_cnt--;
+  if (++s->free_cnt == 1)
+    list_push_front(&c->partial, &s->elem);
+  else if (s->free_cnt == c->objs_per_slab && list_front(&c->partial) != list_back(&c->partial)) {
+    /* Entirely free, and not our last slab with free objects. */
+    list_remove(&s->elem);
+    c->slab_cnt--;
+    s->magic = 0;
+    palloc_free_page(s);
+  }
+  lock_release(&c->lock);
+}
+
+/* Prints each cache's peak usage next to what malloc() would
+   have needed for the same number of objects. */
+void kmem_print_stats(void) {
+  struct list_elem* e;
+
+  for (e = list_begin(&all_caches); e != list_end(&all_caches); e = list_next(e)) {
+    struct kmem_cache* c = list_entry(e, struct kmem_cache, elem);
+    printf("Slab %s: %zu-byte objects, peak %zu in %zu pages (malloc: %zu pages)\n", c->name,
+           c->obj_size, c->peak_obj_cnt, c->peak_slab_cnt,
+           malloc_pages(c->obj_size, c->peak_obj_cnt));
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/memtag.h"
+#include "threads/synch.h"
+
+/* Initializes a newly carved object.  Objects must be freed in
+   their constructed state, so the constructor runs only once per
+   object, not on every allocation. */
+typedef void kmem_ctor(void* obj);
+
+/* A cache of equally sized kernel objects, carved out of
+   single-page slabs.  Owned by slab.c. */
+struct kmem_cache {
+  const char* name;      /* Name, for statistics. */
+  size_t obj_size;       /* Size of each object as requested. */
+  size_t stride;         /* Distance between objects in a slab. */
+  size_t link_ofs;       /* Offset of free-list link in a free object. */
+  size_t objs_per_slab;  /* Objects in each slab. */
+  kmem_ctor* ctor;       /* Constructor, or null. */
+  enum mem_tag tag;      /* Memory tag for objects. */
+  struct lock lock;      /* Protects the members below. */
+  struct list partial;   /* Slabs with at least one free object. */
+  size_t slab_cnt;       /* Slabs currently allocated. */
+  size_t obj_cnt;        /* Objects currently allocated. */
+  size_t peak_slab_cnt;  /* Maximum of SLAB_CNT. */
+  size_t peak_obj_cnt;   /* Maximum of OBJ_CNT. */
+  struct list_elem elem; /* Element in list of all caches. */
+};
+
+void kmem_cache_create(struct kmem_cache*, const char* name, enum mem_tag, size_t size,
+                       kmem_ctor*);
+void* kmem_cache_alloc(struct kmem_cache*);
+void kmem_cache_free(struct kmem_cache*, void*);
+void kmem_print_stats(void);
+
+#endif /* threads/slab.h */
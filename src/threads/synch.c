@@ -218,62 +218,201 @@ bool lock_held_by_current_thread(const struct lock* lock) {
   return lock->holder == thread_current();
 }
 
-/* Initializes a readers-writers lock */
+/* A thread waiting on a readers-writers lock. */
+struct rw_waiter {
+  struct list_elem elem; /* List element in rw_lock's waiters. */
+  struct thread* thread; /* Waiting thread. */
+  bool reader;           /* Waiting to read or to write? */
+};
+
+/* Initializes RW_LOCK as a writer-preferring readers-writers
+   lock: once a writer is waiting, newly arriving readers queue
+   behind it, and a releasing writer hands the lock to the next
+   waiting writer before any waiting readers.
+
+   The lock is built directly on the scheduler rather than on a
+   guard lock.  An uncontended acquire or release only updates a
+   counter with interrupts briefly disabled.  Contended threads
+   wait on a single queue, and the releasing thread transfers
+   ownership to them before waking them, so a woken thread never
+   has to compete for the lock again. */
 void rw_lock_init(struct rw_lock* rw_lock) {
-  lock_init(&rw_lock->lock);
-  cond_init(&rw_lock->read);
-  cond_init(&rw_lock->write);
-  rw_lock->AR = rw_lock->WR = rw_lock->AW = rw_lock->WW = 0;
+  ASSERT(rw_lock != NULL);
+
+  rw_lock->holders = 0;
+  rw_lock->waiting_readers = rw_lock->waiting_writers = 0;
+  rw_lock->phase_fair = false;
+  list_init(&rw_lock->waiters);
 }
 
-/* Acquire a writer-centric readers-writers lock */
-void rw_lock_acquire(struct rw_lock* rw_lock, bool reader) {
-  // Must hold the guard lock the entire time
-  lock_acquire(&rw_lock->lock);
+/* Initializes RW_LOCK as a phase-fair readers-writers lock.
+   Reader and writer phases alternate: a releasing writer admits
+   every reader waiting at that moment as one batch, even readers
+   queued behind other writers, and the last reader of a batch
+   hands the lock to the next waiting writer.  Neither readers
+   nor writers can be starved. */
+void rw_lock_init_fair(struct rw_lock* rw_lock) {
+  rw_lock_init(rw_lock);
+  rw_lock->phase_fair = true;
+}
 
-  if (reader) {
-    // Reader code: Block while there are waiting or active writers
-    while ((rw_lock->AW + rw_lock->WW) > 0) {
-      rw_lock->WR++;
-      cond_wait(&rw_lock->read, &rw_lock->lock);
-      rw_lock->WR--;
+/* Grants RW_LOCK to every waiting reader.
+   Interrupts must be off. */
+static void rw_lock_grant_readers(struct rw_lock* rw_lock) {
+  struct list_elem* e = list_begin(&rw_lock->waiters);
+
+  while (e != list_end(&rw_lock->waiters)) {
+    struct rw_waiter* w = list_entry(e, struct rw_waiter, elem);
+    e = list_next(e);
+    if (w->reader) {
+      list_remove(&w->elem);
+      rw_lock->waiting_readers--;
+      rw_lock->holders++;
+      thread_unblock(w->thread);
     }
-    rw_lock->AR++;
-  } else {
-    // Writer code: Block while there are any active readers/writers in the system
-    while ((rw_lock->AR + rw_lock->AW) > 0) {
-      rw_lock->WW++;
-      cond_wait(&rw_lock->write, &rw_lock->lock);
-      rw_lock->WW--;
+  }
+}
+
+/* Grants RW_LOCK to the longest-waiting writer.
+   Interrupts must be off. */
+static void rw_lock_grant_writer(struct rw_lock* rw_lock) {
+  struct list_elem* e;
+
+  for (e = list_begin(&rw_lock->waiters); e != list_end(&rw_lock->waiters); e = list_next(e)) {
+    struct rw_waiter* w = list_entry(e, struct rw_waiter, elem);
+    if (!w->reader) {
+      list_remove(&w->elem);
+      rw_lock->waiting_writers--;
+      rw_lock->holders = -1;
+      thread_unblock(w->thread);
+      return;
     }
-    rw_lock->AW++;
   }
+  NOT_REACHED();
+}
+
+/* Acquires RW_LOCK for reading if READER is true, for writing
+   otherwise, sleeping until it becomes available if necessary.
 
-  // Release guard lock
-  lock_release(&rw_lock->lock);
+   A reader is admitted immediately only if no writer holds or
+   is waiting for the lock; a writer only if the lock is free.
+   Otherwise the thread queues and sleeps until a releasing
+   thread hands it ownership.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rw_lock_acquire(struct rw_lock* rw_lock, bool reader) {
+  enum intr_level old_level;
+
+  ASSERT(rw_lock != NULL);
+  ASSERT(!intr_context());
+
+  old_level = intr_disable();
+  if (reader && rw_lock->holders >= 0 && rw_lock->waiting_writers == 0)
+    rw_lock->holders++;
+  else if (!reader && rw_lock->holders == 0)
+    rw_lock->holders = -1;
+  else {
+    struct rw_waiter waiter;
+
+    waiter.thread = thread_current();
+    waiter.reader = reader;
+    list_push_back(&rw_lock->waiters, &waiter.elem);
+    if (reader)
+      rw_lock->waiting_readers++;
+    else
+      rw_lock->waiting_writers++;
+
+    /* The releasing thread accounts for us in HOLDERS before
+       waking us up, so we own the lock once we return. */
+    thread_block();
+  }
+  intr_set_level(old_level);
 }
 
-/* Release a writer-centric readers-writers lock */
+/* Releases RW_LOCK, which the current thread must hold for
+   reading if READER is true, for writing otherwise.  If this
+   leaves the lock free and threads are waiting, ownership is
+   handed directly to the next reader batch or writer. */
 void rw_lock_release(struct rw_lock* rw_lock, bool reader) {
-  // Must hold the guard lock the entire time
-  lock_acquire(&rw_lock->lock);
+  enum intr_level old_level;
+
+  ASSERT(rw_lock != NULL);
 
+  old_level = intr_disable();
   if (reader) {
-    // Reader code: Wake any waiting writers if we are the last reader
-    rw_lock->AR--;
-    if (rw_lock->AR == 0 && rw_lock->WW > 0)
-      cond_signal(&rw_lock->write, &rw_lock->lock);
+    ASSERT(rw_lock->holders > 0);
+    rw_lock->holders--;
   } else {
-    // Writer code: First try to wake a waiting writer, otherwise all waiting readers
-    rw_lock->AW--;
-    if (rw_lock->WW > 0)
-      cond_signal(&rw_lock->write, &rw_lock->lock);
-    else if (rw_lock->WR > 0)
-      cond_broadcast(&rw_lock->read, &rw_lock->lock);
+    ASSERT(rw_lock->holders == -1);
+    rw_lock->holders = 0;
   }
 
-  // Release guard lock
-  lock_release(&rw_lock->lock);
+  if (rw_lock->holders == 0 && !list_empty(&rw_lock->waiters)) {
+    /* After a writer phase, a phase-fair lock lets the waiting
+       readers in first; otherwise writers take precedence. */
+    bool readers_first = !reader && rw_lock->phase_fair;
+    if (rw_lock->waiting_readers > 0 && (readers_first || rw_lock->waiting_writers == 0))
+      rw_lock_grant_readers(rw_lock);
+    else
+      rw_lock_grant_writer(rw_lock);
+  }
+  intr_set_level(old_level);
+}
+
+/* Initializes SEQLOCK.  A sequence lock suits data that is
+   read far more often than it is written: readers take no lock
+   at all, so they never sleep and never delay a writer. */
+void seqlock_init(struct seqlock* seqlock) {
+  ASSERT(seqlock != NULL);
+
+  seqlock->sequence = 0;
+}
+
+/* Begins a read-side section on SEQLOCK and returns the
+   sequence number to pass to seqlock_read_retry().  If a writer
+   is in the middle of an update, yields until it finishes.
+
+   May yield, so it must not be called within an interrupt
+   handler. */
+unsigned seqlock_read_begin(const struct seqlock* seqlock) {
+  unsigned start;
+
+  ASSERT(seqlock != NULL);
+  ASSERT(!intr_context());
+
+  while ((start = seqlock->sequence) & 1)
+    thread_yield();
+  barrier();
+  return start;
+}
+
+/* Returns true if a writer updated SEQLOCK since the
+   seqlock_read_begin() call that returned START, in which case
+   whatever was read in between must be discarded. */
+bool seqlock_read_retry(const struct seqlock* seqlock, unsigned start) {
+  ASSERT(seqlock != NULL);
+
+  barrier();
+  return seqlock->sequence != start;
+}
+
+/* Begins an update of the data protected by SEQLOCK. */
+void seqlock_write_begin(struct seqlock* seqlock) {
+  ASSERT(seqlock != NULL);
+  ASSERT(!(seqlock->sequence & 1));
+
+  seqlock->sequence++;
+  barrier();
+}
+
+/* Ends an update of the data protected by SEQLOCK. */
+void seqlock_write_end(struct seqlock* seqlock) {
+  ASSERT(seqlock != NULL);
+  ASSERT(seqlock->sequence & 1);
+
+  barrier();
+  seqlock->sequence++;
 }
 
 /* One semaphore in a list. */
@@ -43,15 +43,31 @@ void cond_broadcast(struct condition*, struct lock*);
 #define RW_WRITER 0
 
 struct rw_lock {
-  struct lock lock;
-  struct condition read, write;
-  int AR, WR, AW, WW;
+  int holders;              /* >0: active readers, -1: active writer, 0: free. */
+  unsigned waiting_readers; /* Number of readers in WAITERS. */
+  unsigned waiting_writers; /* Number of writers in WAITERS. */
+  bool phase_fair;          /* Alternate reader and writer phases? */
+  struct list waiters;      /* Waiting readers and writers, in arrival order. */
 };
 
 void rw_lock_init(struct rw_lock*);
+void rw_lock_init_fair(struct rw_lock*);
 void rw_lock_acquire(struct rw_lock*, bool reader);
 void rw_lock_release(struct rw_lock*, bool reader);
 
+/* Sequence lock.  Readers never block: they snapshot the
+   sequence number, read, and retry if a writer intervened.
+   Writers must exclude each other by some other means. */
+struct seqlock {
+  unsigned sequence; /* Odd while a write is in progress. */
+};
+
+void seqlock_init(struct seqlock*);
+unsigned seqlock_read_begin(const struct seqlock*);
+bool seqlock_read_retry(const struct seqlock*, unsigned start);
+void seqlock_write_begin(struct seqlock*);
+void seqlock_write_end(struct seqlock*);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
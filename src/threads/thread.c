@@ -7,7 +7,9 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/memtag.h"
 #include "threads/palloc.h"
+#include "threads/rcu.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -132,24 +134,35 @@ void thread_start(void) {
   sema_down(&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
+/* Called by the timer interrupt handler at each timer tick,
+   with USER true if the tick interrupted user code.
    Thus, this function runs in an external interrupt context. */
-void thread_tick(void) {
+void thread_tick(bool user UNUSED) {
   struct thread* t = thread_current();
 
   /* Update statistics. */
   if (t == idle_thread)
     idle_ticks++;
 #ifdef USERPROG
-  else if (t->pcb != NULL)
+  else if (t->pcb != NULL) {
     user_ticks++;
+    if (user)
+      t->pcb->rusage.user_ticks++;
+    else
+      t->pcb->rusage.kernel_ticks++;
+  }
 #endif
   else
     kernel_ticks++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
-    intr_yield_on_return();
+  /* Enforce preemption, unless T is inside an RCU read-side
+     section, in which case rcu_read_unlock() yields instead. */
+  if (++thread_ticks >= TIME_SLICE) {
+    if (t->rcu_read_depth > 0)
+      t->rcu_yield_pending = true;
+    else
+      intr_yield_on_return();
+  }
 }
 
 /* Prints thread statistics. */
@@ -183,7 +196,7 @@ tid_t thread_create(const char* name, int priority, thread_func* function, void*
   ASSERT(function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page(PAL_ZERO);
+  t = palloc_get_page(PAL_ZERO | PAL_TAG(MT_THREAD));
   if (t == NULL)
     return TID_ERROR;
 
@@ -521,6 +534,9 @@ void thread_switch_tail(struct thread* prev) {
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Every context switch ends an RCU grace period. */
+  rcu_note_context_switch();
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate();
@@ -551,8 +567,11 @@ static void schedule(void) {
 
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(cur->status != THREAD_RUNNING);
+  ASSERT(cur->rcu_read_depth == 0);
   ASSERT(is_thread(next));
 
+  cur->rcu_yield_pending = false;
+
   if (cur != next)
     prev = switch_threads(cur, next);
   thread_switch_tail(prev);
@@ -93,9 +93,17 @@ struct thread {
   /* Shared between thread.c and synch.c. */
   struct list_elem elem; /* List element. */
 
+  /* Shared between thread.c and rcu.c. */
+  int rcu_read_depth;     /* Nesting depth of RCU read-side sections. */
+  bool rcu_yield_pending; /* Preemption deferred by a read-side section? */
+
 #ifdef USERPROG
   /* Owned by process.c. */
-  struct process* pcb; /* Process control block if this thread is a userprog */
+  struct process* pcb;         /* Process control block if this thread is a userprog */
+  struct user_thread* uthread; /* This thread's entry in pcb's thread table */
+  void* tls;                   /* User address of TLS block, the base of %gs */
+  void* user_esp;              /* User stack pointer at the last system call */
+  long long read_cnt;          /* Sectors this thread has read from any disk */
 #endif
 
   /* Owned by thread.c. */
@@ -121,7 +129,7 @@ extern enum sched_policy active_sched_policy;
 void thread_init(void);
 void thread_start(void);
 
-void thread_tick(void);
+void thread_tick(bool user);
 void thread_print_stats(void);
 
 typedef void thread_func(void* aux);
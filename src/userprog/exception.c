@@ -3,14 +3,22 @@
 #include <stdio.h>
 #include "userprog/gdt.h"
 #include "userprog/process.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill(struct intr_frame*);
 static void page_fault(struct intr_frame*);
+#ifdef VM
+static void count_fault(long long read_cnt);
+#endif
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -97,9 +105,12 @@ static void kill(struct intr_frame* f) {
   }
 }
 
-/* Page fault handler.  This is a skeleton that must be filled in
-   to implement virtual memory.  Some solutions to project 2 may
-   also require modifying this code.
+/* Page fault handler.  With VM, brings in pages of the
+   process's address space on demand, grows user stacks, and
+   copies pages shared copy-on-write when they are first written.
+   A fault that none of that resolves fails the copy_from_user()
+   or copy_to_user() that took it, if one did, and otherwise
+   kills the process.
 
    At entry, the address that faulted is in CR2 (Control Register
    2) and information about the fault, formatted as described in
@@ -113,6 +124,9 @@ static void page_fault(struct intr_frame* f) {
   bool write;       /* True: access was write, false: access was read. */
   bool user;        /* True: access by user, false: access by kernel. */
   void* fault_addr; /* Fault address. */
+#ifdef VM
+  long long read_cnt = thread_current()->read_cnt; /* Sectors read before. */
+#endif
 
   /* Obtain faulting address, the virtual address that was
      accessed to cause the fault.  It may point to code or to
@@ -123,23 +137,72 @@ static void page_fault(struct intr_frame* f) {
      (#PF)". */
   asm("movl %%cr2, %0" : "=r"(fault_addr));
 
+  /* Count page faults, against the process too, while interrupts
+     are still off. */
+  page_fault_cnt++;
+#ifdef VM
+  if (thread_current()->pcb != NULL && thread_current()->pcb->pagedir != NULL)
+    thread_current()->pcb->fault_cnt++;
+#endif
+
   /* Turn interrupts back on (they were only off so that we could
      be assured of reading CR2 before it changed). */
   intr_enable();
 
-  /* Count page faults. */
-  page_fault_cnt++;
-
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* Bring in a page that is part of the process's address space
+     but not yet in memory, or grow the stack to take in the
+     address.  The kernel faults here too when a system call
+     touches such a page in a user buffer, in which case the
+     user's stack pointer is the one saved on entry to the
+     system call. */
+  if (not_present && is_user_vaddr(fault_addr) &&
+      (page_in(fault_addr) ||
+       page_grow_stack(fault_addr, user ? f->esp : thread_current()->user_esp))) {
+    count_fault(read_cnt);
+    return;
+  }
+
+  /* Copy a page shared copy-on-write since fork() on the first
+     write to it, by the process or by a system call on its
+     behalf. */
+  if (!not_present && write && is_user_vaddr(fault_addr) && page_unshare(fault_addr)) {
+    count_fault(read_cnt);
+    return;
+  }
+#endif
+
+  /* Fail a copy to or from user memory that is not there. */
+  if (!user) {
+    void* fixup = uaccess_fixup((void*)f->eip);
+    if (fixup != NULL) {
+      f->eip = (void (*)(void))fixup;
+      return;
+    }
+  }
+
   printf("Page fault at %p: %s error %s page in %s context.\n", fault_addr,
          not_present ? "not present" : "rights violation", write ? "writing" : "reading",
          user ? "user" : "kernel");
   kill(f);
 }
+
+#ifdef VM
+/* Charges a page fault just served to the current process, as a
+   major fault if serving it read from a disk, so that the
+   thread's READ_CNT has moved on from what it was at the fault,
+   and as a minor fault otherwise. */
+static void count_fault(long long read_cnt) {
+  struct rusage* ru = &thread_current()->pcb->rusage;
+
+  if (thread_current()->read_cnt != read_cnt)
+    ru->major_faults++;
+  else
+    ru->minor_faults++;
+}
+#endif
@@ -0,0 +1,137 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
+
+/* Fast user-space mutexes.
+
+   User-level locks and semaphores (lib/user/synch.c) live in
+   user memory and are manipulated with atomic instructions.  A
+   thread that must sleep calls futex_wait() on the address of
+   the word it is waiting on, and a thread that changes that word
+   in a way a sleeper cares about calls futex_wake().
+
+   Sleeping threads are kept in a fixed table of buckets hashed
+   by (process, user address), so that waits and wakes on
+   unrelated words rarely touch the same lock. */
+
+#define FUTEX_BUCKETS 64
+
+/* A bucket of sleeping threads. */
+struct futex_bucket {
+  struct lock lock;    /* Protects WAITERS. */
+  struct list waiters; /* List of struct futex_waiter. */
+};
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter {
+  struct list_elem elem;  /* Element in bucket's WAITERS. */
+  struct process* pcb;    /* Process whose address space UADDR is in. */
+  int* uaddr;             /* User address being waited on. */
+  struct semaphore sema;  /* Upped by futex_wake(). */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/* Initializes the futex table. */
+void futex_init(void) {
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++) {
+    lock_init(&buckets[i].lock);
+    list_init(&buckets[i].waiters);
+  }
+}
+
+/* Returns the bucket for UADDR in the running process. */
+static struct futex_bucket* futex_bucket(int* uaddr) {
+  struct process* pcb = thread_current()->pcb;
+
+  return &buckets[hash_int((int)pcb ^ (int)uaddr) % FUTEX_BUCKETS];
+}
+
+/* If the user word at UADDR still holds VAL, sleeps until a
+   futex_wake() on UADDR wakes us and returns 1.  Otherwise
+   returns 0 at once.  The check and the enqueue are atomic
+   with respect to futex_wake(), so a wake-up that follows a
+   change of *UADDR is never lost.
+
+   Also returns 0 at once if the process is exiting, and -1 if
+   the word cannot be read, as when another thread has just
+   unmapped it.  UADDR must be aligned. */
+int futex_wait(int* uaddr, int val) {
+  struct futex_bucket* b = futex_bucket(uaddr);
+  struct futex_waiter w;
+  int cur;
+
+  lock_acquire(&b->lock);
+  if (!copy_from_user(&cur, uaddr, sizeof cur)) {
+    lock_release(&b->lock);
+    return -1;
+  }
+  if (cur != val || thread_current()->pcb->reaper != NULL) {
+    lock_release(&b->lock);
+    return 0;
+  }
+  w.pcb = thread_current()->pcb;
+  w.uaddr = uaddr;
+  sema_init(&w.sema, 0);
+  list_push_back(&b->waiters, &w.elem);
+  lock_release(&b->lock);
+
+  sema_down(&w.sema);
+  return 1;
+}
+
+/* Wakes up to CNT threads of the running process sleeping on
+   UADDR, oldest first, and returns the number woken. */
+int futex_wake(int* uaddr, int cnt) {
+  struct process* pcb = thread_current()->pcb;
+  struct futex_bucket* b = futex_bucket(uaddr);
+  struct list_elem* e;
+  int woken = 0;
+
+  lock_acquire(&b->lock);
+  e = list_begin(&b->waiters);
+  while (e != list_end(&b->waiters) && woken < cnt) {
+    struct futex_waiter* w = list_entry(e, struct futex_waiter, elem);
+    e = list_next(e);
+    if (w->pcb == pcb && w->uaddr == uaddr) {
+      list_remove(&w->elem);
+      sema_up(&w->sema);
+      woken++;
+    }
+  }
+  lock_release(&b->lock);
+  return woken;
+}
+
+/* Wakes every thread of PCB sleeping on any address.  PCB's
+   reaper must already be set, so that none can go back to
+   sleep. */
+void futex_wake_process(struct process* pcb) {
+  int i;
+
+  ASSERT(pcb->reaper != NULL);
+
+  for (i = 0; i < FUTEX_BUCKETS; i++) {
+    struct futex_bucket* b = &buckets[i];
+    struct list_elem* e;
+
+    lock_acquire(&b->lock);
+    e = list_begin(&b->waiters);
+    while (e != list_end(&b->waiters)) {
+      struct futex_waiter* w = list_entry(e, struct futex_waiter, elem);
+      e = list_next(e);
+      if (w->pcb == pcb) {
+        list_remove(&w->elem);
+        sema_up(&w->sema);
+      }
+    }
+    lock_release(&b->lock);
+  }
+}
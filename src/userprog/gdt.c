@@ -28,6 +28,7 @@ static uint64_t gdt[SEL_CNT];
 static uint64_t make_code_desc(int dpl);
 static uint64_t make_data_desc(int dpl);
 static uint64_t make_tss_desc(void* laddr);
+static uint64_t make_tls_desc(void* base, size_t size);
 static uint64_t make_gdtr_operand(uint16_t limit, void* base);
 
 /* Sets up a proper GDT.  The bootstrap loader's GDT didn't
@@ -42,6 +43,7 @@ void gdt_init(void) {
   gdt[SEL_UCSEG / sizeof *gdt] = make_code_desc(3);
   gdt[SEL_UDSEG / sizeof *gdt] = make_data_desc(3);
   gdt[SEL_TSS / sizeof *gdt] = make_tss_desc(tss_get());
+  gdt[SEL_UTLS / sizeof *gdt] = make_tls_desc(NULL, 1);
 
   /* Load GDTR, TR.  See [IA32-v3a] 2.4.1 "Global Descriptor
      Table Register (GDTR)", 2.4.4 "Task Register (TR)", and
@@ -51,6 +53,19 @@ void gdt_init(void) {
   asm volatile("ltr %w0" : : "q"(SEL_TSS));
 }
 
+/* Points the user TLS segment at the SIZE bytes at user virtual
+   address BASE.  The running thread picks up the new segment the
+   next time %gs is reloaded, which happens on every return to
+   user mode, so process_activate() calls this on each switch to
+   a user thread.
+
+   The descriptor stays present at all times, so reloading %gs
+   never faults even in a kernel thread that happens to hold
+   SEL_UTLS. */
+void gdt_set_tls(void* base, size_t size) {
+  gdt[SEL_UTLS / sizeof *gdt] = make_tls_desc(base, size);
+}
+
 /* System segment or code/data segment? */
 enum seg_class {
   CLS_SYSTEM = 0,   /* System segment. */
@@ -120,6 +135,14 @@ static uint64_t make_tss_desc(void* laddr) {
   return make_seg_desc((uint32_t)laddr, 0x67, CLS_SYSTEM, 9, 0, GRAN_BYTE);
 }
 
+/* Returns a descriptor for a writable data segment covering the
+   SIZE bytes starting at BASE, with a DPL of 3, suitable for
+   loading into %gs to address a thread's TLS block. */
+static uint64_t make_tls_desc(void* base, size_t size) {
+  ASSERT(size > 0 && size <= 0x100000);
+  return make_seg_desc((uint32_t)base, size - 1, CLS_CODE_DATA, 2, 3, GRAN_BYTE);
+}
+
 /* Returns a descriptor that yields the given LIMIT and BASE when
    used as an operand for the LGDT instruction. */
 static uint64_t make_gdtr_operand(uint16_t limit, void* base) {
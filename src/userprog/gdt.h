@@ -1,6 +1,7 @@
 #ifndef USERPROG_GDT_H
 #define USERPROG_GDT_H
 
+#include <stddef.h>
 #include "threads/loader.h"
 
 /* Segment selectors.
@@ -8,8 +9,10 @@
 #define SEL_UCSEG 0x1B /* User code selector. */
 #define SEL_UDSEG 0x23 /* User data selector. */
 #define SEL_TSS 0x28   /* Task-state segment. */
-#define SEL_CNT 6      /* Number of segments. */
+#define SEL_UTLS 0x33  /* User thread-local storage selector. */
+#define SEL_CNT 7      /* Number of segments. */
 
 void gdt_init(void);
+void gdt_set_tls(void* base, size_t size);
 
 #endif /* userprog/gdt.h */
@@ -4,16 +4,17 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
+#include "threads/memtag.h"
 #include "threads/palloc.h"
 
-static void invalidate_pagedir(uint32_t*);
+static void invalidate_page(uint32_t*, const void* vaddr);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
    Returns the new page directory, or a null pointer if memory
    allocation fails. */
 uint32_t* pagedir_create(void) {
-  uint32_t* pd = palloc_get_page(0);
+  uint32_t* pd = palloc_get_page(PAL_TAG(MT_PAGEDIR));
   if (pd != NULL)
     memcpy(pd, init_page_dir, PGSIZE);
   return pd;
@@ -60,7 +61,7 @@ static uint32_t* lookup_page(uint32_t* pd, const void* vaddr, bool create) {
   pde = pd + pd_no(vaddr);
   if (*pde == 0) {
     if (create) {
-      pt = palloc_get_page(PAL_ZERO);
+      pt = palloc_get_page(PAL_ZERO | PAL_TAG(MT_PAGEDIR));
       if (pt == NULL)
         return NULL;
 
@@ -103,6 +104,37 @@ bool pagedir_set_page(uint32_t* pd, void* upage, void* kpage, bool writable) {
     return false;
 }
 
+/* Copies each user page mapped in page directory SRC into a new
+   page from the user pool, and maps the copy at the same address
+   in DST, writable if the original is.  Returns false if memory
+   runs out, leaving the pages copied so far mapped in DST, where
+   pagedir_destroy() frees them. */
+bool pagedir_copy(uint32_t* dst, uint32_t* src) {
+  uint32_t* pde;
+
+  ASSERT(dst != init_page_dir);
+  for (pde = src; pde < src + pd_no(PHYS_BASE); pde++)
+    if (*pde & PTE_P) {
+      uint32_t* pt = pde_get_pt(*pde);
+      size_t i;
+
+      for (i = 0; i < PGSIZE / sizeof *pt; i++)
+        if (pt[i] & PTE_P) {
+          void* upage = (void*)(((uintptr_t)(pde - src) << PDSHIFT) | (i << PTSHIFT));
+          void* kpage = palloc_get_page(PAL_USER);
+
+          if (kpage == NULL)
+            return false;
+          memcpy(kpage, pte_get_page(pt[i]), PGSIZE);
+          if (!pagedir_set_page(dst, upage, kpage, (pt[i] & PTE_W) != 0)) {
+            palloc_free_page(kpage);
+            return false;
+          }
+        }
+    }
+  return true;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -132,7 +164,27 @@ void pagedir_clear_page(uint32_t* pd, void* upage) {
   pte = lookup_page(pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0) {
     *pte &= ~PTE_P;
-    invalidate_pagedir(pd);
+    invalidate_page(pd, upage);
+  }
+}
+
+/* Makes the mapping of user virtual page UPAGE in page
+   directory PD writable if WRITABLE is true and read-only
+   otherwise.  Does nothing if UPAGE is not mapped. */
+void pagedir_set_writable(uint32_t* pd, void* upage, bool writable) {
+  uint32_t* pte;
+
+  ASSERT(pg_ofs(upage) == 0);
+  ASSERT(is_user_vaddr(upage));
+
+  pte = lookup_page(pd, upage, false);
+  if (pte != NULL && (*pte & PTE_P) != 0) {
+    if (writable)
+      *pte |= PTE_W;
+    else {
+      *pte &= ~(uint32_t)PTE_W;
+      invalidate_page(pd, upage);
+    }
   }
 }
 
@@ -154,7 +206,7 @@ void pagedir_set_dirty(uint32_t* pd, const void* vpage, bool dirty) {
       *pte |= PTE_D;
     else {
       *pte &= ~(uint32_t)PTE_D;
-      invalidate_pagedir(pd);
+      invalidate_page(pd, vpage);
     }
   }
 }
@@ -177,16 +229,20 @@ void pagedir_set_accessed(uint32_t* pd, const void* vpage, bool accessed) {
       *pte |= PTE_A;
     else {
       *pte &= ~(uint32_t)PTE_A;
-      invalidate_pagedir(pd);
+      invalidate_page(pd, vpage);
     }
   }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already there, as it is when switching
+   between threads of the same process: reloading it would only
+   flush the process's entries from the TLB for nothing. */
 void pagedir_activate(uint32_t* pd) {
   if (pd == NULL)
     pd = init_page_dir;
+  if (active_pd() == pd)
+    return;
 
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
@@ -207,18 +263,18 @@ uint32_t* active_pd(void) {
   return ptov(pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+/* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
-
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
-static void invalidate_pagedir(uint32_t* pd) {
-  if (active_pd() == pd) {
-    /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-    pagedir_activate(pd);
-  }
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the page whose PTE changed.
+
+   This function invalidates the TLB entry for VADDR if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.)  INVLPG drops just that one entry, so the rest of
+   the process's entries, and the kernel's, stay cached.  See
+   [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
+static void invalidate_page(uint32_t* pd, const void* vaddr) {
+  if (active_pd() == pd)
+    asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
 }
@@ -5,9 +5,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -16,12 +18,28 @@
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
+static thread_func start_pthread NO_RETURN;
+static thread_func start_fork NO_RETURN;
 static bool load(const char* file_name, void (**eip)(void), void** esp);
+static bool init_main_thread(struct thread*);
+static void reap_threads(struct process*);
+static void free_threads(struct process*);
+static void destroy_address_space(struct process*);
+static void close_fds(struct process*);
+static bool grow_fd_table(struct process*, int size);
+static void exec_done(uint64_t cycles);
+static void print_process_rusage(struct process*);
 CHILD* new_child(void);
 void t_pcb_init(struct thread*, struct process*, CHILD*);
 CHILD* find_child(pid_t);
@@ -30,20 +48,51 @@ void decrement_children_ref_cnt(struct process*);
 void exit_setup(struct process*);
 void free_spa(SPA*);
 
+/* A process's open files, indexed by fd.  Lookups read it
+   under RCU, without fd_lock; changes are made under fd_lock,
+   and growing it replaces it with a copy. */
+struct fd_table {
+  int size;                      /* Number of entries in FDS. */
+  struct rcu_head rcu;           /* Deferred free once replaced. */
+  struct file_descriptor* fds[]; /* Open files, null where the fd is free. */
+};
+
+/* Smallest file descriptor table allocated. */
+#define FD_TABLE_MIN 16
+
+/* Caches for process control blocks and file descriptors. */
+static struct kmem_cache process_cache;
+static struct kmem_cache file_des_cache;
+
+/* -rusage: Print each process's resource usage at exit? */
+bool print_rusage;
+
+/* Exec latency statistics, protected by disabling interrupts. */
+static long long exec_cnt;    /* Processes that reached user mode. */
+static long long exec_cycles; /* Total cycles from exec to user mode. */
+
 /* Initializes user programs in the system by ensuring the main
    thread has a minimal PCB so that it can execute and wait for
    the first user process. Any additions to the PCB should be also
    initialized here if main needs those members */
 void userprog_init(void) {
   struct thread* t = thread_current();
+  struct process* pcb;
   bool success;
 
+  kmem_cache_create(&process_cache, "process", MT_PROCESS, sizeof(struct process), NULL);
+  kmem_cache_create(&file_des_cache, "file_descriptor", MT_FD, sizeof(struct file_descriptor),
+                    NULL);
+
   /* Allocate process control block
-     It is imoprtant that this is a call to calloc and not malloc,
+     It is imoprtant that the PCB is zeroed before it is assigned,
      so that t->pcb->pagedir is guaranteed to be NULL (the kernel's
      page directory) when t->pcb is assigned, because a timer interrupt
      can come at any time and activate our pagedir */
-  t->pcb = calloc(sizeof(struct process), 1);
+  pcb = kmem_cache_alloc(&process_cache);
+  ASSERT(pcb != NULL);
+  memset(pcb, 0, sizeof *pcb);
+  t->pcb = pcb;
   t_pcb_init(t, t->pcb, NULL);
   success = t->pcb != NULL;
   /* Kill the kernel if we did not succeed */
@@ -52,7 +101,7 @@ void userprog_init(void) {
 }
 
 CHILD* new_child() {
-  CHILD* cptr = (CHILD*)palloc_get_page(0);
+  CHILD* cptr = (CHILD*)palloc_get_page(PAL_TAG(MT_PROCESS));
   if (cptr == NULL) {
     return NULL;
   }
@@ -82,42 +131,54 @@ pid_t process_execute(const char* file_name) {
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-  spaptr = (SPA*)palloc_get_page(0);
+  spaptr = (SPA*)palloc_get_page(PAL_TAG(MT_PROCESS));
   if (spaptr == NULL)
     return TID_ERROR;
-  spaptr->file_name = palloc_get_page(0);
+  spaptr->exec_start = timer_cycles();
+  spaptr->file_name = palloc_get_page(PAL_TAG(MT_PROCESS));
   spaptr->new_c = new_child();
   spaptr->cwd = thread_current()->pcb->cwd;
   if (spaptr->file_name == NULL || spaptr->new_c == NULL) {
+    free_spa(spaptr);
     return TID_ERROR;
   }
   strlcpy(spaptr->file_name, file_name, PGSIZE - sizeof(spaptr->new_c));
 
-  char* file_name_cpy = (char*)malloc(sizeof(char) * (strlen(file_name) + 1));
+  char* file_name_cpy = (char*)malloc_tagged(strlen(file_name) + 1, MT_PROCESS);
+  if (file_name_cpy == NULL) {
+    free_spa(spaptr);
+    return TID_ERROR;
+  }
   char* cpy_base = file_name_cpy;
   strlcpy(file_name_cpy, file_name, strlen(file_name) + 1);
   char** saveptr = &file_name_cpy;
   char* prog_name = strtok_r(file_name_cpy, " ", saveptr);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create(prog_name, PRI_DEFAULT, start_process, spaptr);
-  sema_down(&spaptr->new_c->exec_sema);
+  /* Create a new thread to execute FILE_NAME.  If there is none,
+     nothing will ever up the exec semaphore or wait for the
+     child, so free it all here. */
+  tid = prog_name != NULL ? thread_create(prog_name, PRI_DEFAULT, start_process, spaptr)
+                          : TID_ERROR;
   free(cpy_base);
-  struct process* pcb = thread_current()->pcb;
-  list_push_front(&pcb->children, &spaptr->new_c->elem);
   if (tid == TID_ERROR) {
     free_spa(spaptr);
-  } else {
-    if (spaptr->new_c->is_exited && spaptr->new_c->exit_status == ERROR) {
-      tid = -1;
-    }
-    palloc_free_page(spaptr);
+    return TID_ERROR;
   }
+
+  sema_down(&spaptr->new_c->exec_sema);
+  struct process* pcb = thread_current()->pcb;
+  list_push_front(&pcb->children, &spaptr->new_c->elem);
+  if (spaptr->new_c->is_exited && spaptr->new_c->exit_status == ERROR) {
+    tid = -1;
+  }
+  palloc_free_page(spaptr);
   return tid;
 }
 
 void t_pcb_init(struct thread* t, struct process* new_pcb, CHILD* new_c) {
   new_pcb->pagedir = NULL;
+  new_pcb->curr_executable = NULL;
+  memset(&new_pcb->rusage, 0, sizeof new_pcb->rusage);
   t->pcb = new_pcb;
   t->pcb->main_thread = t;
   strlcpy(t->pcb->process_name, t->name, sizeof t->name);
@@ -127,8 +188,17 @@ void t_pcb_init(struct thread* t, struct process* new_pcb, CHILD* new_c) {
     new_c->pid = get_pid(new_pcb);
   }
   /* Initialize fd related structure member */
-  t->pcb->cur_fd = 2;
-  list_init(&t->pcb->file_descriptor_table);
+  t->pcb->fd_table = NULL;
+  t->pcb->fd_free = 2;
+  lock_init(&t->pcb->fd_lock);
+  /* Initialize thread table */
+  lock_init(&t->pcb->threads_lock);
+  cond_init(&t->pcb->thread_exited);
+  list_init(&t->pcb->threads);
+  t->pcb->thread_cnt = 1;
+  t->pcb->stack_cnt = 0;
+  list_init(&t->pcb->free_stacks);
+  t->pcb->reaper = NULL;
 }
 
 /* A thread function that loads a user process and starts it
@@ -137,12 +207,13 @@ static void start_process(void* spaptr_) {
   SPA* spaptr = (SPA*)spaptr_;
   char* file_name = spaptr->file_name;
   CHILD* new_c = spaptr->new_c;
+  uint64_t exec_start = spaptr->exec_start;
   struct thread* t = thread_current();
   struct intr_frame if_;
   bool success, pcb_success;
 
   /* Allocate process control block */
-  struct process* new_pcb = malloc(sizeof(struct process));
+  struct process* new_pcb = kmem_cache_alloc(&process_cache);
   success = pcb_success = new_pcb != NULL;
 
   /* Initialize process control block */
@@ -156,7 +227,8 @@ static void start_process(void* spaptr_) {
   /* Initialize interrupt frame and load executable. */
   if (success) {
     memset(&if_, 0, sizeof if_);
-    if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+    if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+    if_.gs = SEL_UTLS;
     if_.cs = SEL_UCSEG;
     if_.eflags = FLAG_IF | FLAG_MBS;
 
@@ -172,11 +244,8 @@ static void start_process(void* spaptr_) {
     success = load(file_name, &if_.eip, &if_.esp);
   }
 
-  if (success) {
-    struct file* file = filesys_open(t->pcb->process_name, NULL);
-    t->pcb->curr_executable = file;
-    file_deny_write(file);
-  }
+  if (success)
+    success = init_main_thread(t);
 
   /* Handle failure with succesful PCB malloc. Must free the PCB */
   if (!success && pcb_success) {
@@ -185,9 +254,11 @@ static void start_process(void* spaptr_) {
     // can try to activate the pagedir, but it is now freed memory
     struct process* pcb_to_free = t->pcb;
     new_c->exit_status = ERROR;
+    destroy_address_space(pcb_to_free);
+    file_close(pcb_to_free->curr_executable);
     exit_setup(pcb_to_free);
     t->pcb = NULL;
-    free(pcb_to_free);
+    kmem_cache_free(&process_cache, pcb_to_free);
   }
   sema_up(&new_c->exec_sema);
 
@@ -197,6 +268,8 @@ static void start_process(void* spaptr_) {
     thread_exit();
   }
 
+  exec_done(timer_cycles() - exec_start);
+
   /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
      threads/intr-stubs.S).  Because intr_exit takes all of its
@@ -207,6 +280,248 @@ static void start_process(void* spaptr_) {
   NOT_REACHED();
 }
 
+/* Records that a process took CYCLES from exec to running its
+   first user instruction. */
+static void exec_done(uint64_t cycles) {
+  enum intr_level old_level = intr_disable();
+  exec_cnt++;
+  exec_cycles += cycles;
+  intr_set_level(old_level);
+}
+
+/* Prints exec latency statistics. */
+void process_print_stats(void) {
+  if (exec_cnt > 0)
+    printf("Exec: %lld processes, %lld cycles from exec to first instruction on average\n",
+           exec_cnt, exec_cycles / exec_cnt);
+}
+
+/* Stores the current process's resource usage so far into RU. */
+void process_get_rusage(struct rusage* ru) {
+  enum intr_level old_level = intr_disable();
+  *ru = thread_current()->pcb->rusage;
+  intr_set_level(old_level);
+}
+
+/* Prints PCB's resource usage, for -rusage, as it exits. */
+static void print_process_rusage(struct process* pcb) {
+  const struct rusage* ru = &pcb->rusage;
+  int i;
+
+  printf("%s: rusage: %lld user ticks, %lld kernel ticks, %lld minor faults, "
+         "%lld major faults, %lld sectors read, %lld sectors written, "
+         "%zu peak resident pages\n",
+         pcb->process_name, ru->user_ticks, ru->kernel_ticks, ru->minor_faults,
+         ru->major_faults, ru->sectors_read, ru->sectors_written, ru->peak_resident_pages);
+  printf("%s: rusage: syscalls:", pcb->process_name);
+  for (i = 0; i < RUSAGE_SYSCALL_CNT; i++)
+    if (ru->syscalls[i] != 0)
+      printf(" %d:%lld", i, ru->syscalls[i]);
+  printf("\n");
+}
+
+/* Arguments passed from process_fork() to start_fork(). */
+struct fork_start {
+  struct intr_frame if_;        /* Parent's user context at fork(). */
+  struct process* parent;       /* Process being forked. */
+  struct thread* parent_thread; /* Thread that called fork(). */
+  CHILD* new_c;                 /* The child's entry in PARENT's children. */
+  bool success;                 /* Did the child start? */
+};
+
+/* Creates a child of the current process that is a copy of it,
+   as fork() does, and returns the child's process id, or
+   TID_ERROR if the child cannot be created.  The child's single
+   thread resumes from the user context in F, the calling
+   thread's, with 0 as the system call's return value. */
+pid_t process_fork(const struct intr_frame* f) {
+  struct thread* cur = thread_current();
+  struct fork_start fs;
+  tid_t tid;
+
+  fs.if_ = *f;
+  fs.parent = cur->pcb;
+  fs.parent_thread = cur;
+  fs.new_c = new_child();
+  fs.success = false;
+  if (fs.new_c == NULL)
+    return TID_ERROR;
+
+  tid = thread_create(cur->pcb->process_name, PRI_DEFAULT, start_fork, &fs);
+  if (tid == TID_ERROR) {
+    palloc_free_page(fs.new_c);
+    return TID_ERROR;
+  }
+  sema_down(&fs.new_c->exec_sema);
+  list_push_front(&cur->pcb->children, &fs.new_c->elem);
+  return fs.success ? tid : TID_ERROR;
+}
+
+/* Gives the running thread's process, a child just forked from
+   PARENT, a copy of PARENT's address space and a reopened copy of
+   its executable, with writes denied.  Without VM, every page is
+   copied at once; with VM, pages are shared copy-on-write (see
+   vm/page.c). */
+static bool fork_address_space(struct process* parent) {
+  struct process* pcb = thread_current()->pcb;
+
+#ifdef VM
+  if (!page_table_init(pcb))
+    return false;
+  mmap_init(pcb);
+#endif
+  pcb->pagedir = pagedir_create();
+  if (pcb->pagedir == NULL) {
+#ifdef VM
+    page_table_destroy(pcb);
+#endif
+    return false;
+  }
+  process_activate();
+
+  pcb->curr_executable = file_reopen(parent->curr_executable);
+  if (pcb->curr_executable == NULL)
+    return false;
+  file_deny_write(pcb->curr_executable);
+
+#ifdef VM
+  return page_fork(parent) && mmap_fork(parent);
+#else
+  pcb->rusage.resident_pages = pcb->rusage.peak_resident_pages = parent->rusage.resident_pages;
+  return pagedir_copy(pcb->pagedir, parent->pagedir);
+#endif
+}
+
+/* Gives the running thread's process, a child just forked from
+   PARENT, a descriptor for each of PARENT's open files, with the
+   same number and file position.  The child's files are reopened,
+   so that from now on each process has its own position. */
+static bool fork_fds(struct process* parent) {
+  struct process* pcb = thread_current()->pcb;
+  struct fd_table* pt;
+  bool success = true;
+  int fd;
+
+  lock_acquire(&parent->fd_lock);
+  pt = parent->fd_table;
+  if (pt != NULL && !grow_fd_table(pcb, pt->size))
+    success = false;
+  for (fd = 0; success && pt != NULL && fd < pt->size; fd++) {
+    struct file_descriptor* pd = pt->fds[fd];
+    struct file_descriptor* d;
+
+    if (pd == NULL)
+      continue;
+    d = alloc_file_des();
+    if (d == NULL || (d->file = file_reopen(pd->file)) == NULL) {
+      if (d != NULL)
+        kmem_cache_free(&file_des_cache, d);
+      success = false;
+      break;
+    }
+    file_seek(d->file, file_tell(pd->file));
+    d->fd = fd;
+    d->ref_cnt = 1;
+    d->is_directory = pd->is_directory;
+    d->dir = dir_open(file_get_inode(d->file));
+    pcb->fd_table->fds[fd] = d;
+  }
+  pcb->fd_free = parent->fd_free;
+  lock_release(&parent->fd_lock);
+  return success;
+}
+
+/* Enters the running thread T, the main thread of a child just
+   forked from PARENT by PARENT_THREAD, into its process's thread
+   table.  T takes over PARENT_THREAD's stack slot and TLS block,
+   already copied along with the address space; the other slots
+   that PARENT has handed out are free for the child's later
+   threads. */
+static bool fork_main_thread(struct thread* t, struct process* parent,
+                             struct thread* parent_thread) {
+  struct process* pcb = t->pcb;
+  struct user_thread* ut = malloc_tagged(sizeof *ut, MT_PROCESS);
+  int slot = parent_thread->uthread->stack->slot;
+  int i;
+
+  if (ut == NULL)
+    return false;
+  ut->stack = NULL;
+  lock_acquire(&parent->threads_lock);
+  pcb->stack_cnt = parent->stack_cnt;
+  lock_release(&parent->threads_lock);
+  for (i = pcb->stack_cnt - 1; i >= 0; i--) {
+    struct user_stack* us = malloc_tagged(sizeof *us, MT_PROCESS);
+    if (us == NULL) {
+      free(ut->stack);
+      free(ut);
+      return false;
+    }
+    us->slot = i;
+    if (i == slot)
+      ut->stack = us;
+    else
+      list_push_front(&pcb->free_stacks, &us->elem);
+  }
+
+  ut->tid = t->tid;
+  ut->thread = t;
+  ut->exited = ut->joined = false;
+  sema_init(&ut->join_sema, 0);
+  list_push_back(&pcb->threads, &ut->elem);
+  t->uthread = ut;
+  t->tls = parent_thread->tls;
+  ((uint32_t*)t->tls)[1] = t->tid;
+  gdt_set_tls(t->tls, USER_TLS_SIZE);
+  return true;
+}
+
+/* A thread function that makes the running thread the main
+   thread of a copy of the process that called fork(), and starts
+   it running in user mode where the parent left off. */
+static void start_fork(void* fs_) {
+  struct fork_start* fs = fs_;
+  struct process* parent = fs->parent;
+  CHILD* new_c = fs->new_c;
+  struct thread* t = thread_current();
+  struct intr_frame if_ = fs->if_;
+  struct process* new_pcb = kmem_cache_alloc(&process_cache);
+  bool success, pcb_success;
+
+  success = pcb_success = new_pcb != NULL;
+  if (success) {
+    t_pcb_init(t, new_pcb, new_c);
+    t->pcb->cwd = dir_reopen(parent->cwd);
+    success = fork_address_space(parent) && fork_fds(parent) &&
+              fork_main_thread(t, parent, fs->parent_thread);
+  }
+
+  /* Tear down a partial copy, as start_process() does. */
+  if (!success && pcb_success) {
+    struct process* pcb_to_free = t->pcb;
+    new_c->exit_status = ERROR;
+    destroy_address_space(pcb_to_free);
+    file_close(pcb_to_free->curr_executable);
+    close_fds(pcb_to_free);
+    free_threads(pcb_to_free);
+    exit_setup(pcb_to_free);
+    t->pcb = NULL;
+    t->uthread = NULL;
+    t->tls = NULL;
+    kmem_cache_free(&process_cache, pcb_to_free);
+  }
+
+  /* FS lives on the parent's stack: do not touch it after this. */
+  fs->success = success;
+  sema_up(&new_c->exec_sema);
+  if (!success)
+    thread_exit();
+
+  if_.eax = 0;
+  asm volatile("movl %0, %%esp; jmp intr_exit" : : "g"(&if_) : "memory");
+  NOT_REACHED();
+}
+
 CHILD* find_child(pid_t pid) {
   struct list* children = &thread_current()->pcb->children;
   CHILD* cptr;
@@ -274,46 +589,169 @@ void exit_setup(struct process* pcb_to_free) {
   sema_up(&pcb_to_free->curr_as_child->wait_sema);
 }
 
+/* Returns the current process's descriptor for FD, with a
+   reference that the caller must drop with put_file_des() once
+   done with it, or a null pointer if FD is not open.  The
+   reference keeps the descriptor's file open even if another
+   thread closes FD meanwhile.  The table is read under RCU, so
+   lookups never wait on fd_lock, even while the table grows. */
 struct file_descriptor* find_file_des(int fd) {
   struct process* pcb = thread_current()->pcb;
-  struct list_elem* e;
-  for (e = list_begin(&(pcb->file_descriptor_table)); e != list_end(&(pcb->file_descriptor_table));
-       e = list_next(e)) {
-    struct file_descriptor* descriptor = list_entry(e, struct file_descriptor, elem);
-    if (descriptor->fd == fd) {
-      return descriptor;
-    }
+  struct file_descriptor* found = NULL;
+  struct fd_table* table;
+
+  /* Nothing preempts a thread under RCU, so the last reference
+     cannot be dropped between the check and the increment.  A
+     descriptor with no references left is on its way out. */
+  rcu_read_lock();
+  table = pcb->fd_table;
+  if (table != NULL && fd >= 0 && fd < table->size) {
+    found = table->fds[fd];
+    if (found != NULL && found->ref_cnt > 0)
+      found->ref_cnt++;
+    else
+      found = NULL;
   }
-  return NULL;
+  rcu_read_unlock();
+  return found;
 }
 
-/* Free the current process's resources. */
+/* Drops a reference to DESCRIPTOR, closing its file and freeing
+   it if that was the last. */
+void put_file_des(struct file_descriptor* descriptor) {
+  enum intr_level old_level = intr_disable();
+  bool last = --descriptor->ref_cnt == 0;
+  intr_set_level(old_level);
+
+  if (last) {
+    file_close(descriptor->file);
+    free_file_des(descriptor);
+  }
+}
+
+/* Enters DESCRIPTOR into the current process's table under the
+   lowest free fd, which it also stores in DESCRIPTOR, and returns
+   that fd.  The table takes over the caller's reference.  Returns
+   -1 if memory is not available to grow the table. */
+int add_file_des(struct file_descriptor* descriptor) {
+  struct process* pcb = thread_current()->pcb;
+  int fd;
+
+  lock_acquire(&pcb->fd_lock);
+  fd = pcb->fd_free;
+  while (pcb->fd_table != NULL && fd < pcb->fd_table->size && pcb->fd_table->fds[fd] != NULL)
+    fd++;
+  if (!grow_fd_table(pcb, fd + 1)) {
+    lock_release(&pcb->fd_lock);
+    return -1;
+  }
+  descriptor->fd = fd;
+  descriptor->ref_cnt = 1;
+  barrier();
+  pcb->fd_table->fds[fd] = descriptor;
+  pcb->fd_free = fd + 1;
+  lock_release(&pcb->fd_lock);
+  return fd;
+}
+
+/* Removes the current process's descriptor for FD from its table
+   and returns it, with the table's reference passed on to the
+   caller to drop with put_file_des(), or returns a null pointer
+   if FD is not open. */
+struct file_descriptor* remove_file_des(int fd) {
+  struct process* pcb = thread_current()->pcb;
+  struct fd_table* table;
+  struct file_descriptor* descriptor = NULL;
+
+  lock_acquire(&pcb->fd_lock);
+  table = pcb->fd_table;
+  if (table != NULL && fd >= 0 && fd < table->size && table->fds[fd] != NULL) {
+    descriptor = table->fds[fd];
+    table->fds[fd] = NULL;
+    if (fd < pcb->fd_free)
+      pcb->fd_free = fd;
+  }
+  lock_release(&pcb->fd_lock);
+  return descriptor;
+}
+
+/* Frees file descriptor table TABLE, replaced by a bigger one,
+   once no lookup can still be reading it. */
+static void free_fd_table_rcu(struct rcu_head* head) {
+  free(rcu_entry(head, struct fd_table, rcu));
+}
+
+/* Makes PCB's file descriptor table big enough to hold fd
+   SIZE - 1, at least doubling it if it must grow, so that a
+   process that opens many files copies its table only a few
+   times.  Lookups that are still reading the old table see the
+   same descriptors in it; it is freed once they are done.
+   PCB's fd_lock must be held, unless PCB is still being created.
+   Returns false if memory is not available. */
+static bool grow_fd_table(struct process* pcb, int size) {
+  struct fd_table* old = pcb->fd_table;
+  struct fd_table* new;
+  int old_size = old != NULL ? old->size : 0;
+  int new_size;
+
+  if (size <= old_size)
+    return true;
+  new_size = old_size * 2 > FD_TABLE_MIN ? old_size * 2 : FD_TABLE_MIN;
+  if (new_size < size)
+    new_size = size;
+
+  new = malloc_tagged(sizeof *new + new_size * sizeof *new->fds, MT_FD);
+  if (new == NULL)
+    return false;
+  new->size = new_size;
+  if (old_size > 0)
+    memcpy(new->fds, old->fds, old_size * sizeof *new->fds);
+  memset(new->fds + old_size, 0, (new_size - old_size) * sizeof *new->fds);
+
+  /* Fill in the new table before anyone can see it. */
+  barrier();
+  pcb->fd_table = new;
+  if (old != NULL)
+    call_rcu(&old->rcu, free_fd_table_rcu);
+  return true;
+}
+
+/* Returns a new, uninitialized file descriptor, or a null
+   pointer if memory is not available. */
+struct file_descriptor* alloc_file_des(void) { return kmem_cache_alloc(&file_des_cache); }
+
+static void free_file_des_rcu(struct rcu_head* head) {
+  kmem_cache_free(&file_des_cache, rcu_entry(head, struct file_descriptor, rcu));
+}
+
+/* Frees DESCRIPTOR, which the caller has already removed from
+   its table, once no concurrent lookup can still see it. */
+void free_file_des(struct file_descriptor* descriptor) {
+  call_rcu(&descriptor->rcu, free_file_des_rcu);
+}
+
+/* Free the current process's resources.  The first thread to
+   get here terminates every other thread of the process and then
+   tears it down; any other thread simply exits. */
 void process_exit(void) {
   struct thread* cur = thread_current();
-  uint32_t* pd;
   /* If this thread does not have a PCB, don't worry */
   if (cur->pcb == NULL) {
     thread_exit();
     NOT_REACHED();
   }
 
-  file_close(cur->pcb->curr_executable);
-
-  /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
-  pd = cur->pcb->pagedir;
-  if (pd != NULL) {
-    /* Correct ordering here is crucial.  We must set
-         cur->pcb->pagedir to NULL before switching page directories,
-         so that a timer interrupt can't switch back to the
-         process page directory.  We must activate the base page
-         directory before destroying the process's page
-         directory, or our active page directory will be one
-         that's been freed (and cleared). */
-    cur->pcb->pagedir = NULL;
-    pagedir_activate(NULL);
-    pagedir_destroy(pd);
+  lock_acquire(&cur->pcb->threads_lock);
+  if (cur->pcb->reaper != NULL && cur->pcb->reaper != cur) {
+    lock_release(&cur->pcb->threads_lock);
+    pthread_exit();
   }
+  cur->pcb->reaper = cur;
+  lock_release(&cur->pcb->threads_lock);
+  reap_threads(cur->pcb);
+
+  destroy_address_space(cur->pcb);
+  file_close(cur->pcb->curr_executable);
 
   /* Free the PCB of this process and kill this thread
      Avoid race where PCB is freed before t->pcb is set to NULL
@@ -321,22 +759,60 @@ void process_exit(void) {
      can try to activate the pagedir, but it is now freed memory */
   struct process* pcb_to_free = cur->pcb;
 
-  /* Close all the file descriptors */
-  struct list_elem* cur_file = list_begin(&pcb_to_free->file_descriptor_table);
-  while (cur_file != list_end(&pcb_to_free->file_descriptor_table)) {
-    struct file_descriptor* descriptor = list_entry(cur_file, struct file_descriptor, elem);
-    cur_file = list_next(cur_file);
-    file_close(descriptor->file);
-    free(descriptor);
-  }
+  close_fds(pcb_to_free);
 
   printf("%s: exit(%d)\n", pcb_to_free->process_name, pcb_to_free->curr_as_child->exit_status);
+  if (print_rusage)
+    print_process_rusage(pcb_to_free);
+  free_threads(pcb_to_free);
   cur->pcb = NULL;
+  cur->uthread = NULL;
+  cur->tls = NULL;
   exit_setup(pcb_to_free);
-  free(pcb_to_free);
+  kmem_cache_free(&process_cache, pcb_to_free);
   thread_exit();
 }
 
+/* Closes all of PCB's file descriptors. */
+static void close_fds(struct process* pcb) {
+  struct fd_table* table = pcb->fd_table;
+  int fd;
+
+  if (table == NULL)
+    return;
+  for (fd = 0; fd < table->size; fd++)
+    if (table->fds[fd] != NULL) {
+      file_close(table->fds[fd]->file);
+      kmem_cache_free(&file_des_cache, table->fds[fd]);
+    }
+  pcb->fd_table = NULL;
+  free(table);
+}
+
+/* Destroys the page directory of PCB, which must be the running
+   thread's process, and switches back to the kernel-only page
+   directory. */
+static void destroy_address_space(struct process* pcb) {
+  uint32_t* pd = pcb->pagedir;
+
+  if (pd != NULL) {
+    /* Correct ordering here is crucial.  We must set
+         pcb->pagedir to NULL before switching page directories,
+         so that a timer interrupt can't switch back to the
+         process page directory.  We must activate the base page
+         directory before destroying the process's page
+         directory, or our active page directory will be one
+         that's been freed (and cleared). */
+    pcb->pagedir = NULL;
+    pagedir_activate(NULL);
+#ifdef VM
+    page_table_destroy(pcb);
+    mmap_destroy(pcb);
+#endif
+    pagedir_destroy(pd);
+  }
+}
+
 /* Sets up the CPU for running user code in the current
    thread. This function is called on every context switch. */
 void process_activate(void) {
@@ -348,6 +824,10 @@ void process_activate(void) {
   else
     pagedir_activate(NULL);
 
+  /* Point %gs at the thread's TLS block. */
+  if (t->pcb != NULL && t->tls != NULL)
+    gdt_set_tls(t->tls, USER_TLS_SIZE);
+
   /* Set thread's kernel stack for use in processing interrupts.
      This does nothing if this is not a user process. */
   tss_update();
@@ -451,9 +931,9 @@ void args_split(char* file_name, char* argv[]) {
 }
 
 void args_load(const char* file_name, void** esp) {
-  char* file_name_cpy = (char*)malloc(sizeof(char) * (strlen(file_name) + 1));
+  char* file_name_cpy = (char*)malloc_tagged(strlen(file_name) + 1, MT_PROCESS);
   int nArgs = count_args(file_name);
-  char** args = (char**)malloc(sizeof(char*) * nArgs);
+  char** args = (char**)malloc_tagged(sizeof(char*) * nArgs, MT_PROCESS);
   unsigned int allByteCount = sizeof(char*) * (nArgs + 1) + sizeof(char**) + sizeof(int);
   strlcpy(file_name_cpy, file_name, strlen(file_name) + 1);
   // get all arguments in file_name_cpy
@@ -461,7 +941,7 @@ void args_load(const char* file_name, void** esp) {
   // push all arguments onto user stack, record the location of each arg on the stack
   // accumulate the used bytes on stack
   int argByteCount = 0;
-  char** argsAddrInStack = (char**)malloc(sizeof(char*) * nArgs + 1);
+  char** argsAddrInStack = (char**)malloc_tagged(sizeof(char*) * nArgs + 1, MT_PROCESS);
   char* arg;
   for (int argIndex = nArgs - 1; argIndex >= 0; argIndex--) {
     arg = args[argIndex];
@@ -472,7 +952,7 @@ void args_load(const char* file_name, void** esp) {
   }
   // push stack-aglin onto user stack
   argByteCount = sizeof(uint8_t) * ((0b10000 - (allByteCount & 0b1111)) & 0b1111);
-  uint8_t* arg_zeros = calloc(argByteCount / sizeof(uint8_t), sizeof(uint8_t));
+  uint8_t* arg_zeros = calloc_tagged(argByteCount / sizeof(uint8_t), sizeof(uint8_t), MT_PROCESS);
   push_stack(esp, arg_zeros, sizeof(uint8_t) * argByteCount);
   free(arg_zeros);
   // push NULL ptr after stack-aglin by convention
@@ -494,6 +974,8 @@ void args_load(const char* file_name, void** esp) {
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
+   On success, the executable stays open, with writes denied, as
+   the process's curr_executable.
    Returns true if successful, false otherwise. */
 bool load(const char* file_name, void (**eip)(void), void** esp) {
   struct thread* t = thread_current();
@@ -504,9 +986,18 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
   int i;
 
   /* Allocate and activate page directory. */
+#ifdef VM
+  if (!page_table_init(t->pcb))
+    goto done;
+  mmap_init(t->pcb);
+#endif
   t->pcb->pagedir = pagedir_create();
-  if (t->pcb->pagedir == NULL)
+  if (t->pcb->pagedir == NULL) {
+#ifdef VM
+    page_table_destroy(t->pcb);
+#endif
     goto done;
+  }
   process_activate();
 
   /* Open executable file. */
@@ -589,13 +1080,19 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
 
 done:
   /* We arrive here whether the load is successful or not. */
-  file_close(file);
+  if (success) {
+    file_deny_write(file);
+    t->pcb->curr_executable = file;
+  } else
+    file_close(file);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page(void* upage, void* kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -652,6 +1149,9 @@ static bool validate_segment(const struct Elf32_Phdr* phdr, struct file* file) {
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With VM, the pages are only recorded in the supplemental page
+   table, and each is read in when the process first touches it.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t read_bytes,
@@ -668,6 +1168,12 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
     size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
     size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+    if (!page_add_file(upage, file, ofs, page_read_bytes, writable))
+      return false;
+    ofs += page_read_bytes;
+#else
+
     /* Get a page of memory. */
     uint8_t* kpage = palloc_get_page(PAL_USER);
     if (kpage == NULL)
@@ -685,6 +1191,7 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
       palloc_free_page(kpage);
       return false;
     }
+#endif
 
     /* Advance. */
     read_bytes -= page_read_bytes;
@@ -695,22 +1202,28 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, leaving room above the stack pointer for
+   the main thread's TLS block. */
 static bool setup_stack(void** esp) {
-  uint8_t* kpage;
+  uint8_t* upage = (uint8_t*)PHYS_BASE - PGSIZE;
   bool success = false;
 
-  kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+#ifdef VM
+  success = page_add_zero(upage, true) && page_in(upage);
+#else
+  uint8_t* kpage = palloc_get_page(PAL_USER | PAL_ZERO);
   if (kpage != NULL) {
-    success = install_page(((uint8_t*)PHYS_BASE) - PGSIZE, kpage, true);
-    if (success)
-      *esp = PHYS_BASE;
-    else
+    success = install_page(upage, kpage, true);
+    if (!success)
       palloc_free_page(kpage);
   }
+#endif
+  if (success)
+    *esp = (uint8_t*)PHYS_BASE - USER_TLS_SIZE;
   return success;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -722,15 +1235,370 @@ static bool setup_stack(void** esp) {
    if memory allocation fails. */
 static bool install_page(void* upage, void* kpage, bool writable) {
   struct thread* t = thread_current();
+  struct rusage* ru = &t->pcb->rusage;
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
-  return (pagedir_get_page(t->pcb->pagedir, upage) == NULL &&
-          pagedir_set_page(t->pcb->pagedir, upage, kpage, writable));
+  if (pagedir_get_page(t->pcb->pagedir, upage) != NULL ||
+      !pagedir_set_page(t->pcb->pagedir, upage, kpage, writable))
+    return false;
+
+  /* Without VM, pages stay in memory until the process exits. */
+  ru->peak_resident_pages = ++ru->resident_pages;
+  return true;
 }
+#endif
 
 /* Returns true if t is the main thread of the process p */
 bool is_main_thread(struct thread* t, struct process* p) { return p->main_thread == t; }
 
 /* Gets the PID of a process */
 pid_t get_pid(struct process* p) { return (pid_t)p->main_thread->tid; }
+
+/* Returns true if the user stack slot of A is below (i.e. at a
+   higher address than) that of B. */
+static bool stack_less(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED) {
+  return list_entry(a, struct user_stack, elem)->slot <
+         list_entry(b, struct user_stack, elem)->slot;
+}
+
+/* Hands out a user stack slot for a new thread of PCB, preferring
+   the highest slot given back by an exited thread, whose pages
+   are still mapped.  Returns a null pointer if the process has
+   used up all MAX_THREADS slots.  PCB's threads_lock must be
+   held. */
+static struct user_stack* take_stack(struct process* pcb) {
+  struct user_stack* us;
+
+  if (!list_empty(&pcb->free_stacks))
+    return list_entry(list_pop_front(&pcb->free_stacks), struct user_stack, elem);
+  if (pcb->stack_cnt >= MAX_THREADS)
+    return NULL;
+  us = malloc_tagged(sizeof *us, MT_PROCESS);
+  if (us != NULL)
+    us->slot = pcb->stack_cnt++;
+  return us;
+}
+
+/* Returns US to PCB's free list.  PCB's threads_lock must be
+   held. */
+static void give_back_stack(struct process* pcb, struct user_stack* us) {
+  list_insert_ordered(&pcb->free_stacks, &us->elem, stack_less, NULL);
+}
+
+/* Returns the top of the user stack in slot US. */
+static uint8_t* stack_top(const struct user_stack* us) {
+  return (uint8_t*)PHYS_BASE - (size_t)us->slot * MAX_STACK_PAGES * PGSIZE;
+}
+
+/* Clears the TLS block at the top of running thread T's stack
+   slot, which must be mapped, and records the block's own address
+   and T's TID at its start, where pthread_self() and friends in
+   the user library read them through %gs. */
+static void init_tls(struct thread* t) {
+  uint32_t* tls = (uint32_t*)(stack_top(t->uthread->stack) - USER_TLS_SIZE);
+
+  memset(tls, 0, USER_TLS_SIZE);
+  tls[0] = (uint32_t)tls;
+  tls[1] = t->tid;
+  t->tls = tls;
+  gdt_set_tls(tls, USER_TLS_SIZE);
+}
+
+/* Enters the main thread T, whose stack setup_stack() placed in
+   slot 0, into its process's thread table. */
+static bool init_main_thread(struct thread* t) {
+  struct process* pcb = t->pcb;
+  struct user_thread* ut = malloc_tagged(sizeof *ut, MT_PROCESS);
+
+  if (ut == NULL)
+    return false;
+  ut->stack = take_stack(pcb);
+  if (ut->stack == NULL) {
+    free(ut);
+    return false;
+  }
+  ut->tid = t->tid;
+  ut->thread = t;
+  ut->exited = ut->joined = false;
+  sema_init(&ut->join_sema, 0);
+  list_push_back(&pcb->threads, &ut->elem);
+  t->uthread = ut;
+  init_tls(t);
+  return true;
+}
+
+/* Frees PCB's thread table. */
+static void free_threads(struct process* pcb) {
+  while (!list_empty(&pcb->threads)) {
+    struct user_thread* ut = list_entry(list_pop_front(&pcb->threads), struct user_thread, elem);
+    free(ut->stack);
+    free(ut);
+  }
+  while (!list_empty(&pcb->free_stacks))
+    free(list_entry(list_pop_front(&pcb->free_stacks), struct user_stack, elem));
+}
+
+/* Terminates every thread of PCB other than the running thread,
+   which must be its reaper, and waits until they are gone.
+   Threads running or sleeping in the kernel die the next time
+   they would return to user mode. */
+static void reap_threads(struct process* pcb) {
+  struct thread* cur = thread_current();
+
+  futex_wake_process(pcb);
+
+  lock_acquire(&pcb->threads_lock);
+  if (cur->uthread != NULL)
+    sema_up(&cur->uthread->join_sema);
+  while (pcb->thread_cnt > 1)
+    cond_wait(&pcb->thread_exited, &pcb->threads_lock);
+  lock_release(&pcb->threads_lock);
+}
+
+/* Kills the running thread if another thread is tearing down its
+   process.  Called on every return to user mode. */
+void process_check_exiting(void) {
+  struct thread* t = thread_current();
+
+  if (t->pcb != NULL && t->pcb->reaper != NULL && t->pcb->reaper != t) {
+    intr_enable();
+    pthread_exit();
+  }
+}
+
+/* Arguments passed from pthread_execute() to start_pthread(). */
+struct pthread_start {
+  stub_fun sfun;            /* User-level stub to enter. */
+  pthread_fun tfun;         /* Thread function, passed to SFUN. */
+  void* arg;                /* Argument, passed to SFUN. */
+  struct process* pcb;      /* Process the thread belongs to. */
+  struct user_thread* ut;   /* Thread table entry, with stack. */
+  struct semaphore started; /* Upped once the thread is set up. */
+  bool success;             /* Did setup succeed? */
+};
+
+/* Creates a new user thread in the current process, running
+   SFUN(TFUN, ARG) on its own user stack.  Returns the new
+   thread's TID, or TID_ERROR if it could not be created. */
+tid_t pthread_execute(stub_fun sfun, pthread_fun tfun, void* arg) {
+  struct process* pcb = thread_current()->pcb;
+  struct pthread_start ps;
+  struct user_thread* ut;
+  tid_t tid;
+
+  ut = malloc_tagged(sizeof *ut, MT_PROCESS);
+  if (ut == NULL)
+    return TID_ERROR;
+
+  lock_acquire(&pcb->threads_lock);
+  ut->stack = NULL;
+  if (pcb->reaper == NULL && pcb->thread_cnt < MAX_THREADS)
+    ut->stack = take_stack(pcb);
+  if (ut->stack == NULL) {
+    lock_release(&pcb->threads_lock);
+    free(ut);
+    return TID_ERROR;
+  }
+  pcb->thread_cnt++;
+  lock_release(&pcb->threads_lock);
+
+  ut->thread = NULL;
+  ut->exited = ut->joined = false;
+  sema_init(&ut->join_sema, 0);
+
+  ps.sfun = sfun;
+  ps.tfun = tfun;
+  ps.arg = arg;
+  ps.pcb = pcb;
+  ps.ut = ut;
+  ps.success = false;
+  sema_init(&ps.started, 0);
+  tid = thread_create(pcb->process_name, PRI_DEFAULT, start_pthread, &ps);
+  if (tid != TID_ERROR)
+    sema_down(&ps.started);
+
+  if (tid == TID_ERROR || !ps.success) {
+    lock_acquire(&pcb->threads_lock);
+    give_back_stack(pcb, ut->stack);
+    pcb->thread_cnt--;
+    cond_broadcast(&pcb->thread_exited, &pcb->threads_lock);
+    lock_release(&pcb->threads_lock);
+    free(ut);
+    return TID_ERROR;
+  }
+  return tid;
+}
+
+/* Maps the top page of user stack US if an earlier thread has
+   not already done so, and pushes the arguments for SFUN(TFUN,
+   ARG) followed by a null return address, storing the resulting
+   stack pointer into *ESP. */
+static bool setup_thread_stack(struct user_stack* us, pthread_fun tfun, void* arg, void** esp) {
+  uint8_t* top = stack_top(us);
+  uint32_t* sp;
+
+#ifdef VM
+  if (!page_in(top - PGSIZE) && !(page_add_zero(top - PGSIZE, true) && page_in(top - PGSIZE)))
+    return false;
+#else
+  if (pagedir_get_page(thread_current()->pcb->pagedir, top - PGSIZE) == NULL) {
+    uint8_t* kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+    if (kpage == NULL)
+      return false;
+    if (!install_page(top - PGSIZE, kpage, true)) {
+      palloc_free_page(kpage);
+      return false;
+    }
+  }
+#endif
+
+  /* Leave the stack 16-byte aligned at SFUN's first argument, as
+     it would be after a call instruction, below the TLS block. */
+  sp = (uint32_t*)(top - USER_TLS_SIZE - 20);
+  sp[0] = 0;
+  sp[1] = (uint32_t)tfun;
+  sp[2] = (uint32_t)arg;
+  *esp = sp;
+  return true;
+}
+
+/* A thread function that sets up a new user thread and starts it
+   running in user mode. */
+static void start_pthread(void* ps_) {
+  struct pthread_start* ps = ps_;
+  struct process* pcb = ps->pcb;
+  struct user_thread* ut = ps->ut;
+  struct thread* t = thread_current();
+  struct intr_frame if_;
+
+  t->pcb = pcb;
+  process_activate();
+
+  memset(&if_, 0, sizeof if_);
+  if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.gs = SEL_UTLS;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = (void (*)(void))ps->sfun;
+
+  /* Give the new thread a freshly initialized FPU, as in
+     start_process(). */
+  int local_var[27];
+  asm volatile("FSAVE (%0)" : : "g"(&local_var) : "memory");
+  asm volatile("FNINIT" : : : "memory");
+  asm volatile("FSAVE (%0)" : : "g"(&if_.fpu) : "memory");
+  asm volatile("FRSTOR (%0)" : : "g"(&local_var) : "memory");
+
+  lock_acquire(&pcb->threads_lock);
+  ps->success = pcb->reaper == NULL && setup_thread_stack(ut->stack, ps->tfun, ps->arg, &if_.esp);
+  if (ps->success) {
+    ut->tid = t->tid;
+    ut->thread = t;
+    list_push_back(&pcb->threads, &ut->elem);
+    t->uthread = ut;
+    init_tls(t);
+  } else
+    t->pcb = NULL;
+  lock_release(&pcb->threads_lock);
+
+  /* PS lives on the creator's stack: do not touch it after this. */
+  sema_up(&ps->started);
+  if (t->pcb == NULL) {
+    process_activate();
+    thread_exit();
+  }
+
+  asm volatile("movl %0, %%esp; jmp intr_exit" : : "g"(&if_) : "memory");
+  NOT_REACHED();
+}
+
+/* Waits for thread TID of the current process to exit and
+   returns TID.  Returns TID_ERROR without waiting if TID is not a
+   thread of this process, is the caller itself, or has already
+   been joined. */
+tid_t pthread_join(tid_t tid) {
+  struct thread* cur = thread_current();
+  struct process* pcb = cur->pcb;
+  struct user_thread* ut = NULL;
+  struct list_elem* e;
+
+  lock_acquire(&pcb->threads_lock);
+  for (e = list_begin(&pcb->threads); e != list_end(&pcb->threads); e = list_next(e)) {
+    struct user_thread* candidate = list_entry(e, struct user_thread, elem);
+    if (candidate->tid == tid) {
+      ut = candidate;
+      break;
+    }
+  }
+  if (ut == NULL || ut->thread == cur || ut->joined) {
+    lock_release(&pcb->threads_lock);
+    return TID_ERROR;
+  }
+  ut->joined = true;
+  lock_release(&pcb->threads_lock);
+
+  sema_down(&ut->join_sema);
+
+  lock_acquire(&pcb->threads_lock);
+  if (ut->exited) {
+    list_remove(&ut->elem);
+    free(ut);
+  }
+  lock_release(&pcb->threads_lock);
+  return tid;
+}
+
+/* Exits the running user thread.  Its stack slot goes back to
+   the process's free list, still mapped, for a later thread to
+   reuse.  The process itself keeps running. */
+void pthread_exit(void) {
+  struct thread* t = thread_current();
+  struct process* pcb = t->pcb;
+  struct user_thread* ut = t->uthread;
+
+  lock_acquire(&pcb->threads_lock);
+  if (ut != NULL) {
+    give_back_stack(pcb, ut->stack);
+    ut->stack = NULL;
+    ut->thread = NULL;
+    ut->exited = true;
+    sema_up(&ut->join_sema);
+  }
+  if (pcb->main_thread == t)
+    pcb->main_thread = NULL;
+  pcb->thread_cnt--;
+  cond_broadcast(&pcb->thread_exited, &pcb->threads_lock);
+
+  /* Once we release the lock, the reaper may free PCB. */
+  t->pcb = NULL;
+  t->uthread = NULL;
+  t->tls = NULL;
+  lock_release(&pcb->threads_lock);
+  process_activate();
+  thread_exit();
+}
+
+/* Exits the main thread of the current process.  Waits for all
+   other threads to exit and then ends the process with status 0,
+   unless some other thread terminates the process first. */
+void pthread_exit_main(void) {
+  struct thread* t = thread_current();
+  struct process* pcb = t->pcb;
+  bool reap;
+
+  lock_acquire(&pcb->threads_lock);
+  sema_up(&t->uthread->join_sema);
+  while (pcb->thread_cnt > 1 && pcb->reaper == NULL)
+    cond_wait(&pcb->thread_exited, &pcb->threads_lock);
+  reap = pcb->reaper == NULL;
+  if (reap)
+    pcb->reaper = t;
+  lock_release(&pcb->threads_lock);
+
+  if (!reap)
+    pthread_exit();
+  pcb->curr_as_child->exit_status = 0;
+  process_exit();
+  NOT_REACHED();
+}
@@ -3,18 +3,29 @@
 
 #include "threads/thread.h"
 #include "threads/synch.h"
+#include <rusage.h>
 #include <stdint.h>
+#ifdef VM
+#include <hash.h>
+#endif
 
 // At most 8MB can be allocated to the stack
 // These defines will be used in Project 2: Multithreading
 #define MAX_STACK_PAGES (1 << 11)
 #define MAX_THREADS 127
+
+/* Each thread's TLS block occupies the top USER_TLS_SIZE bytes of
+   its stack slot and is the base of its %gs segment.  Must agree
+   with PTHREAD_TLS_SIZE in lib/user/pthread.h. */
+#define USER_TLS_SIZE 512
 #define ERROR -1
 
 /* PIDs and TIDs are the same type. PID should be
    the TID of the main thread of the process */
 typedef tid_t pid_t;
 
+struct intr_frame;
+
 /* Thread functions (Project 2: Multithreading) */
 typedef void (*pthread_fun)(void*);
 typedef void (*stub_fun)(pthread_fun, void*);
@@ -31,11 +42,33 @@ typedef struct child {
   struct list_elem elem;
 } CHILD;
 
+/* A user stack slot.  Slot N occupies the MAX_STACK_PAGES pages
+   ending N * MAX_STACK_PAGES pages below PHYS_BASE; the main
+   thread uses slot 0.  Slots of exited threads stay mapped and
+   are reused by later threads. */
+struct user_stack {
+  int slot;              /* Slot number. */
+  struct list_elem elem; /* Element in process's free_stacks. */
+};
+
+/* A thread of a user process, as seen by pthread_join(). */
+struct user_thread {
+  tid_t tid;                  /* Thread identifier. */
+  struct thread* thread;      /* Kernel thread, or NULL once exited. */
+  struct user_stack* stack;   /* User stack slot. */
+  bool exited;                /* Has the thread exited? */
+  bool joined;                /* Has some thread joined on it? */
+  struct semaphore join_sema; /* Upped when the thread exits. */
+  struct list_elem elem;      /* Element in process's threads. */
+};
+
 /* The process control block for a given process. Since
    there can be multiple threads per process, we need a separate
    PCB from the TCB. All TCBs in a process will have a pointer
    to the PCB, and the PCB will have a pointer to the main thread
    of the process, which is `special`. */
+struct fd_table;
+
 struct process {
   /* Owned by process.c. */
   uint32_t* pagedir;          /* Page directory. */
@@ -45,9 +78,36 @@ struct process {
   struct child* curr_as_child;
   char* file_name;
   struct file* curr_executable;
-  int cur_fd;                        /* The fd number assigned to new file */
-  struct list file_descriptor_table; /* All the files opened in current process */
-  struct dir* cwd;                   /* current working directory of the process */
+  struct fd_table* fd_table; /* Open files indexed by fd, or null if none yet */
+  int fd_free;               /* No fd below this one is free */
+  struct lock fd_lock;       /* Serializes changes to fd_table */
+  struct dir* cwd;           /* current working directory of the process */
+
+  /* Charged by whichever module incurs each cost: thread.c,
+     exception.c, syscall.c, devices/block.c, and vm/frame.c or,
+     without VM, process.c. */
+  struct rusage rusage; /* Resources used so far. */
+
+#ifdef VM
+  /* Owned by vm/page.c. */
+  struct hash pages;          /* Supplemental page table. */
+  struct lock pages_lock;     /* Protects PAGES and MAPPINGS. */
+  long long fault_cnt;        /* Page faults taken, counted by exception.c. */
+  long long fault_around_cnt; /* Pages mapped around them. */
+
+  /* Owned by vm/mmap.c. */
+  struct list mappings; /* Memory-mapped files. */
+  int next_mapid;       /* Identifier for the next mapping. */
+#endif
+
+  /* Threads (Project 2: Multithreading). */
+  struct lock threads_lock;       /* Protects the members below. */
+  struct condition thread_exited; /* Signaled when a thread exits. */
+  struct list threads;            /* All struct user_threads not yet joined. */
+  int thread_cnt;                 /* Number of live threads. */
+  int stack_cnt;                  /* Number of stack slots handed out so far. */
+  struct list free_stacks;        /* Slots of exited threads, lowest first. */
+  struct thread* reaper;          /* Thread tearing the process down, if any. */
 };
 
 // NEW_c has to come first so that
@@ -56,19 +116,36 @@ typedef struct start_proc_arg {
   struct child* new_c;
   char* file_name;
   struct dir* cwd; /* current working directory of the process */
+  uint64_t exec_start; /* timer_cycles() when exec was called. */
 } SPA;
 
 void userprog_init(void);
 
 pid_t process_execute(const char* file_name);
+pid_t process_fork(const struct intr_frame*);
 int process_wait(pid_t);
 void process_exit(void);
 void process_activate(void);
+void process_print_stats(void);
+void process_get_rusage(struct rusage*);
+
+extern bool print_rusage;
 
 bool is_main_thread(struct thread*, struct process*);
 pid_t get_pid(struct process*);
 
-/* Iterater through file descriptor table to find fd. */
+tid_t pthread_execute(stub_fun, pthread_fun, void*);
+tid_t pthread_join(tid_t);
+void pthread_exit(void) NO_RETURN;
+void pthread_exit_main(void) NO_RETURN;
+void process_check_exiting(void);
+
+/* File descriptor table. */
 struct file_descriptor* find_file_des(int);
+void put_file_des(struct file_descriptor*);
+int add_file_des(struct file_descriptor*);
+struct file_descriptor* remove_file_des(int);
+struct file_descriptor* alloc_file_des(void);
+void free_file_des(struct file_descriptor*);
 
 #endif /* userprog/process.h */
@@ -2,9 +2,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include "threads/malloc.h"
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/memtag.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "devices/input.h"
 #include "userprog/process.h"
@@ -20,14 +22,21 @@
 #include "filesys/inode.h"
 #include "filesys/free-map.h"
 #include "filesys/cache.h"
+#include "filesys/page-cache.h"
+#include "userprog/futex.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 static void syscall_handler(struct intr_frame*);
 
-bool is_valid_addr(uint32_t);
-bool is_valid_str(const char*);
 void sys_practice(struct intr_frame*, int);
 void sys_halt(void);
 void sys_exec(struct intr_frame*, const char*);
+void sys_fork(struct intr_frame*);
 void sys_wait(struct intr_frame*, pid_t);
 void sys_exit(struct intr_frame*, int);
 
@@ -54,28 +63,114 @@ void sys_isdir(struct intr_frame*, int);
 /* File sytem syscall */
 void sys_inumber(struct intr_frame*, int);
 
-bool is_valid_addr(uint32_t addr) {
-  uint32_t* pd = thread_current()->pcb->pagedir;
-  for (int i = 0; i < 4; i++) {
-    if (!(is_user_vaddr((const char*)addr + i) && pagedir_get_page(pd, (const char*)addr + i))) {
+/* Memory-mapped files */
+void sys_mmap(struct intr_frame*, int, void*);
+void sys_munmap(struct intr_frame*, int);
+
+/* Threads */
+void sys_pt_create(struct intr_frame*, stub_fun, pthread_fun, void*);
+void sys_pt_exit(struct intr_frame*);
+void sys_pt_join(struct intr_frame*, tid_t);
+void sys_get_tid(struct intr_frame*);
+
+/* User synchronization */
+void sys_futex_wait(struct intr_frame*, int*, int);
+void sys_futex_wake(struct intr_frame*, int*, int);
+
+/* Kernel memory statistics */
+void sys_memstat(struct intr_frame*, int, struct memstat*);
+void sys_heapstat(struct intr_frame*, int, struct heapstat*);
+void sys_swapstat(struct intr_frame*, struct swapstat*);
+void sys_getrusage(struct intr_frame*, struct rusage*);
+
+/* Returns true if UADDR is a mapped user address.  With VM, a
+   page that has not been brought in yet is brought in first, and
+   a stack page not yet grown is grown as if the user had touched
+   it. */
+static bool is_mapped(const void* uaddr) {
+#ifdef VM
+  return page_in(uaddr) || page_grow_stack(uaddr, thread_current()->user_esp);
+#else
+  return is_user_vaddr(uaddr) && pagedir_get_page(thread_current()->pcb->pagedir, uaddr) != NULL;
+#endif
+}
+
+/* Returns true if the SIZE bytes starting at UADDR are mapped
+   user memory, checking each page once.  UADDR's own page must
+   be mapped even if SIZE is 0. */
+static bool is_valid_buffer(const void* uaddr, size_t size) {
+  const uint8_t* end = (const uint8_t*)uaddr + size;
+  const uint8_t* p = pg_round_down(uaddr);
+
+  if (!is_user_vaddr(uaddr) || size > (size_t)((const uint8_t*)PHYS_BASE - (const uint8_t*)uaddr))
+    return false;
+  do {
+    if (!is_mapped(p))
       return false;
-    }
-  }
+    p += PGSIZE;
+  } while (p < end);
   return true;
 }
 
-bool is_valid_str(const char* c) {
-  uint32_t* pd = thread_current()->pcb->pagedir;
-  while (is_user_vaddr(c) && pagedir_get_page(pd, c)) {
-    if (*c == '\0') {
-      return true;
-    }
-    c++;
+/* Copies the user string USTR into a new page, which the caller
+   must free with palloc_free_page().  Returns a null pointer if
+   the string does not fit in a page or memory is not available.
+   Kills the process if the string cannot be read. */
+static char* copy_in_string(struct intr_frame* f, const char* ustr) {
+  char* kstr = palloc_get_page(0);
+  int len;
+
+  if (kstr == NULL)
+    return NULL;
+  len = strncpy_from_user(kstr, ustr, PGSIZE);
+  if (len < 0) {
+    palloc_free_page(kstr);
+    sys_exit(f, -1);
   }
-  return false;
+  if (len == PGSIZE) {
+    palloc_free_page(kstr);
+    return NULL;
+  }
+  return kstr;
+}
+
+/* Most bytes that read() and write() pin at a time. */
+#define PIN_MAX (16 * PGSIZE)
+
+/* Returns the size of the next piece of the SIZE bytes at UADDR
+   for read() or write() to pin: no more than PIN_MAX bytes,
+   ending on a page boundary if it is not the last. */
+static size_t pin_chunk(const void* uaddr, size_t size) {
+  size_t chunk = PIN_MAX - pg_ofs(uaddr);
+  return size < chunk ? size : chunk;
+}
+
+/* Pins the SIZE bytes of user memory at UADDR, which
+   is_valid_buffer() has accepted, in memory while the kernel
+   copies to them if WRITE is true or from them otherwise, so
+   that the copy out of or into the page cache neither faults
+   nor loses a page to eviction halfway.  Returns false if the
+   bytes cannot be brought in or, if WRITE, are read-only.
+   Without VM, user pages never move, and this only checks. */
+static bool pin_user(const void* uaddr, size_t size, bool write) {
+#ifdef VM
+  return page_pin_range(uaddr, size, write);
+#else
+  return !write || is_valid_buffer(uaddr, size);
+#endif
+}
+
+/* Undoes pin_user(UADDR, SIZE). */
+static void unpin_user(const void* uaddr UNUSED, size_t size UNUSED) {
+#ifdef VM
+  page_unpin_range(uaddr, size);
+#endif
 }
 
-void syscall_init(void) { intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall"); }
+void syscall_init(void) {
+  intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
+  futex_init();
+}
 
 void sys_practice(struct intr_frame* f, int i) {
   f->eax = i + 1;
@@ -85,14 +180,18 @@ void sys_practice(struct intr_frame* f, int i) {
 void sys_halt() { shutdown_power_off(); }
 
 void sys_exec(struct intr_frame* f, const char* cmd_line) {
-  if (is_valid_str(cmd_line)) {
-    f->eax = process_execute(cmd_line);
-  } else {
-    sys_exit(f, -1);
+  char* kcmd_line = copy_in_string(f, cmd_line);
+  if (kcmd_line == NULL) {
+    f->eax = TID_ERROR;
+    return;
   }
+  f->eax = process_execute(kcmd_line);
+  palloc_free_page(kcmd_line);
   return;
 }
 
+void sys_fork(struct intr_frame* f) { f->eax = process_fork(f); }
+
 void sys_wait(struct intr_frame* f, pid_t pid) {
   f->eax = process_wait(pid);
   return;
@@ -101,52 +200,65 @@ void sys_wait(struct intr_frame* f, pid_t pid) {
 void sys_exit(struct intr_frame* f, int status) {
   f->eax = status;
   struct process* pcb = thread_current()->pcb;
-  pcb->curr_as_child->exit_status = status;
+  /* The first thread to exit decides the process's status. */
+  if (pcb->reaper == NULL)
+    pcb->curr_as_child->exit_status = status;
   process_exit();
 }
 
-void sys_create(struct intr_frame* f, const char* file, unsigned initial_size) {
-  if (!is_valid_str(file)) {
-    sys_exit(f, -1);
+void sys_create(struct intr_frame* f, const char* ufile, unsigned initial_size) {
+  char* file = copy_in_string(f, ufile);
+  if (file == NULL) {
+    f->eax = false;
+    return;
   }
-  /* Get current user program pcb */
   bool flag;
   flag = filesys_create(file, initial_size);
+  palloc_free_page(file);
   f->eax = flag;
   return;
 }
 
-void sys_remove(struct intr_frame* f, const char* file) {
-  if (!is_valid_str(file)) {
-    sys_exit(f, -1);
+void sys_remove(struct intr_frame* f, const char* ufile) {
+  char* file = copy_in_string(f, ufile);
+  if (file == NULL) {
+    f->eax = false;
+    return;
   }
   bool flag;
   flag = filesys_remove(file);
+  palloc_free_page(file);
   f->eax = flag;
   return;
 }
 
-void sys_open(struct intr_frame* f, const char* file) {
-  if (!is_valid_str(file)) {
-    sys_exit(f, -1);
+void sys_open(struct intr_frame* f, const char* ufile) {
+  char* file = copy_in_string(f, ufile);
+  if (file == NULL) {
+    f->eax = -1;
+    return;
   }
-  struct process* pcb = thread_current()->pcb;
   bool is_dir = false;
   struct file* new_file = filesys_open(file, &is_dir);
+  palloc_free_page(file);
   if (!new_file) {
     f->eax = -1;
     return;
   }
-  struct file_descriptor* new_file_descriptor =
-      (struct file_descriptor*)malloc(sizeof(struct file_descriptor));
+  struct file_descriptor* new_file_descriptor = alloc_file_des();
   if (!new_file_descriptor) {
     sys_exit(f, -1);
   }
-  new_file_descriptor->fd = pcb->cur_fd++;
   new_file_descriptor->file = new_file;
   new_file_descriptor->is_directory = is_dir;
   new_file_descriptor->dir = dir_open(file_get_inode(new_file));
-  list_push_back(&(pcb->file_descriptor_table), &(new_file_descriptor->elem));
+  if (add_file_des(new_file_descriptor) < 0) {
+    dir_close(new_file_descriptor->dir);
+    file_close(new_file);
+    free_file_des(new_file_descriptor);
+    f->eax = -1;
+    return;
+  }
   f->eax = new_file_descriptor->fd;
   return;
 }
@@ -161,6 +273,7 @@ void sys_filesize(struct intr_frame* f, int fd) {
     sys_exit(f, -1);
   }
   file_size = file_length(my_file_des->file);
+  put_file_des(my_file_des);
   f->eax = file_size;
   return;
 }
@@ -169,7 +282,7 @@ void sys_read(struct intr_frame* f, int fd, void* buffer, unsigned size) {
   if (!buffer) {
     sys_exit(f, -1);
   }
-  if (!is_valid_addr((uint32_t)buffer)) {
+  if (!is_valid_buffer(buffer, size)) {
     sys_exit(f, -1);
   }
   off_t number_read = 0;
@@ -183,31 +296,76 @@ void sys_read(struct intr_frame* f, int fd, void* buffer, unsigned size) {
   }
   struct file_descriptor* my_file_des = find_file_des(fd);
   if (!my_file_des || my_file_des->is_directory) {
+    if (my_file_des)
+      put_file_des(my_file_des);
     sys_exit(f, -1);
   }
-  number_read = file_read(my_file_des->file, buffer, size);
+  while (size > 0) {
+    size_t chunk = pin_chunk(buffer, size);
+    off_t n;
+    if (!pin_user(buffer, chunk, true)) {
+      if (number_read == 0) {
+        put_file_des(my_file_des);
+        sys_exit(f, -1);
+      }
+      break;
+    }
+    n = file_read(my_file_des->file, buffer, chunk);
+    unpin_user(buffer, chunk);
+    number_read += n;
+    if ((size_t)n < chunk)
+      break;
+    buffer = (uint8_t*)buffer + chunk;
+    size -= chunk;
+  }
+  put_file_des(my_file_des);
   f->eax = number_read;
   return;
 }
 
 void sys_write(struct intr_frame* f, int fd, const void* buffer, unsigned size) {
-  /* Argument validation (may need to test whether buffer is big enough) */
-  if (!is_valid_addr((uint32_t)buffer)) {
+  /* Argument validation */
+  if (!is_valid_buffer(buffer, size)) {
     sys_exit(f, -1);
   }
-  if (fd == 1) {
-    putbuf(buffer, size);
-  } else if (fd <= 0) {
+  if (fd <= 0) {
     sys_exit(f, -1);
-  } else {
-    struct file_descriptor* my_file_des = find_file_des(fd);
+  }
+  struct file_descriptor* my_file_des = NULL;
+  if (fd != 1) {
+    my_file_des = find_file_des(fd);
     if (!my_file_des || my_file_des->is_directory) {
+      if (my_file_des)
+        put_file_des(my_file_des);
       sys_exit(f, -1);
     }
-    int bytes_read;
-    bytes_read = file_write(my_file_des->file, buffer, size);
-    f->eax = bytes_read;
-    return;
+  }
+  int bytes_written = 0;
+  while (size > 0) {
+    size_t chunk = pin_chunk(buffer, size);
+    off_t n = chunk;
+    if (!pin_user(buffer, chunk, false)) {
+      if (bytes_written == 0) {
+        if (my_file_des != NULL)
+          put_file_des(my_file_des);
+        sys_exit(f, -1);
+      }
+      break;
+    }
+    if (my_file_des == NULL)
+      putbuf(buffer, chunk);
+    else
+      n = file_write(my_file_des->file, buffer, chunk);
+    unpin_user(buffer, chunk);
+    bytes_written += n;
+    if ((size_t)n < chunk)
+      break;
+    buffer = (const uint8_t*)buffer + chunk;
+    size -= chunk;
+  }
+  if (my_file_des != NULL) {
+    put_file_des(my_file_des);
+    f->eax = bytes_written;
   }
   return;
 }
@@ -221,6 +379,7 @@ void sys_seek(struct intr_frame* f, int fd, unsigned position) {
   struct file_descriptor* my_file_des = find_file_des(fd);
   if (my_file_des) {
     file_seek(my_file_des->file, position);
+    put_file_des(my_file_des);
     f->eax = 0;
     return;
   }
@@ -237,6 +396,7 @@ void sys_tell(struct intr_frame* f, int fd) {
   struct file_descriptor* my_file_des = find_file_des(fd);
   if (my_file_des) {
     f->eax = file_tell(my_file_des->file);
+    put_file_des(my_file_des);
     return;
   }
   f->eax = -1;
@@ -249,12 +409,12 @@ void sys_close(struct intr_frame* f, int fd) {
     f->eax = -1;
     return;
   }
-  struct file_descriptor* my_file_des = find_file_des(fd);
+  struct file_descriptor* my_file_des = remove_file_des(fd);
   if (my_file_des) {
-    file_close(my_file_des->file);
+    /* The file stays open until other threads' reads and writes
+       on it are done. */
+    put_file_des(my_file_des);
     f->eax = 0;
-    list_remove(&my_file_des->elem);
-    free(list_entry(&my_file_des->elem, struct file_descriptor, elem));
     return;
   }
   f->eax = -1;
@@ -271,8 +431,14 @@ void sys_comp_e(struct intr_frame* f, int num) {
   return;
 }
 
-void sys_chdir(struct intr_frame* f, const char* dir) {
+void sys_chdir(struct intr_frame* f, const char* udir) {
+  char* dir = copy_in_string(f, udir);
+  if (dir == NULL) {
+    f->eax = false;
+    return;
+  }
   struct dir* d = tracing(dir, false);
+  palloc_free_page(dir);
   if (d == NULL) {
     f->eax = false;
     return;
@@ -282,15 +448,22 @@ void sys_chdir(struct intr_frame* f, const char* dir) {
   f->eax = true;
 }
 
-void sys_mkdir(struct intr_frame* f, const char* dir) {
+void sys_mkdir(struct intr_frame* f, const char* udir) {
   block_sector_t inode_sector = 0;
+  char* dir = copy_in_string(f, udir);
+  if (dir == NULL) {
+    f->eax = false;
+    return;
+  }
   struct dir* d = tracing(dir, true);
   if (d == NULL) {
+    palloc_free_page(dir);
     f->eax = false;
     return;
   }
   char name[NAME_MAX + 1];
   bool check = get_last_name(dir, name);
+  palloc_free_page(dir);
   if (!check) {
     f->eax = false;
     return;
@@ -315,22 +488,29 @@ void sys_mkdir(struct intr_frame* f, const char* dir) {
   }
 }
 
-void sys_readdir(struct intr_frame* f, int fd, char* name) {
+void sys_readdir(struct intr_frame* f, int fd, char* uname) {
   if (fd < 0) {
     printf("fd: %d is invalid.", fd);
     f->eax = -1;
     return;
   }
   struct file_descriptor* my_file_des = find_file_des(fd);
-  if (!my_file_des->is_directory) {
+  if (my_file_des == NULL || !my_file_des->is_directory) {
+    if (my_file_des != NULL)
+      put_file_des(my_file_des);
     f->eax = false;
     return;
   }
   struct dir* dir = my_file_des->dir;
+  char name[NAME_MAX + 1];
   bool result = dir_readdir(dir, name);
   while (result && (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)) {
     result = dir_readdir(dir, name);
   }
+  put_file_des(my_file_des);
+  if (result && !copy_to_user(uname, name, strlen(name) + 1)) {
+    sys_exit(f, -1);
+  }
   f->eax = result;
 }
 
@@ -341,11 +521,13 @@ void sys_isdir(struct intr_frame* f, int fd) {
     return;
   }
   struct file_descriptor* my_file_des = find_file_des(fd);
-  if (!my_file_des->is_directory) {
+  if (my_file_des == NULL || !my_file_des->is_directory) {
     f->eax = false;
   } else {
     f->eax = true;
   }
+  if (my_file_des != NULL)
+    put_file_des(my_file_des);
 }
 
 void sys_inumber(struct intr_frame* f, int fd) {
@@ -355,12 +537,119 @@ void sys_inumber(struct intr_frame* f, int fd) {
     return;
   }
   struct file_descriptor* cur_file_des = find_file_des(fd);
+  if (cur_file_des == NULL) {
+    f->eax = -1;
+    return;
+  }
   f->eax = file_get_inumber(cur_file_des->file);
+  put_file_des(cur_file_des);
   return;
 }
 
+void sys_pt_create(struct intr_frame* f, stub_fun sfun, pthread_fun tfun, void* arg) {
+  f->eax = pthread_execute(sfun, tfun, arg);
+}
+
+void sys_pt_exit(struct intr_frame* f UNUSED) {
+  struct thread* t = thread_current();
+  if (is_main_thread(t, t->pcb)) {
+    pthread_exit_main();
+  }
+  pthread_exit();
+}
+
+void sys_pt_join(struct intr_frame* f, tid_t tid) { f->eax = pthread_join(tid); }
+
+void sys_get_tid(struct intr_frame* f) { f->eax = thread_current()->tid; }
+
+/* Futex words must be aligned and mapped.  Being aligned, a word
+   lies within one page.  The page may still be unmapped before
+   futex_wait() reads the word, which it does with
+   copy_from_user(), failing the call if so. */
+static bool is_valid_futex(int* uaddr) {
+  return ((uint32_t)uaddr & (sizeof(int) - 1)) == 0 && is_mapped(uaddr);
+}
+
+void sys_futex_wait(struct intr_frame* f, int* uaddr, int val) {
+  if (!is_valid_futex(uaddr)) {
+    sys_exit(f, -1);
+  }
+  f->eax = futex_wait(uaddr, val);
+}
+
+void sys_futex_wake(struct intr_frame* f, int* uaddr, int cnt) {
+  if (!is_valid_futex(uaddr)) {
+    sys_exit(f, -1);
+  }
+  f->eax = futex_wake(uaddr, cnt);
+}
+
+/* Without VM there is no paging to back a mapping, so mmap()
+   always fails and munmap() does nothing. */
+void sys_mmap(struct intr_frame* f, int fd UNUSED, void* addr UNUSED) {
+  f->eax = -1;
+#ifdef VM
+  struct file_descriptor* my_file_des = fd > 1 ? find_file_des(fd) : NULL;
+  if (my_file_des != NULL && !my_file_des->is_directory) {
+    f->eax = mmap_map(my_file_des->file, addr);
+  }
+  if (my_file_des != NULL)
+    put_file_des(my_file_des);
+#endif
+}
+
+void sys_munmap(struct intr_frame* f UNUSED, int mapid UNUSED) {
+#ifdef VM
+  mmap_unmap(mapid);
+#endif
+}
+
+void sys_memstat(struct intr_frame* f, int tag, struct memstat* ust) {
+  struct memstat st;
+
+  f->eax = memtag_get_stats(tag, &st);
+  if (f->eax && !copy_to_user(ust, &st, sizeof st)) {
+    sys_exit(f, -1);
+  }
+}
+
+void sys_heapstat(struct intr_frame* f, int idx, struct heapstat* ust) {
+  struct heapstat st;
+
+  f->eax = malloc_get_stats(idx, &st);
+  if (f->eax && !copy_to_user(ust, &st, sizeof st)) {
+    sys_exit(f, -1);
+  }
+}
+
+void sys_swapstat(struct intr_frame* f, struct swapstat* ust) {
+  struct swapstat st;
+
+#ifdef VM
+  f->eax = swap_get_stats(&st);
+#else
+  f->eax = false;
+#endif
+  if (f->eax && !copy_to_user(ust, &st, sizeof st)) {
+    sys_exit(f, -1);
+  }
+}
+
+void sys_getrusage(struct intr_frame* f, struct rusage* ust) {
+  struct rusage ru;
+
+  process_get_rusage(&ru);
+  if (!copy_to_user(ust, &ru, sizeof ru)) {
+    sys_exit(f, -1);
+  }
+}
+
 static void syscall_handler(struct intr_frame* f UNUSED) {
-  uint32_t* args = ((uint32_t*)f->esp);
+  uint32_t args[4]; /* System call number and arguments. */
+
+  /* Stack growth while in the system call goes by the user's
+     stack pointer, not the kernel's. */
+  thread_current()->user_esp = f->esp;
 
   /*
    * The following print statement, if uncommented, will print out the syscall
@@ -369,8 +658,8 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
    * include it in your final submission.
    */
 
-  /* Validate stack pointer */
-  if (!is_valid_addr((uint32_t)args)) {
+  /* Copy in the system call number, then its arguments. */
+  if (!copy_from_user(args, f->esp, sizeof *args)) {
     sys_exit(f, -1);
   }
 
@@ -383,11 +672,18 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
     case SYS_CREATE:
     case SYS_SEEK:
     case SYS_READDIR:
+    case SYS_FUTEX_WAIT:
+    case SYS_FUTEX_WAKE:
+    case SYS_MEMSTAT:
+    case SYS_HEAPSTAT:
+    case SYS_MMAP:
       num_args = 2;
       break;
+    case SYS_PT_CREATE:
+      num_args = 3;
+      break;
     case SYS_PRACTICE:
     case SYS_EXIT:
-    case SYS_HALT:
     case SYS_EXEC:
     case SYS_WAIT:
     case SYS_REMOVE:
@@ -395,19 +691,26 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
     case SYS_FILESIZE:
     case SYS_TELL:
     case SYS_CLOSE:
+    case SYS_COMPUTE_E:
     case SYS_CHDIR:
     case SYS_MKDIR:
     case SYS_ISDIR:
     case SYS_INUMBER:
+    case SYS_PT_JOIN:
+    case SYS_SWAPSTAT:
+    case SYS_GETRUSAGE:
+    case SYS_MUNMAP:
       num_args = 1;
       break;
     default:
       num_args = 0;
   }
 
-  if (!is_user_vaddr(args + num_args)) {
+  if (num_args > 0 && !copy_from_user(args + 1, (uint32_t*)f->esp + 1, num_args * sizeof *args)) {
     sys_exit(f, -1);
   }
+  if (args[0] < RUSAGE_SYSCALL_CNT)
+    thread_current()->pcb->rusage.syscalls[args[0]]++;
 
   switch (args[0]) {
     case SYS_PRACTICE:
@@ -420,7 +723,7 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
       sys_wait(f, args[1]);
       break;
     case SYS_EXEC:
-      if (((sizeof(pid_t) - 1) & (unsigned long)&args[1]) || !is_valid_addr((uint32_t)&args[1])) {
+      if ((sizeof(pid_t) - 1) & (unsigned long)f->esp) {
         sys_exit(f, -1);
       }
       sys_exec(f, (char*)args[1]);
@@ -428,22 +731,25 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
     case SYS_EXIT:
       sys_exit(f, args[1]);
       break;
+    case SYS_FORK:
+      sys_fork(f);
+      break;
 
     /* File operations */
     case SYS_CREATE:
-      if ((sizeof(char*) - 1) & (unsigned long)&args[1]) {
+      if ((sizeof(char*) - 1) & (unsigned long)f->esp) {
         sys_exit(f, -1);
       }
       sys_create(f, (const char*)args[1], args[2]);
       break;
     case SYS_REMOVE:
-      if ((sizeof(char*) - 1) & (unsigned long)&args[1]) {
+      if ((sizeof(char*) - 1) & (unsigned long)f->esp) {
         sys_exit(f, -1);
       }
       sys_remove(f, (const char*)args[1]);
       break;
     case SYS_OPEN:
-      if ((sizeof(char*) - 1) & (unsigned long)&args[1]) {
+      if ((sizeof(char*) - 1) & (unsigned long)f->esp) {
         sys_exit(f, -1);
       }
       sys_open(f, (const char*)args[1]);
@@ -452,13 +758,13 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
       sys_filesize(f, args[1]);
       break;
     case SYS_READ:
-      if ((sizeof(void*) - 1) & (unsigned long)&args[2]) {
+      if ((sizeof(void*) - 1) & (unsigned long)f->esp) {
         sys_exit(f, -1);
       }
       sys_read(f, args[1], (void*)args[2], args[3]);
       break;
     case SYS_WRITE:
-      if ((sizeof(void*) - 1) & (unsigned long)&args[2]) {
+      if ((sizeof(void*) - 1) & (unsigned long)f->esp) {
         sys_exit(f, -1);
       }
       sys_write(f, args[1], (const void*)args[2], args[3]);
@@ -496,15 +802,46 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
       sys_inumber(f, args[1]);
       break;
 
+    /* Memory-mapped files */
+    case SYS_MMAP:
+      sys_mmap(f, args[1], (void*)args[2]);
+      break;
+    case SYS_MUNMAP:
+      sys_munmap(f, args[1]);
+      break;
+
+    /* Threads */
+    case SYS_PT_CREATE:
+      sys_pt_create(f, (stub_fun)args[1], (pthread_fun)args[2], (void*)args[3]);
+      break;
+    case SYS_PT_EXIT:
+      sys_pt_exit(f);
+      break;
+    case SYS_PT_JOIN:
+      sys_pt_join(f, args[1]);
+      break;
+    case SYS_GET_TID:
+      sys_get_tid(f);
+      break;
+
+    /* User synchronization */
+    case SYS_FUTEX_WAIT:
+      sys_futex_wait(f, (int*)args[1], args[2]);
+      break;
+    case SYS_FUTEX_WAKE:
+      sys_futex_wake(f, (int*)args[1], args[2]);
+      break;
+
     case SYS_CACHE_HIT:
-      f->eax = get_cache_hit_cnt();
+      f->eax = get_cache_hit_cnt() + page_cache_hit_cnt();
       break;
 
     case SYS_CACHE_MISS:
-      f->eax = get_cache_miss_cnt();
+      f->eax = get_cache_miss_cnt() + page_cache_miss_cnt();
       break;
 
     case SYS_CACHE_RESET:
+      page_cache_reset();
       cache_reset();
       break;
 
@@ -516,6 +853,20 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
       f->eax = fs_device_write();
       break;
 
+    /* Kernel memory statistics */
+    case SYS_MEMSTAT:
+      sys_memstat(f, args[1], (struct memstat*)args[2]);
+      break;
+    case SYS_HEAPSTAT:
+      sys_heapstat(f, args[1], (struct heapstat*)args[2]);
+      break;
+    case SYS_SWAPSTAT:
+      sys_swapstat(f, (struct swapstat*)args[1]);
+      break;
+    case SYS_GETRUSAGE:
+      sys_getrusage(f, (struct rusage*)args[1]);
+      break;
+
     default:
       f->eax = -1; /* If the NUMBER is not defined */
   }
@@ -0,0 +1,82 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* Copying to and from user memory.
+
+   System calls hand the kernel pointers into user memory that
+   may point anywhere.  Instead of walking the page tables to
+   check every page, or every byte, before touching them, these
+   functions check only that the memory lies below PHYS_BASE and
+   then copy it in bulk with the routines in copy-user.S.  If the
+   memory is not there after all, the copy faults.  With VM,
+   page_fault() first tries to bring the page in, as it would
+   for the process itself, and the copy carries on; otherwise
+   page_fault() finds the faulting instruction in the fixup table
+   and resumes at its fixup, which makes the copy report failure.
+
+   None of these may be called with interrupts off or with a lock
+   held that bringing in a page needs. */
+
+/* A fixup table entry, from copy-user.S. */
+struct fixup {
+  uintptr_t insn;  /* Instruction that may fault on user memory. */
+  uintptr_t fixup; /* Where to resume if it does. */
+};
+
+extern const struct fixup uaccess_fixups[], uaccess_fixups_end[];
+
+size_t uaccess_copy(void* dst, const void* src, size_t size);
+int uaccess_strncpy(char* dst, const char* src, size_t size);
+
+/* Returns true if the SIZE bytes starting at user address UADDR
+   all lie below PHYS_BASE. */
+static bool is_user_range(const void* uaddr, size_t size) {
+  return is_user_vaddr(uaddr) && size <= (size_t)((uint8_t*)PHYS_BASE - (uint8_t*)uaddr);
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns
+   false if any of them cannot be read, in which case DST may
+   have been partly written. */
+bool copy_from_user(void* dst, const void* usrc, size_t size) {
+  return is_user_range(usrc, size) && uaccess_copy(dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns
+   false if any of them cannot be written, in which case UDST
+   may have been partly written. */
+bool copy_to_user(void* udst, const void* src, size_t size) {
+  return is_user_range(udst, size) && uaccess_copy(udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC to DST,
+   which has room for SIZE bytes.  Returns the string's length,
+   or SIZE if it does not fit, null terminator included, in SIZE
+   bytes, in which case DST is not null-terminated.  Returns -1
+   if the string cannot be read. */
+int strncpy_from_user(char* dst, const char* usrc, size_t size) {
+  size_t max;
+  int len;
+
+  if (!is_user_vaddr(usrc))
+    return -1;
+  max = (uint8_t*)PHYS_BASE - (uint8_t*)usrc;
+  if (size <= max)
+    return uaccess_strncpy(dst, usrc, size);
+
+  /* The string must end before PHYS_BASE. */
+  len = uaccess_strncpy(dst, usrc, max);
+  return len == (int)max ? -1 : len;
+}
+
+/* Returns the address at which to resume after a page fault at
+   EIP on user memory that is not there, or a null pointer if EIP
+   is not an instruction that copies user memory. */
+void* uaccess_fixup(void* eip) {
+  const struct fixup* f;
+
+  for (f = uaccess_fixups; f < uaccess_fixups_end; f++)
+    if (f->insn == (uintptr_t)eip)
+      return (void*)f->fixup;
+  return NULL;
+}
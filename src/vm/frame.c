@@ -0,0 +1,429 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/page-cache.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+/* The frame table.
+
+   Every frame of the user pool that holds a process's page has
+   a struct frame in a single global list.  When the user pool
+   runs dry, frame_alloc() takes a frame away from whatever page
+   holds it, choosing the victim with the clock algorithm: a
+   "hand" sweeps around the list, giving each page whose accessed
+   bit is set a second chance by clearing the bit, and evicting
+   the first page whose bit is already clear.  page_out() then
+   saves the victim's contents if needed and unmaps it.
+
+   Eviction works in clusters: having found one victim, the hand
+   keeps going a little way to collect up to EVICT_CLUSTER of
+   them, so that page_out() can write the dirty ones to swap in a
+   single request.  The first frame goes to the caller and the
+   rest back to the user pool, where the next few faults find
+   them without evicting anything.
+
+   A frame is pinned while its page is being read in, so that it
+   cannot be evicted before it is mapped, and while a system call
+   copies to or from it (see page_pin_range()).  Pins nest.  The
+   pages of a pinned frame stay where they are: fork() does not
+   share a pinned frame, and a system call unshares a writable
+   page before pinning it.
+
+   A page of a memory-mapped file or of an executable's code is
+   not copied into a frame of the user pool but mapped straight
+   from the page cache, and its frame only records the mapping;
+   several processes may map the same page.  Evicting such a page
+   frees no user memory, so evict() passes it over.  Instead, when
+   the pages that processes hold have crowded the page cache
+   well past its size, mapping one more first unmaps a cluster of
+   them, again chosen by the clock, and hands their pages back to
+   the cache along with their dirty bits.
+
+   After fork(), parent and child share each of the parent's
+   frames copy-on-write: the frame's pages, one per process, form
+   a ring through their COW_NEXT members, and each maps the frame
+   read-only.  The first write to the page faults, and
+   frame_unshare() gives the writer a copy of its own.  A shared
+   frame is evicted only when none of its pages was accessed, and
+   all of them are unmapped together; each page that needs it
+   gets a swap slot of its own, since swap_in() frees the slot it
+   reads.
+
+   FRAME_LOCK protects the table, the clock hand, the link
+   between each frame and its pages, and the rings of shared
+   pages, and is held for the whole of an eviction.  A process
+   that faults on a page that is being evicted therefore waits in
+   frame_alloc() until the page's contents are safely in
+   swap. */
+
+static struct list frames;         /* All frames holding pages. */
+static struct list_elem* hand;     /* Next frame for the clock to examine. */
+static struct lock frame_lock;     /* Protects the members above. */
+static struct kmem_cache frame_cache;
+
+/* Most pages evicted at once. */
+#define EVICT_CLUSTER SWAP_BATCH_MAX
+
+/* Statistics, protected by FRAME_LOCK. */
+static size_t frame_cnt;      /* Frames in FRAMES. */
+static size_t peak_frame_cnt; /* Maximum of FRAME_CNT. */
+static long long evictions;   /* Pages evicted. */
+
+/* Initializes the frame table. */
+void frame_init(void) {
+  list_init(&frames);
+  hand = list_end(&frames);
+  lock_init(&frame_lock);
+  kmem_cache_create(&frame_cache, "frame", MT_VM, sizeof(struct frame), NULL);
+}
+
+/* Returns the frame under the clock hand and advances the hand,
+   wrapping around at the end of the table.  FRAME_LOCK must be
+   held and the table must not be empty. */
+static struct frame* advance_hand(void) {
+  struct frame* f;
+
+  if (hand == list_end(&frames))
+    hand = list_begin(&frames);
+  f = list_entry(hand, struct frame, elem);
+  hand = list_next(hand);
+  return f;
+}
+
+/* Removes frame F from the table.  FRAME_LOCK must be held. */
+static void remove_frame(struct frame* f) {
+  if (hand == &f->elem)
+    hand = list_next(hand);
+  list_remove(&f->elem);
+  frame_cnt--;
+}
+
+/* Frees frame F, which must no longer be in the table.  The
+   memory of a frame of the user pool goes back to the pool; a
+   page cache page goes back to the cache, dirty if the page that
+   had it mapped was written. */
+static void free_frame(struct frame* f) {
+  if (f->cpage != NULL)
+    page_cache_put(f->cpage, pagedir_is_dirty(f->page->pagedir, f->page->upage));
+  else
+    palloc_free_page(f->kpage);
+  kmem_cache_free(&frame_cache, f);
+}
+
+/* Returns the number of pages that share frame F.  FRAME_LOCK
+   must be held. */
+static size_t share_cnt(const struct frame* f) {
+  const struct page* p;
+  size_t cnt = 1;
+
+  for (p = f->page->cow_next; p != f->page; p = p->cow_next)
+    cnt++;
+  return cnt;
+}
+
+/* Returns true if any page that shares frame F has been accessed
+   since the last call, and clears their accessed bits.
+   FRAME_LOCK must be held. */
+static bool test_and_clear_accessed(struct frame* f) {
+  struct page* p = f->page;
+  bool accessed = false;
+
+  do {
+    if (pagedir_is_accessed(p->pagedir, p->upage)) {
+      pagedir_set_accessed(p->pagedir, p->upage, false);
+      accessed = true;
+    }
+    p = p->cow_next;
+  } while (p != f->page);
+  return accessed;
+}
+
+/* Chooses frames to evict with the clock algorithm, among frames
+   mapped from the page cache if CACHED is true and among frames
+   of the user pool otherwise, until they hold EVICT_CLUSTER
+   pages between them.  Stores them in VICTIMS and returns their
+   number.  FRAME_LOCK must be held. */
+static size_t choose_victims(struct frame* victims[EVICT_CLUSTER], bool cached) {
+  size_t victim_cnt = 0;
+  size_t page_cnt = 0;
+  size_t scan_cnt = 2 * frame_cnt;
+  size_t i;
+
+  /* Two sweeps are enough to find a first victim: the first
+     clears every accessed bit that it does not stop at.  After
+     that, look only a little further for the rest. */
+  for (i = 0; i < scan_cnt && page_cnt < EVICT_CLUSTER; i++) {
+    struct frame* f = advance_hand();
+    size_t cnt;
+
+    if (f->pin_cnt > 0 || (f->cpage != NULL) != cached)
+      continue;
+    if (test_and_clear_accessed(f))
+      continue;
+    cnt = share_cnt(f);
+    if (page_cnt + cnt > EVICT_CLUSTER)
+      continue;
+    victims[victim_cnt++] = f;
+    page_cnt += cnt;
+    if (victim_cnt == 1 && scan_cnt > i + 2 * EVICT_CLUSTER)
+      scan_cnt = i + 2 * EVICT_CLUSTER;
+  }
+  return victim_cnt;
+}
+
+/* Chooses a cluster of frames with the clock algorithm and
+   evicts their pages.  Returns one of the frames and frees the
+   others, or returns a null pointer if every frame is pinned or
+   no victim could be saved.  FRAME_LOCK must be held. */
+static struct frame* evict(void) {
+  struct frame* victims[EVICT_CLUSTER];
+  size_t victim_cnt;
+  size_t i;
+
+  victim_cnt = page_out(victims, choose_victims(victims, false));
+  if (victim_cnt == 0)
+    return NULL;
+  evictions += victim_cnt;
+  for (i = 1; i < victim_cnt; i++) {
+    remove_frame(victims[i]);
+    free_frame(victims[i]);
+  }
+  return victims[0];
+}
+
+/* Chooses a cluster of frames mapped from the page cache with
+   the clock algorithm, unmaps their pages, and hands them back
+   to the cache.  FRAME_LOCK must be held. */
+static void release_cached(void) {
+  struct frame* victims[EVICT_CLUSTER];
+  size_t victim_cnt;
+  size_t i;
+
+  victim_cnt = page_out(victims, choose_victims(victims, true));
+  evictions += victim_cnt;
+  for (i = 0; i < victim_cnt; i++) {
+    remove_frame(victims[i]);
+    free_frame(victims[i]);
+  }
+}
+
+/* Obtains a frame for page P, evicting other pages if no free
+   frame is left and MAY_EVICT is true, and zeroes it if ZERO is
+   true.  The frame is returned pinned, with P as its page.
+   Returns a null pointer if no frame can be had. */
+static struct frame* alloc_frame(struct page* p, bool zero, bool may_evict) {
+  void* kpage = palloc_get_page(PAL_USER | (zero ? PAL_ZERO : 0));
+  struct frame* f;
+
+  if (kpage != NULL) {
+    f = kmem_cache_alloc(&frame_cache);
+    if (f == NULL) {
+      palloc_free_page(kpage);
+      return NULL;
+    }
+    f->kpage = kpage;
+    f->cpage = NULL;
+
+    lock_acquire(&frame_lock);
+    list_insert(hand, &f->elem);
+    if (++frame_cnt > peak_frame_cnt)
+      peak_frame_cnt = frame_cnt;
+  } else {
+    lock_acquire(&frame_lock);
+    f = may_evict ? evict() : NULL;
+    if (f == NULL) {
+      lock_release(&frame_lock);
+      return NULL;
+    }
+  }
+  f->page = p;
+  f->pin_cnt = 1;
+  page_set_frame(p, f);
+  lock_release(&frame_lock);
+
+  if (zero && kpage == NULL)
+    memset(f->kpage, 0, PGSIZE);
+  return f;
+}
+
+/* Obtains a frame for page P, evicting other pages if no free
+   frame is left, and zeroes it if ZERO is true.  The frame is
+   returned pinned, with P as its page; the caller must unpin it
+   with frame_unpin() once P is mapped.  Returns a null pointer
+   if no frame can be had. */
+struct frame* frame_alloc(struct page* p, bool zero) { return alloc_frame(p, zero, true); }
+
+/* Like frame_alloc(), but fails instead of evicting anything if
+   no free frame is left, for frames that are merely nice to
+   have. */
+struct frame* frame_try_alloc(struct page* p, bool zero) { return alloc_frame(p, zero, false); }
+
+/* Obtains a frame for page P that maps page cache page CP in
+   place.  The frame is returned pinned, like one from
+   frame_alloc(), and on release hands CP back to the cache,
+   taking over the caller's reference to it.  Returns a null
+   pointer if memory is not available. */
+struct frame* frame_map_cached(struct page* p, struct cache_page* cp) {
+  struct frame* f = kmem_cache_alloc(&frame_cache);
+
+  if (f == NULL)
+    return NULL;
+  f->kpage = cp->kpage;
+  f->cpage = cp;
+
+  lock_acquire(&frame_lock);
+  if (page_cache_crowded())
+    release_cached();
+  list_insert(hand, &f->elem);
+  if (++frame_cnt > peak_frame_cnt)
+    peak_frame_cnt = frame_cnt;
+  f->page = p;
+  f->pin_cnt = 1;
+  page_set_frame(p, f);
+  lock_release(&frame_lock);
+  return f;
+}
+
+/* Pins the frame holding page P, if P has one, and returns it,
+   or returns a null pointer if P is not in memory.  Each pin
+   must be undone with frame_unpin(). */
+struct frame* frame_pin(struct page* p) {
+  struct frame* f;
+
+  lock_acquire(&frame_lock);
+  f = p->frame;
+  if (f != NULL)
+    f->pin_cnt++;
+  lock_release(&frame_lock);
+  return f;
+}
+
+/* Makes frame F eligible for eviction again. */
+void frame_unpin(struct frame* f) {
+  lock_acquire(&frame_lock);
+  ASSERT(f->pin_cnt > 0);
+  f->pin_cnt--;
+  lock_release(&frame_lock);
+}
+
+/* Removes page P from the ring of pages sharing frame F, which
+   must be shared.  FRAME_LOCK must be held. */
+static void unlink_page(struct frame* f, struct page* p) {
+  struct page* prev = p;
+
+  ASSERT(p->cow_next != p);
+  while (prev->cow_next != p)
+    prev = prev->cow_next;
+  prev->cow_next = p->cow_next;
+  p->cow_next = p;
+  if (f->page == p)
+    f->page = prev;
+}
+
+/* Shares the frame holding page P, if P is in memory and not
+   mapped from the page cache, with page C of another process,
+   which must not be in memory.  Both end up mapped read-only, to
+   be copied on the first write; C is dirty if P is.  Returns
+   false if P's frame is pinned, so that P must not move to
+   another frame, or if memory is not available to map C.  If P
+   has no frame to share, returns true and leaves C without a
+   frame. */
+bool frame_share(struct page* p, struct page* c) {
+  struct frame* f;
+  bool success = true;
+
+  ASSERT(c->frame == NULL && c->cow_next == c);
+
+  lock_acquire(&frame_lock);
+  f = p->frame;
+  if (f != NULL && f->cpage == NULL) {
+    if (f->pin_cnt == 0 && pagedir_set_page(c->pagedir, c->upage, f->kpage, false)) {
+      if (pagedir_is_dirty(p->pagedir, p->upage))
+        pagedir_set_dirty(c->pagedir, c->upage, true);
+      pagedir_set_writable(p->pagedir, p->upage, false);
+      page_set_frame(c, f);
+      c->cow_next = p->cow_next;
+      p->cow_next = c;
+    } else
+      success = false;
+  }
+  lock_release(&frame_lock);
+  return success;
+}
+
+/* Gives page P, which is writable and has been written through a
+   read-only mapping, a frame that it can write.  If no other page
+   still shares P's frame, P simply gets it to itself; otherwise P
+   gets a copy.  Returns false if memory is not available for the
+   copy.  Returns true without doing anything if P has been
+   evicted meanwhile, to be read back in by the next fault.  The
+   pages_lock of P's process must be held. */
+bool frame_unshare(struct page* p) {
+  struct frame *old, *f;
+
+  lock_acquire(&frame_lock);
+  old = p->frame;
+  if (old == NULL || p->cow_next == p) {
+    if (old != NULL)
+      pagedir_set_writable(p->pagedir, p->upage, true);
+    lock_release(&frame_lock);
+    return true;
+  }
+  old->pin_cnt++;
+  lock_release(&frame_lock);
+
+  /* Pinned, OLD stays put, and P with it in the ring, while the
+     copy is made. */
+  f = alloc_frame(p, false, true);
+  if (f == NULL) {
+    frame_unpin(old);
+    return false;
+  }
+  memcpy(f->kpage, old->kpage, PGSIZE);
+
+  lock_acquire(&frame_lock);
+  unlink_page(old, p);
+  old->pin_cnt--;
+  pagedir_clear_page(p->pagedir, p->upage);
+  pagedir_set_page(p->pagedir, p->upage, f->kpage, true);
+  pagedir_set_dirty(p->pagedir, p->upage, true);
+  f->pin_cnt--;
+  lock_release(&frame_lock);
+  return true;
+}
+
+/* Unmaps page P and frees its frame, if it has one, handing a
+   page cache page back to the cache.  A frame that P shares with
+   other pages stays with them. */
+void frame_free(struct page* p) {
+  struct frame* f;
+
+  lock_acquire(&frame_lock);
+  f = p->frame;
+  if (f != NULL) {
+    pagedir_clear_page(p->pagedir, p->upage);
+    page_set_frame(p, NULL);
+    if (p->cow_next != p) {
+      unlink_page(f, p);
+      f = NULL;
+    } else
+      remove_frame(f);
+  }
+  lock_release(&frame_lock);
+
+  if (f != NULL)
+    free_frame(f);
+}
+
+/* Prints frame table statistics. */
+void frame_print_stats(void) {
+  printf("Frames: %zu in use, peak %zu, %lld evictions\n", frame_cnt, peak_frame_cnt,
+         evictions);
+}
@@ -0,0 +1,31 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <list.h>
+#include <stdbool.h>
+
+struct cache_page;
+struct page;
+
+/* A frame of user memory holding a page of some process, or a
+   page of the page cache that a process has mapped. */
+struct frame {
+  void* kpage;              /* Kernel virtual address of the frame. */
+  struct page* page;        /* Page held in the frame. */
+  struct cache_page* cpage; /* Page cache page mapped, or null. */
+  int pin_cnt;              /* Pins; exempt from eviction if nonzero. */
+  struct list_elem elem;    /* Element in the frame table. */
+};
+
+void frame_init(void);
+struct frame* frame_alloc(struct page*, bool zero);
+struct frame* frame_try_alloc(struct page*, bool zero);
+struct frame* frame_map_cached(struct page*, struct cache_page*);
+struct frame* frame_pin(struct page*);
+void frame_unpin(struct frame*);
+bool frame_share(struct page*, struct page* c);
+bool frame_unshare(struct page*);
+void frame_free(struct page*);
+void frame_print_stats(void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,184 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   mmap_map() records each page of the file in the supplemental
+   page table as a page of the file, like a page of an executable,
+   except that on first access the page cache's copy of the page
+   is mapped in place instead of being copied.  The process's
+   writes therefore go straight into the file's cached data, are
+   seen by read() at once, and reach the disk when the page cache
+   writes the page back.  Nothing is read at mmap time.  Since
+   every mapping is writable, a file whose writes are denied, such
+   as a running executable whose code pages are shared from the
+   page cache, cannot be mapped.
+
+   Each mapping holds its own reopened struct file, so that it
+   outlives a close() of the descriptor it was made from.  A
+   process's list of mappings is protected by its pages_lock. */
+
+/* Lowest address of the region reserved for user stack slots,
+   which mappings may not intrude on even where no stack has
+   grown yet. */
+#define STACKS_BOTTOM ((uint8_t*)PHYS_BASE - (size_t)MAX_THREADS * MAX_STACK_PAGES * PGSIZE)
+
+/* Initializes PCB's list of mappings. */
+void mmap_init(struct process* pcb) {
+  list_init(&pcb->mappings);
+  pcb->next_mapid = 0;
+}
+
+/* Frees PCB's mappings.  Their pages must already have been
+   removed by page_table_destroy(). */
+void mmap_destroy(struct process* pcb) {
+  while (!list_empty(&pcb->mappings)) {
+    struct mapping* m = list_entry(list_pop_front(&pcb->mappings), struct mapping, elem);
+    file_close(m->file);
+    free(m);
+  }
+}
+
+/* Removes the first CNT pages of mapping M from the current
+   process's address space. */
+static void remove_pages(struct mapping* m, size_t cnt) {
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    page_remove(m->addr + i * PGSIZE);
+}
+
+/* Adds the pages of mapping M to the current process's address
+   space.  Returns false, adding none, if any of them is already
+   part of the address space or memory is not available. */
+static bool add_pages(struct mapping* m) {
+  off_t length = file_length(m->file);
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++) {
+    off_t ofs = i * PGSIZE;
+    uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+    if (!page_add_mmap(m->addr + ofs, m->file, ofs, read_bytes)) {
+      remove_pages(m, i);
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Maps FILE into the current process's address space starting
+   at ADDR.  Returns the new mapping's identifier, or MAP_FAILED
+   if FILE is empty or its writes are denied, ADDR is null or not
+   page-aligned, or any of the pages would overlap existing pages,
+   including the code, data, and stack regions. */
+mapid_t mmap_map(struct file* file, void* addr) {
+  struct process* pcb = thread_current()->pcb;
+  struct mapping* m;
+  off_t length;
+
+  if (addr == NULL || pg_ofs(addr) != 0)
+    return MAP_FAILED;
+  length = file_length(file);
+  if (length <= 0 || (size_t)length > (size_t)(STACKS_BOTTOM - (uint8_t*)addr) ||
+      (uint8_t*)addr >= STACKS_BOTTOM)
+    return MAP_FAILED;
+  if (inode_write_denied(file_get_inode(file)))
+    return MAP_FAILED;
+
+  m = malloc_tagged(sizeof *m, MT_VM);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->file = file_reopen(file);
+  if (m->file == NULL) {
+    free(m);
+    return MAP_FAILED;
+  }
+  m->addr = addr;
+  m->page_cnt = DIV_ROUND_UP(length, PGSIZE);
+
+  /* Adding a page fails if it is already part of the address
+     space, which catches every kind of overlap at once. */
+  if (!add_pages(m)) {
+    file_close(m->file);
+    free(m);
+    return MAP_FAILED;
+  }
+
+  lock_acquire(&pcb->pages_lock);
+  m->id = pcb->next_mapid++;
+  list_push_back(&pcb->mappings, &m->elem);
+  lock_release(&pcb->pages_lock);
+  return m->id;
+}
+
+/* Unmaps the current process's mapping MAPID.  Its dirty pages
+   stay in the page cache until written back.  Does nothing if
+   there is no such mapping. */
+void mmap_unmap(mapid_t mapid) {
+  struct process* pcb = thread_current()->pcb;
+  struct mapping* m = NULL;
+  struct list_elem* e;
+
+  lock_acquire(&pcb->pages_lock);
+  for (e = list_begin(&pcb->mappings); e != list_end(&pcb->mappings); e = list_next(e))
+    if (list_entry(e, struct mapping, elem)->id == mapid) {
+      m = list_entry(e, struct mapping, elem);
+      list_remove(e);
+      break;
+    }
+  lock_release(&pcb->pages_lock);
+  if (m == NULL)
+    return;
+
+  remove_pages(m, m->page_cnt);
+  file_close(m->file);
+  free(m);
+}
+
+/* Gives the current process, a child just forked from PARENT, a
+   mapping of the same file at the same address, with the same
+   identifier, for each of PARENT's mappings.  The pages are
+   mapped from the page cache, so both processes see each other's
+   writes, as they would with any shared mapping.  Returns false
+   if memory is not available; the mappings made so far stay in
+   place, for page_table_destroy() and mmap_destroy() to free. */
+bool mmap_fork(struct process* parent) {
+  struct process* pcb = thread_current()->pcb;
+  struct list_elem* e;
+  bool success = true;
+
+  lock_acquire(&parent->pages_lock);
+  for (e = list_begin(&parent->mappings); e != list_end(&parent->mappings); e = list_next(e)) {
+    struct mapping* pm = list_entry(e, struct mapping, elem);
+    struct mapping* m = malloc_tagged(sizeof *m, MT_VM);
+
+    if (m == NULL || (m->file = file_reopen(pm->file)) == NULL) {
+      free(m);
+      success = false;
+      break;
+    }
+    m->id = pm->id;
+    m->addr = pm->addr;
+    m->page_cnt = pm->page_cnt;
+    success = add_pages(m);
+    if (!success) {
+      file_close(m->file);
+      free(m);
+      break;
+    }
+    lock_acquire(&pcb->pages_lock);
+    list_push_back(&pcb->mappings, &m->elem);
+    lock_release(&pcb->pages_lock);
+  }
+  pcb->next_mapid = parent->next_mapid;
+  lock_release(&parent->pages_lock);
+  return success;
+}
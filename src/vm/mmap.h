@@ -0,0 +1,31 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct file;
+struct process;
+
+/* Memory mapping identifier. */
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t)-1)
+
+/* A file mapped into a process's address space. */
+struct mapping {
+  mapid_t id;            /* Mapping identifier. */
+  struct file* file;     /* The file, reopened for the mapping. */
+  uint8_t* addr;         /* First mapped page. */
+  size_t page_cnt;       /* Number of mapped pages. */
+  struct list_elem elem; /* Element in process's mappings. */
+};
+
+void mmap_init(struct process*);
+void mmap_destroy(struct process*);
+mapid_t mmap_map(struct file*, void* addr);
+void mmap_unmap(mapid_t);
+bool mmap_fork(struct process* parent);
+
+#endif /* vm/mmap.h */
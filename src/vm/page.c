@@ -0,0 +1,801 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "filesys/page-cache.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Demand paging.
+
+   load() does not read an executable's segments into memory.
+   Instead it records, for each page of each segment, the part of
+   the executable that the page comes from in the process's
+   supplemental page table, a hash table of struct page keyed by
+   user virtual address.  Stack pages are recorded the same way,
+   as pages of zeros, one when the stack is set up and then one
+   more for each fault that page_grow_stack() takes for an access
+   to the stack below the pages it has so far.  The first access
+   to a page faults, and the page fault handler calls page_in()
+   to read the page into a frame obtained from the frame table
+   and map it.  Pages that a process never touches are never
+   read.  Neighbouring pages that can be mapped without reading
+   anything, pages of zeros and pages already in the page cache,
+   are mapped along with a faulting page, to spare the process a
+   fault for each of them.
+
+   A page of a memory-mapped file (see mmap.c) is not read into a
+   frame of its own: the page fault handler maps the page cache's
+   copy of the file data in place, so that the process's writes
+   land in the same page that read() and write() use, and are
+   written back to the file from there.  Read-only pages of an
+   executable are mapped from the page cache the same way, which
+   shares them among all the processes running it: the cache
+   finds a page by file and offset, counts the processes holding
+   it, and each maps it read-only.
+
+   When memory runs short, the frame table evicts pages with
+   page_out().  A page that has not been written since it was
+   read in is simply dropped, to be read again from its file or
+   zeroed again on the next fault.  A page mapped from the page
+   cache is unmapped and left to the cache.  Any other dirty page
+   goes to swap, and a page read back from swap is marked dirty,
+   because swap is the only copy of its contents.  Dirty pages
+   are evicted and written to swap in batches, and a fault on a
+   swapped-out page reads the pages that were swapped out along
+   with it in the same request, if they are still out.
+
+   fork() copies a process's table for the child, page by page.
+   A page in memory is not copied but shared between the two
+   (see frame.c), mapped read-only in both, and a write to it
+   faults into page_unshare(), which gives the writer a copy of
+   its own.  A page in swap is copied to another slot.
+
+   The table is protected by the process's pages_lock, which is
+   held while a page is read in, so that two threads faulting on
+   the same page bring it in only once.  A page's FRAME and
+   SWAP_SLOT are also changed by other processes' evictions, under
+   the frame table's lock; see frame.c. */
+
+/* Statistics, protected by disabling interrupts. */
+static long long pages_mapped;     /* Pages in exited processes' tables. */
+static long long pages_touched;    /* Of those, pages ever brought in. */
+static long long read_ahead_pages; /* Pages read from swap ahead of a fault. */
+static long long fault_cnt;        /* Page faults in exited processes. */
+static long long fault_around_cnt; /* Pages they mapped around faults. */
+
+/* Size, in pages, of the aligned block around a faulting page
+   whose pages fault_around() maps along with it.  1 turns
+   fault-around off.  Set with the -fault-around kernel option. */
+size_t fault_around_pages = FAULT_AROUND_DEFAULT;
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+
+/* Initializes PCB's supplemental page table.  Returns false if
+   memory is not available. */
+bool page_table_init(struct process* pcb) {
+  lock_init(&pcb->pages_lock);
+  pcb->fault_cnt = 0;
+  pcb->fault_around_cnt = 0;
+  return hash_init(&pcb->pages, page_hash, page_less, NULL);
+}
+
+/* Frees page P, along with its frame and swap slot.  A page
+   mapped from the page cache goes back to the cache, to be
+   written back from there if it is dirty.  P must no longer be
+   in any supplemental page table. */
+static void release_page(struct page* p) {
+  frame_free(p);
+  if (p->swap_slot != SWAP_NONE)
+    swap_free(p->swap_slot);
+  free(p);
+}
+
+/* Frees the page at E. */
+static void destroy_page(struct hash_elem* e, void* aux UNUSED) {
+  release_page(hash_entry(e, struct page, elem));
+}
+
+/* Destroys PCB's supplemental page table, freeing the frames and
+   swap slots of its pages and handing pages mapped from the page
+   cache back to the cache.  Must be called before the page
+   directory that the pages are mapped in is destroyed. */
+void page_table_destroy(struct process* pcb) {
+  struct hash_iterator i;
+  enum intr_level old_level;
+  long long touched = 0;
+
+  hash_first(&i, &pcb->pages);
+  while (hash_next(&i))
+    if (hash_entry(hash_cur(&i), struct page, elem)->loaded)
+      touched++;
+
+  old_level = intr_disable();
+  pages_mapped += hash_size(&pcb->pages);
+  pages_touched += touched;
+  fault_cnt += pcb->fault_cnt;
+  fault_around_cnt += pcb->fault_around_cnt;
+  intr_set_level(old_level);
+
+  hash_destroy(&pcb->pages, destroy_page);
+}
+
+/* Returns the current process's page containing UPAGE, or a null
+   pointer if there is none.  The process's pages_lock must be
+   held. */
+static struct page* page_lookup(struct process* pcb, const void* upage) {
+  struct page p;
+  struct hash_elem* e;
+
+  p.upage = (void*)upage;
+  e = hash_find(&pcb->pages, &p.elem);
+  return e != NULL ? hash_entry(e, struct page, elem) : NULL;
+}
+
+/* Adds page UPAGE to the current process's supplemental page
+   table, to be filled with READ_BYTES bytes of FILE starting at
+   offset OFS followed by zeros, and mapped from the page cache
+   if CACHED is true.  Returns false if UPAGE is already part of
+   the address space or memory is not available. */
+static bool add_page(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                     bool writable, bool cached) {
+  struct process* pcb = thread_current()->pcb;
+  struct page* p;
+  bool success;
+
+  ASSERT(pg_ofs(upage) == 0);
+  ASSERT(read_bytes <= PGSIZE);
+
+  p = malloc_tagged(sizeof *p, MT_VM);
+  if (p == NULL)
+    return false;
+  p->upage = upage;
+  p->pagedir = pcb->pagedir;
+  p->pcb = pcb;
+  p->file = read_bytes > 0 ? file : NULL;
+  p->file_ofs = ofs;
+  p->read_bytes = read_bytes;
+  p->writable = writable;
+  p->cached = cached;
+  p->loaded = false;
+  p->frame = NULL;
+  p->swap_slot = SWAP_NONE;
+  p->cow_next = p;
+
+  lock_acquire(&pcb->pages_lock);
+  success = hash_insert(&pcb->pages, &p->elem) == NULL;
+  lock_release(&pcb->pages_lock);
+  if (!success)
+    free(p);
+  return success;
+}
+
+/* Records that page UPAGE of the current process is READ_BYTES
+   bytes of FILE starting at offset OFS, followed by zeros, to be
+   read when the page is first accessed.  The page is writable by
+   the process if WRITABLE is true.  FILE must stay open for as
+   long as the process runs.  Returns false if UPAGE is already
+   part of the address space or memory is not available.
+
+   A read-only page whose data is exactly a page of the file, as
+   the pages of an executable's code mostly are, is mapped from
+   the page cache, so that all the processes running the same
+   executable share one copy of it.  Only a page whose data stops
+   short of both the end of the page and the end of the file,
+   leaving other file data where zeros belong, is read into a
+   frame of its own. */
+bool page_add_file(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                   bool writable) {
+  bool cached = !writable && read_bytes > 0 && ofs % PGSIZE == 0 &&
+                (read_bytes == PGSIZE || ofs + (off_t)read_bytes == file_length(file));
+  return add_page(upage, file, ofs, read_bytes, writable, cached);
+}
+
+/* Records that page UPAGE of the current process is a page of
+   zeros, writable by the process if WRITABLE is true.  Returns
+   false if UPAGE is already part of the address space or memory
+   is not available. */
+bool page_add_zero(void* upage, bool writable) {
+  return add_page(upage, NULL, 0, 0, writable, false);
+}
+
+/* Records that page UPAGE of the current process maps the
+   READ_BYTES bytes of FILE starting at offset OFS, followed by
+   zeros.  The page is mapped from the page cache when first
+   accessed, so that the process's writes to it are writes to
+   FILE.  FILE must stay open until the page is removed.
+   Returns false if UPAGE is already part of the address space
+   or memory is not available. */
+bool page_add_mmap(void* upage, struct file* file, off_t ofs, uint32_t read_bytes) {
+  return add_page(upage, file, ofs, read_bytes, true, true);
+}
+
+/* Removes page UPAGE from the current process's address space.
+   Does nothing if UPAGE is not part of the address space. */
+void page_remove(void* upage) {
+  struct process* pcb = thread_current()->pcb;
+  struct page* p;
+
+  lock_acquire(&pcb->pages_lock);
+  p = page_lookup(pcb, upage);
+  if (p != NULL)
+    hash_delete(&pcb->pages, &p->elem);
+  lock_release(&pcb->pages_lock);
+
+  if (p != NULL)
+    release_page(p);
+}
+
+/* Maps page P, whose contents are now in its frame, and unpins
+   the frame.  A page just read from swap is marked dirty if
+   SWAPPED is true, because swap no longer holds a copy.  Returns
+   false, putting the page back in swap if SWAPPED and freeing
+   the frame, if memory is not available. */
+static bool map_page(struct page* p, bool swapped) {
+  void* kpage = p->frame->kpage;
+
+  if (!pagedir_set_page(p->pagedir, p->upage, kpage, p->writable)) {
+    if (swapped && swap_out(&kpage, 1, &p->swap_slot) == 0)
+      p->swap_slot = SWAP_NONE;
+    frame_free(p);
+    return false;
+  }
+  if (swapped)
+    pagedir_set_dirty(p->pagedir, p->upage, true);
+  frame_unpin(p->frame);
+  return true;
+}
+
+/* Reads page P of PCB back from swap into the frame just
+   allocated for it, and maps it.  Pages that follow P in the
+   address space and were swapped out to the slots that follow
+   P's are read along with it, in the same request, as long as
+   free frames are at hand for them: pages evicted together tend
+   to be needed again together.  Returns false if memory is not
+   available.  PCB's pages_lock must be held. */
+static bool swap_in_page(struct process* pcb, struct page* p) {
+  struct page* run[SWAP_BATCH_MAX];
+  void* kpages[SWAP_BATCH_MAX];
+  enum intr_level old_level;
+  size_t cnt, i;
+  bool success = true;
+
+  run[0] = p;
+  kpages[0] = p->frame->kpage;
+  for (cnt = 1; cnt < SWAP_BATCH_MAX; cnt++) {
+    struct page* q = page_lookup(pcb, (uint8_t*)p->upage + cnt * PGSIZE);
+    if (q == NULL || q->frame != NULL || q->swap_slot != p->swap_slot + cnt ||
+        frame_try_alloc(q, false) == NULL)
+      break;
+    run[cnt] = q;
+    kpages[cnt] = q->frame->kpage;
+  }
+
+  swap_in(p->swap_slot, kpages, cnt);
+  for (i = 0; i < cnt; i++) {
+    run[i]->swap_slot = SWAP_NONE;
+    if (!map_page(run[i], true) && i == 0)
+      success = false;
+  }
+
+  old_level = intr_disable();
+  read_ahead_pages += cnt - 1;
+  intr_set_level(old_level);
+  return success;
+}
+
+/* Maps page P straight from the page cache, reading it into the
+   cache first if it is not there.
+   Returns false if memory is not available. */
+static bool load_cached_page(struct page* p) {
+  block_sector_t inumber = inode_get_inumber(file_get_inode(p->file));
+  struct cache_page* cp = page_cache_get(inumber, p->file_ofs / PGSIZE, true);
+
+  if (cp == NULL)
+    return false;
+  if (frame_map_cached(p, cp) == NULL) {
+    page_cache_put(cp, false);
+    return false;
+  }
+  p->loaded = true;
+  return map_page(p, false);
+}
+
+/* Reads page P of PCB into a new frame, from swap if it was
+   swapped out and otherwise from its file, and maps it.  Returns
+   false if memory is not available or the read comes up short.
+   PCB's pages_lock must be held. */
+static bool load_page(struct process* pcb, struct page* p) {
+  struct frame* f;
+
+  if (p->cached)
+    return load_cached_page(p);
+
+  /* frame_alloc() waits out any eviction of P still in progress,
+     so SWAP_SLOT is only examined after it returns. */
+  f = frame_alloc(p, p->read_bytes == 0);
+  if (f == NULL)
+    return false;
+  p->loaded = true;
+
+  if (p->swap_slot != SWAP_NONE)
+    return swap_in_page(pcb, p);
+  if (p->read_bytes > 0) {
+    if (file_read_at(p->file, f->kpage, p->read_bytes, p->file_ofs) != (off_t)p->read_bytes) {
+      frame_free(p);
+      return false;
+    }
+    memset((uint8_t*)f->kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+  }
+  return map_page(p, false);
+}
+
+/* Maps page P, which is not in memory, if that takes neither
+   disk I/O nor eviction: if it is mapped from the page cache and
+   the cache already holds it, or if it is a page of zeros and a
+   free frame is at hand.  Returns true if P was mapped. */
+static bool map_nearby_page(struct page* p) {
+  if (p->cached) {
+    block_sector_t inumber = inode_get_inumber(file_get_inode(p->file));
+    struct cache_page* cp = page_cache_lookup(inumber, p->file_ofs / PGSIZE);
+
+    if (cp == NULL)
+      return false;
+    if (frame_map_cached(p, cp) == NULL) {
+      page_cache_put(cp, false);
+      return false;
+    }
+  } else if (p->file != NULL || p->swap_slot != SWAP_NONE || frame_try_alloc(p, true) == NULL)
+    return false;
+  p->loaded = true;
+  return map_page(p, false);
+}
+
+/* Maps the pages of PCB around page P, which has just been
+   brought in on a fault, that map_nearby_page() can map cheaply,
+   so that a scan through a segment takes one fault per block of
+   FAULT_AROUND_PAGES pages instead of one per page.  The block is
+   aligned, as in Linux, so that a scan in either direction
+   benefits.  PCB's pages_lock must be held. */
+static void fault_around(struct process* pcb, struct page* p) {
+  size_t first, i;
+
+  if (fault_around_pages <= 1)
+    return;
+  first = pg_no(p->upage) / fault_around_pages * fault_around_pages;
+  for (i = first; i < first + fault_around_pages; i++) {
+    void* upage = (void*)(i << PGBITS);
+    struct page* q;
+
+    if (upage == p->upage || !is_user_vaddr(upage))
+      continue;
+    q = page_lookup(pcb, upage);
+    if (q != NULL && q->frame == NULL && map_nearby_page(q))
+      pcb->fault_around_cnt++;
+  }
+}
+
+/* Makes sure that the page containing UADDR is mapped in the
+   current process's page directory, reading it in if it is
+   recorded in the supplemental page table but not yet loaded.
+   Returns false if UADDR is not part of the process's address
+   space or the page cannot be read in. */
+bool page_in(const void* uaddr) {
+  struct process* pcb = thread_current()->pcb;
+  void* upage = pg_round_down(uaddr);
+  struct page* p;
+  bool success;
+
+  if (pcb == NULL || pcb->pagedir == NULL || !is_user_vaddr(uaddr))
+    return false;
+  if (pagedir_get_page(pcb->pagedir, upage) != NULL)
+    return true;
+
+  lock_acquire(&pcb->pages_lock);
+  p = page_lookup(pcb, upage);
+  if (p == NULL)
+    success = false;
+  else if (pagedir_get_page(pcb->pagedir, upage) != NULL)
+    success = true; /* Another thread brought it in. */
+  else {
+    success = load_page(pcb, p);
+    if (success)
+      fault_around(pcb, p);
+  }
+  lock_release(&pcb->pages_lock);
+  return success;
+}
+
+/* Returns true if an access to UADDR, with the user stack pointer
+   at ESP, looks like an access to the stack that ESP points into:
+   no more than 32 bytes below ESP, as PUSHA writes, and within
+   the same stack slot, which bounds each stack at
+   MAX_STACK_PAGES. */
+static bool is_stack_access(const uint8_t* uaddr, const uint8_t* esp) {
+  const uint8_t* top = PHYS_BASE;
+  size_t slot_size = (size_t)MAX_STACK_PAGES * PGSIZE;
+  size_t slot;
+
+  if (esp == NULL || !is_user_vaddr(esp) || !is_user_vaddr(uaddr) || uaddr + 32 < esp)
+    return false;
+  slot = (top - 1 - esp) / slot_size;
+  return slot < MAX_THREADS && (top - 1 - uaddr) / slot_size == slot;
+}
+
+/* Grows the current process's stack to take in UADDR, with a
+   page of zeros, if an access to UADDR with the user stack
+   pointer at ESP looks like an access to the stack.  Returns
+   false if it does not or if memory is not available. */
+bool page_grow_stack(const void* uaddr, const void* esp) {
+  struct process* pcb = thread_current()->pcb;
+
+  if (pcb == NULL || pcb->pagedir == NULL || !is_stack_access(uaddr, esp))
+    return false;
+
+  /* This fails if another thread added the page first, which
+     page_in() does not mind. */
+  page_add_zero(pg_round_down(uaddr), true);
+  return page_in(uaddr);
+}
+
+/* Handles a write to the page containing UADDR in the current
+   process, which is mapped read-only because it shares its frame
+   with another process since fork(), by giving the process a
+   frame of its own.  Returns false if UADDR is not part of a
+   writable page of the process's address space or memory is not
+   available. */
+bool page_unshare(const void* uaddr) {
+  struct process* pcb = thread_current()->pcb;
+  struct page* p;
+  bool success;
+
+  if (pcb == NULL || pcb->pagedir == NULL || !is_user_vaddr(uaddr))
+    return false;
+
+  lock_acquire(&pcb->pages_lock);
+  p = page_lookup(pcb, pg_round_down(uaddr));
+  success = p != NULL && p->writable && !p->cached && frame_unshare(p);
+  lock_release(&pcb->pages_lock);
+  return success;
+}
+
+/* Brings the page at UPAGE of PCB, the current process, into
+   memory and pins its frame, for a system call that is about to
+   copy to the page if WRITE is true or from it otherwise.  A
+   writable page is first given a frame of its own, if it shares
+   one since fork(), so that the pinned frame is the page's for as
+   long as it stays pinned.  Returns false if UPAGE is not part
+   of the address space, is read-only and WRITE is true, or
+   cannot be brought in. */
+static bool pin_page(struct process* pcb, void* upage, bool write) {
+  struct page* p;
+  bool success = true;
+
+  if (!page_in(upage) && !page_grow_stack(upage, thread_current()->user_esp))
+    return false;
+
+  lock_acquire(&pcb->pages_lock);
+  p = page_lookup(pcb, upage);
+  if (p == NULL || (write && !p->writable))
+    success = false;
+  else
+    /* The page may be evicted again at any point before it is
+       pinned, so keep at it until it is. */
+    for (;;) {
+      if (p->frame == NULL && !load_page(pcb, p)) {
+        success = false;
+        break;
+      }
+      if (p->writable && !p->cached && !frame_unshare(p)) {
+        success = false;
+        break;
+      }
+      if (frame_pin(p) != NULL)
+        break;
+    }
+  lock_release(&pcb->pages_lock);
+  return success;
+}
+
+/* Unpins the frame of the page at UPAGE of PCB, which
+   pin_page() pinned. */
+static void unpin_page(struct process* pcb, void* upage) {
+  struct page* p;
+
+  lock_acquire(&pcb->pages_lock);
+  p = page_lookup(pcb, upage);
+  ASSERT(p != NULL && p->frame != NULL);
+  frame_unpin(p->frame);
+  lock_release(&pcb->pages_lock);
+}
+
+/* Brings the SIZE bytes of the current process's address space
+   starting at UADDR into memory and pins them there, so that a
+   system call can copy to them, if WRITE is true, or from them
+   without faulting and without the pages being evicted midway.
+   Undo with page_unpin_range().  Returns false, pinning nothing,
+   if any of the bytes is not part of the address space, is
+   read-only and WRITE is true, or cannot be brought in. */
+bool page_pin_range(const void* uaddr, size_t size, bool write) {
+  struct process* pcb = thread_current()->pcb;
+  uint8_t* first = pg_round_down(uaddr);
+  uint8_t* upage;
+
+  if (size == 0)
+    return true;
+  if (pcb == NULL || pcb->pagedir == NULL || !is_user_vaddr(uaddr) ||
+      size > (size_t)((uint8_t*)PHYS_BASE - (uint8_t*)uaddr))
+    return false;
+
+  for (upage = first; upage < (uint8_t*)uaddr + size; upage += PGSIZE)
+    if (!pin_page(pcb, upage, write)) {
+      while (upage > first) {
+        upage -= PGSIZE;
+        unpin_page(pcb, upage);
+      }
+      return false;
+    }
+  return true;
+}
+
+/* Unpins the SIZE bytes starting at UADDR that
+   page_pin_range() pinned. */
+void page_unpin_range(const void* uaddr, size_t size) {
+  struct process* pcb = thread_current()->pcb;
+  uint8_t* upage;
+
+  if (size == 0)
+    return;
+  for (upage = pg_round_down(uaddr); upage < (uint8_t*)uaddr + size; upage += PGSIZE)
+    unpin_page(pcb, upage);
+}
+
+/* Gives page C of the current process a private copy of the
+   frame holding page P of another process, for fork(), because
+   P's frame is pinned and cannot be shared.  Leaves C without a
+   frame if P has been evicted meanwhile.  Returns false if
+   memory is not available. */
+static bool copy_frame(struct page* p, struct page* c) {
+  struct frame* pf = frame_pin(p);
+  struct frame* cf;
+
+  if (pf == NULL)
+    return true;
+  cf = frame_alloc(c, false);
+  if (cf == NULL) {
+    frame_unpin(pf);
+    return false;
+  }
+  memcpy(cf->kpage, pf->kpage, PGSIZE);
+  frame_unpin(pf);
+  c->loaded = true;
+  if (!pagedir_set_page(c->pagedir, c->upage, cf->kpage, c->writable)) {
+    frame_free(c);
+    return false;
+  }
+  pagedir_set_dirty(c->pagedir, c->upage, true);
+  frame_unpin(cf);
+  return true;
+}
+
+/* Copies page P of another process into the current process's
+   supplemental page table, as page C, for fork().  C reads its
+   data from the current process's executable EXEC instead of the
+   parent's.  Returns false if memory or swap space is not
+   available.  The parent's pages_lock must be held. */
+static bool fork_page(struct page* p, struct file* exec) {
+  struct process* pcb = thread_current()->pcb;
+  struct page* c = malloc_tagged(sizeof *c, MT_VM);
+
+  if (c == NULL)
+    return false;
+  *c = *p;
+  c->pagedir = pcb->pagedir;
+  c->pcb = pcb;
+  c->file = p->file != NULL ? exec : NULL;
+  c->frame = NULL;
+  c->swap_slot = SWAP_NONE;
+  c->cow_next = c;
+
+  lock_acquire(&pcb->pages_lock);
+  hash_insert(&pcb->pages, &c->elem);
+  lock_release(&pcb->pages_lock);
+
+  /* A page cache page is mapped again from the cache when the
+     child touches it.  Any other page the parent has in memory is
+     shared, or copied if a system call has it pinned, and one
+     that is in swap is copied there: with the parent's pages_lock
+     held, it cannot move in the meantime. */
+  if (p->cached)
+    return true;
+  if (!frame_share(p, c) && !copy_frame(p, c))
+    return false;
+  if (c->frame == NULL && p->swap_slot != SWAP_NONE) {
+    c->swap_slot = swap_copy(p->swap_slot);
+    return c->swap_slot != SWAP_NONE;
+  }
+  return true;
+}
+
+/* Fills in the current process's supplemental page table, which
+   must be empty, as a copy of PARENT's, for fork().  The pages
+   that PARENT has in memory are shared copy-on-write, so that
+   neither process sees the other's later writes.  The pages of
+   memory-mapped files are left to mmap_fork().  Returns false if
+   memory or swap space is not available; the pages copied so far
+   stay in the table, for page_table_destroy() to free. */
+bool page_fork(struct process* parent) {
+  struct file* exec = thread_current()->pcb->curr_executable;
+  struct hash_iterator i;
+  bool success = true;
+
+  lock_acquire(&parent->pages_lock);
+  hash_first(&i, &parent->pages);
+  while (success && hash_next(&i)) {
+    struct page* p = hash_entry(hash_cur(&i), struct page, elem);
+    if (p->file == NULL || p->file == parent->curr_executable)
+      success = fork_page(p, exec);
+  }
+  lock_release(&parent->pages_lock);
+  return success;
+}
+
+/* Returns true if page A should go to swap ahead of page B:
+   pages of one process go together, in address order. */
+static bool swap_order_less(const struct page* a, const struct page* b) {
+  return a->pagedir != b->pagedir ? a->pagedir < b->pagedir : a->upage < b->upage;
+}
+
+/* Puts the pages sharing frame F, which page_out() could not save
+   to swap in full, back in place, freeing the slots that some of
+   them did get. */
+static void put_back(struct frame* f) {
+  struct page* p = f->page;
+  bool shared = p->cow_next != p;
+
+  do {
+    if (p->swap_slot != SWAP_NONE) {
+      swap_free(p->swap_slot);
+      p->swap_slot = SWAP_NONE;
+    }
+    pagedir_set_page(p->pagedir, p->upage, f->kpage, p->writable && !shared);
+    pagedir_set_dirty(p->pagedir, p->upage, true);
+    p = p->cow_next;
+  } while (p != f->page);
+}
+
+/* Evicts the pages held in the CNT frames in FRAMES and unmaps
+   them.  Pages mapped from the page cache are left to the cache,
+   which the frame table hands them back to.  Other dirty pages
+   are written to swap together, sorted so that neighbouring pages
+   of a process land in neighbouring slots, where swap_in_page()
+   can read them back together.  Each page that shares a frame
+   copy-on-write gets a slot of its own, so the frames may hold no
+   more than SWAP_BATCH_MAX pages between them.  Rearranges FRAMES
+   so that it begins with the frames whose pages were evicted, and
+   returns their number.  Only if swap is full do some dirty pages
+   stay in place.  Called by the frame table, with its lock
+   held. */
+size_t page_out(struct frame* frames[], size_t cnt) {
+  struct frame* dirty_frames[SWAP_BATCH_MAX];
+  struct page* dirty[SWAP_BATCH_MAX];
+  void* kpages[SWAP_BATCH_MAX];
+  size_t slots[SWAP_BATCH_MAX];
+  size_t dirty_frame_cnt = 0;
+  size_t dirty_cnt = 0;
+  size_t out_cnt = 0;
+  size_t written;
+  size_t i, j;
+
+  ASSERT(cnt <= SWAP_BATCH_MAX);
+
+  /* Unmap first, so that no process can dirty a page after we
+     decide whether to save it. */
+  for (i = 0; i < cnt; i++) {
+    struct page* first = frames[i]->page;
+    struct page* p = first;
+    bool is_dirty = false;
+
+    do {
+      pagedir_clear_page(p->pagedir, p->upage);
+      if (pagedir_is_dirty(p->pagedir, p->upage))
+        is_dirty = true;
+      p = p->cow_next;
+    } while (p != first);
+
+    if (first->cached || !is_dirty) {
+      frames[out_cnt++] = frames[i];
+      continue;
+    }
+    dirty_frames[dirty_frame_cnt++] = frames[i];
+    do {
+      ASSERT(dirty_cnt < SWAP_BATCH_MAX);
+      for (j = dirty_cnt++; j > 0 && swap_order_less(p, dirty[j - 1]); j--)
+        dirty[j] = dirty[j - 1];
+      dirty[j] = p;
+      p = p->cow_next;
+    } while (p != first);
+  }
+
+  for (i = 0; i < dirty_cnt; i++)
+    kpages[i] = dirty[i]->frame->kpage;
+  written = swap_out(kpages, dirty_cnt, slots);
+  for (i = 0; i < dirty_cnt; i++)
+    dirty[i]->swap_slot = i < written ? slots[i] : SWAP_NONE;
+
+  /* A frame is out only if every page sharing it made it to swap.
+     If swap is full, put the others back. */
+  for (i = 0; i < dirty_frame_cnt; i++) {
+    struct frame* f = dirty_frames[i];
+    struct page* p = f->page;
+    bool saved = true;
+
+    do {
+      if (p->swap_slot == SWAP_NONE)
+        saved = false;
+      p = p->cow_next;
+    } while (p != f->page);
+    if (saved)
+      frames[out_cnt++] = f;
+    else
+      put_back(f);
+  }
+
+  /* The pages of evicted frames no longer share anything. */
+  for (i = 0; i < out_cnt; i++) {
+    struct page* p = frames[i]->page;
+    do {
+      struct page* next = p->cow_next;
+      page_set_frame(p, NULL);
+      p->cow_next = p;
+      p = next;
+    } while (p != frames[i]->page);
+  }
+  return out_cnt;
+}
+
+/* Sets page P's frame to F, either of which may be null,
+   keeping count of its process's resident pages.  Called with
+   the frame table's lock held. */
+void page_set_frame(struct page* p, struct frame* f) {
+  struct rusage* ru = &p->pcb->rusage;
+
+  if (p->frame == NULL && f != NULL) {
+    if (++ru->resident_pages > ru->peak_resident_pages)
+      ru->peak_resident_pages = ru->resident_pages;
+  } else if (p->frame != NULL && f == NULL)
+    ru->resident_pages--;
+  p->frame = f;
+}
+
+/* Prints demand paging statistics. */
+void page_print_stats(void) {
+  printf("Paging: %lld of %lld pages touched, %lld read ahead from swap\n", pages_touched,
+         pages_mapped, read_ahead_pages);
+  printf("Faults: %lld page faults, %lld more pages mapped around them\n", fault_cnt,
+         fault_around_cnt);
+  frame_print_stats();
+  swap_print_stats();
+}
+
+/* Returns a hash value for the page at E. */
+static unsigned page_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct page* p = hash_entry(e, struct page, elem);
+  return hash_bytes(&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool page_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED) {
+  const struct page* a = hash_entry(a_, struct page, elem);
+  const struct page* b = hash_entry(b_, struct page, elem);
+  return a->upage < b->upage;
+}
@@ -0,0 +1,56 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct frame;
+struct process;
+
+/* Default for fault_around_pages. */
+#define FAULT_AROUND_DEFAULT 16
+
+extern size_t fault_around_pages;
+
+/* A page of a process's address space, as recorded in its
+   supplemental page table: where the page's contents come from
+   whenever it has to be brought into memory. */
+struct page {
+  void* upage;           /* User virtual address of the page. */
+  uint32_t* pagedir;     /* Page directory the page is mapped in. */
+  struct process* pcb;   /* Process the page belongs to. */
+  struct file* file;     /* File holding the page's data, or null. */
+  off_t file_ofs;        /* Offset of the data in FILE. */
+  uint32_t read_bytes;   /* Bytes read from FILE; the rest are zeroed. */
+  bool writable;         /* May the process write to the page? */
+  bool cached;           /* Mapped from the page cache? */
+  bool loaded;           /* Has the page ever been brought in? */
+  struct frame* frame;   /* Frame holding the page, or null. */
+  size_t swap_slot;      /* Swap slot holding the page, or SWAP_NONE. */
+  struct page* cow_next; /* Next page sharing FRAME copy-on-write. */
+  struct hash_elem elem; /* Element in the supplemental page table. */
+};
+
+bool page_table_init(struct process*);
+void page_table_destroy(struct process*);
+
+bool page_add_file(void* upage, struct file*, off_t ofs, uint32_t read_bytes, bool writable);
+bool page_add_zero(void* upage, bool writable);
+bool page_add_mmap(void* upage, struct file*, off_t ofs, uint32_t read_bytes);
+void page_remove(void* upage);
+bool page_in(const void* uaddr);
+bool page_grow_stack(const void* uaddr, const void* esp);
+bool page_unshare(const void* uaddr);
+bool page_pin_range(const void* uaddr, size_t size, bool write);
+void page_unpin_range(const void* uaddr, size_t size);
+bool page_fork(struct process* parent);
+size_t page_out(struct frame*[], size_t cnt);
+void page_set_frame(struct page*, struct frame*);
+
+void page_print_stats(void);
+
+#endif /* vm/page.h */
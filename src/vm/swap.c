@@ -0,0 +1,294 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+/* Swap space.
+
+   The swap device is divided into page-sized slots.  A bitmap
+   records which slots are in use.  An evicted page that cannot
+   be read back from where it came from is written to a free
+   slot, and the slot is freed again when the page is read back
+   in or its process exits.
+
+   Pages move in batches.  swap_out() writes a batch of pages to
+   a run of consecutive slots, and swap_in() reads a run of
+   consecutive slots, each with a single block_writev() or
+   block_readv() request, so that the disk sees one command per
+   run instead of one per sector.
+
+   Free runs are found next-fit: the search for free slots starts
+   where the last one ended, instead of at slot 0, so it does not
+   rescan the slots that have filled up at the front of the
+   device on every eviction.
+
+   In front of the device sits compressed swap (see zswap.c),
+   which keeps evicted pages compressed in memory.  swap_out()
+   offers it each page first and writes to the device only the
+   pages that it turns down.  Its slots are numbered after the
+   device's, from DISK_SLOT_CNT up, so that callers need not tell
+   the two apart.  zswap_store() takes one page at a time and
+   gives each its own slot, so the pages of a batch that it keeps
+   need not end up in consecutive slots.  swap_in() loads those
+   one by one and reads only runs of device slots together. */
+
+/* Number of sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block* swap_device; /* Swap device, or null if none. */
+static struct bitmap* used_slots; /* One bit per device slot, true if in use. */
+static size_t disk_slot_cnt;      /* Slots on the device; zswap's follow. */
+static size_t cursor;             /* Slot where the next search starts. */
+static struct lock swap_lock;     /* Protects the members above and statistics. */
+
+/* Statistics. */
+static long long swap_writes;    /* Pages written to the device. */
+static long long swap_reads;     /* Pages read from the device. */
+static long long write_requests; /* Requests that wrote them. */
+static long long read_requests;  /* Requests that read them. */
+
+/* Initializes swap space on the swap device, if there is one,
+   and compressed swap in memory.  With neither, swap_out()
+   always fails. */
+void swap_init(void) {
+  swap_device = block_get_role(BLOCK_SWAP);
+  if (swap_device != NULL)
+    disk_slot_cnt = block_size(swap_device) / SECTORS_PER_PAGE;
+  else
+    printf("swap: no swap device, pages will only be swapped to memory\n");
+
+  used_slots = bitmap_create(disk_slot_cnt);
+  if (used_slots == NULL)
+    PANIC("swap: bitmap creation failed");
+  cursor = 0;
+  lock_init(&swap_lock);
+  zswap_init();
+}
+
+/* Returns true if SLOT belongs to compressed swap. */
+static bool is_zswap(size_t slot) { return slot >= disk_slot_cnt; }
+
+/* Finds CNT consecutive free slots, searching next-fit from
+   CURSOR, and marks them used.  Returns the first slot, or
+   BITMAP_ERROR if there is no such run.  SWAP_LOCK must be
+   held. */
+static size_t alloc_slots(size_t cnt) {
+  size_t slot = bitmap_scan_and_flip(used_slots, cursor, cnt, false);
+
+  if (slot == BITMAP_ERROR && cursor > 0)
+    slot = bitmap_scan_and_flip(used_slots, 0, cnt, false);
+  if (slot != BITMAP_ERROR) {
+    cursor = slot + cnt;
+    if (cursor >= bitmap_size(used_slots))
+      cursor = 0;
+  }
+  return slot;
+}
+
+/* Reads (if WRITE is false) or writes (if WRITE is true) the CNT
+   pages in KPAGES from or to the slots starting at SLOT, with a
+   single request. */
+static void transfer(size_t slot, void* const kpages[], size_t cnt, bool write) {
+  void* sectors[SWAP_BATCH_MAX * SECTORS_PER_PAGE];
+  size_t i;
+
+  ASSERT(cnt <= SWAP_BATCH_MAX);
+  for (i = 0; i < cnt * SECTORS_PER_PAGE; i++)
+    sectors[i] = (uint8_t*)kpages[i / SECTORS_PER_PAGE] + i % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE;
+
+  if (write)
+    block_writev(swap_device, slot * SECTORS_PER_PAGE, cnt * SECTORS_PER_PAGE,
+                 (const void* const*)sectors);
+  else
+    block_readv(swap_device, slot * SECTORS_PER_PAGE, cnt * SECTORS_PER_PAGE, sectors);
+}
+
+/* Writes the CNT pages in KPAGES to the swap device, storing
+   the slot that receives KPAGES[I] into SLOTS[I].  The pages go
+   to as few runs of consecutive slots as free space allows, one
+   request per run.  Returns the number of pages written, which
+   is less than CNT only if the device is full; those are the
+   first pages in KPAGES. */
+static size_t write_out(void* const kpages[], size_t cnt, size_t slots[]) {
+  size_t done = 0;
+
+  ASSERT(cnt <= SWAP_BATCH_MAX);
+  while (done < cnt) {
+    size_t run = cnt - done;
+    size_t first = BITMAP_ERROR;
+    size_t i;
+
+    /* Settle for shorter runs as long as any fit. */
+    lock_acquire(&swap_lock);
+    while (run > 0 && (first = alloc_slots(run)) == BITMAP_ERROR)
+      run /= 2;
+    if (run > 0) {
+      swap_writes += run;
+      write_requests++;
+    }
+    lock_release(&swap_lock);
+    if (run == 0)
+      break;
+
+    transfer(first, kpages + done, run, true);
+    for (i = 0; i < run; i++)
+      slots[done + i] = first + i;
+    done += run;
+  }
+  return done;
+}
+
+/* Writes the CNT pages in KPAGES to swap, storing the slot that
+   receives KPAGES[I] into SLOTS[I].  Each page is kept in
+   compressed swap if it will take it, and the rest go to the
+   swap device.  Returns the number of pages written, which is
+   less than CNT only if swap is full; those are the first pages
+   in KPAGES. */
+size_t swap_out(void* const kpages[], size_t cnt, size_t slots[]) {
+  void* disk_pages[SWAP_BATCH_MAX];
+  size_t disk_slots[SWAP_BATCH_MAX];
+  size_t disk_idx[SWAP_BATCH_MAX]; /* Index in KPAGES of each of DISK_PAGES. */
+  bool kept[SWAP_BATCH_MAX];       /* Whether zswap took each of KPAGES. */
+  size_t disk_cnt = 0;
+  size_t written, done, i;
+
+  ASSERT(cnt <= SWAP_BATCH_MAX);
+  for (i = 0; i < cnt; i++) {
+    size_t zslot;
+
+    kept[i] = zswap_store(kpages[i], &zslot);
+    if (kept[i])
+      slots[i] = disk_slot_cnt + zslot;
+    else {
+      disk_pages[disk_cnt] = kpages[i];
+      disk_idx[disk_cnt++] = i;
+    }
+  }
+  if (disk_cnt == 0)
+    return cnt;
+
+  written = write_out(disk_pages, disk_cnt, disk_slots);
+  for (i = 0; i < written; i++)
+    slots[disk_idx[i]] = disk_slots[i];
+  if (written == disk_cnt)
+    return cnt;
+
+  /* The device filled up before taking all of them.  Give up on
+     the pages from the first that it did not take onward, so that
+     those that did get slots come first. */
+  done = disk_idx[written];
+  for (i = done + 1; i < cnt; i++)
+    if (kept[i])
+      zswap_free(slots[i] - disk_slot_cnt);
+  return done;
+}
+
+/* Reads the CNT consecutive slots starting at SLOT into the
+   pages in KPAGES, with a single request for each run of them on
+   the swap device.  The slots stay in use. */
+static void read_in(size_t slot, void* const kpages[], size_t cnt) {
+  size_t i = 0;
+
+  while (i < cnt) {
+    if (is_zswap(slot + i)) {
+      zswap_load(slot + i - disk_slot_cnt, kpages[i]);
+      i++;
+    } else {
+      size_t run = 1;
+
+      while (i + run < cnt && !is_zswap(slot + i + run))
+        run++;
+      transfer(slot + i, kpages + i, run, false);
+      lock_acquire(&swap_lock);
+      swap_reads += run;
+      read_requests++;
+      lock_release(&swap_lock);
+      i += run;
+    }
+  }
+}
+
+/* Reads the CNT consecutive slots starting at SLOT into the
+   pages in KPAGES, with a single request for each run of them on
+   the swap device, and frees the slots. */
+void swap_in(size_t slot, void* const kpages[], size_t cnt) {
+  size_t i;
+
+  ASSERT(slot != SWAP_NONE);
+  read_in(slot, kpages, cnt);
+  for (i = 0; i < cnt; i++)
+    swap_free(slot + i);
+}
+
+/* Copies the page in swap SLOT to a new slot, by way of a
+   kernel page, and returns the new slot, or SWAP_NONE if memory
+   or swap space is not available.  SLOT stays in use. */
+size_t swap_copy(size_t slot) {
+  void* page = palloc_get_page(0);
+  size_t copy = SWAP_NONE;
+
+  ASSERT(slot != SWAP_NONE);
+  if (page == NULL)
+    return SWAP_NONE;
+  read_in(slot, &page, 1);
+  if (swap_out(&page, 1, &copy) == 0)
+    copy = SWAP_NONE;
+  palloc_free_page(page);
+  return copy;
+}
+
+/* Frees swap SLOT without reading it. */
+void swap_free(size_t slot) {
+  ASSERT(slot != SWAP_NONE);
+
+  if (is_zswap(slot)) {
+    zswap_free(slot - disk_slot_cnt);
+    return;
+  }
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(used_slots, slot));
+  bitmap_reset(used_slots, slot);
+  lock_release(&swap_lock);
+}
+
+/* Fills in *ST with swap traffic so far.  Returns false if there
+   is neither a swap device nor compressed swap. */
+bool swap_get_stats(struct swapstat* st) {
+  if (swap_device == NULL && zswap_slot_cnt() == 0)
+    return false;
+
+  lock_acquire(&swap_lock);
+  st->pages_written = swap_writes;
+  st->pages_read = swap_reads;
+  st->write_requests = write_requests;
+  st->read_requests = read_requests;
+  lock_release(&swap_lock);
+  zswap_get_stats(st);
+  st->ticks = timer_ticks();
+  st->ticks_per_sec = TIMER_FREQ;
+  return true;
+}
+
+/* Prints swap statistics. */
+void swap_print_stats(void) {
+  struct swapstat st;
+  long long evicted;
+
+  printf("Swap: %lld pages written in %lld requests, %lld pages read in %lld requests, "
+         "%zu of %zu slots in use\n",
+         swap_writes, write_requests, swap_reads, read_requests,
+         bitmap_count(used_slots, 0, bitmap_size(used_slots), true), bitmap_size(used_slots));
+  if (zswap_slot_cnt() > 0) {
+    zswap_get_stats(&st);
+    evicted = st.zswap_stores + swap_writes;
+    zswap_print_stats();
+    printf("Zswap: kept %lld of %lld pages swapped out (%lld%%) off the swap device\n",
+           st.zswap_stores, evicted, evicted > 0 ? st.zswap_stores * 100 / evicted : 0);
+  }
+}
@@ -0,0 +1,23 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <bitmap.h>
+#include <memstat.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Swap slot that holds nothing. */
+#define SWAP_NONE BITMAP_ERROR
+
+/* Most pages that one swap_out() or swap_in() call moves. */
+#define SWAP_BATCH_MAX 8
+
+void swap_init(void);
+size_t swap_out(void* const kpages[], size_t cnt, size_t slots[]);
+void swap_in(size_t slot, void* const kpages[], size_t cnt);
+size_t swap_copy(size_t slot);
+void swap_free(size_t slot);
+bool swap_get_stats(struct swapstat*);
+void swap_print_stats(void);
+
+#endif /* vm/swap.h */
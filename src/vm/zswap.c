@@ -0,0 +1,266 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <list.h>
+#include <lzf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap.
+
+   Writing a page to the swap device and reading it back costs
+   milliseconds, where compressing it costs microseconds, so
+   swap_out() first offers each evicted page to this in-memory
+   tier and writes it to the device only if the tier turns it
+   down.  A page of zeros is kept as a flag, taking no memory at
+   all.  Any other page is compressed with LZF and kept in a pool
+   of at most ZSWAP_POOL_PAGES kernel pages, unless it does not
+   shrink to MAX_LEN bytes or the pool is full.
+
+   The pool packs compressed pages two to a pool page, as in
+   Linux's zbud: one at the start of the page and one at the end,
+   so that freeing either leaves the other where it is and a
+   single contiguous hole for the next.  Pool pages with room for
+   a second compressed page are kept on a list; a page is freed
+   as soon as it is empty.
+
+   Compressed pages are stored in slots of their own, numbered
+   from 0, which swap.c maps into the slot numbers it hands out
+   past those of the device.  Each slot holds one compressed
+   page, or a page of zeros, until zswap_free() or until swap_in()
+   loads and frees it.  ZSWAP_LOCK protects everything here. */
+
+/* Largest compressed page kept; pages that do not compress this
+   far go to the swap device instead. */
+#define MAX_LEN (PGSIZE * 3 / 4)
+
+/* Slots per pool page: two compressed pages each, with room to
+   spare for pages of zeros, which take no pool memory. */
+#define SLOTS_PER_PAGE 4
+
+/* A page of the pool. */
+struct zpage {
+  uint8_t* kpage;        /* The page's memory. */
+  uint16_t first_len;    /* Bytes used at the start, or 0. */
+  uint16_t last_len;     /* Bytes used at the end, or 0. */
+  struct list_elem elem; /* In UNBUDDIED, if exactly one is in use. */
+};
+
+/* A slot holding a compressed page. */
+struct zentry {
+  struct zpage* zp; /* Pool page holding the data, or null for zeros. */
+  uint16_t len;     /* Size of the compressed data. */
+  bool last;        /* At the end of ZP's page, not the start? */
+};
+
+/* Size of the pool, in pages, or 0 to turn compressed swap off. */
+size_t zswap_pool_pages = ZSWAP_POOL_DEFAULT;
+
+static struct zentry* entries;    /* One per slot. */
+static struct bitmap* used_slots; /* One bit per slot, true if in use. */
+static size_t cursor;             /* Slot where the next search starts. */
+static struct list unbuddied;     /* Pool pages with one compressed page. */
+static size_t pool_cnt;           /* Pages in the pool. */
+static struct lock zswap_lock;    /* Protects everything here. */
+
+/* Scratch space for compression, protected by ZSWAP_LOCK. */
+static uint8_t buffer[MAX_LEN];
+static uint16_t htab[LZF_HTAB_SIZE];
+
+/* Statistics. */
+static long long stores;       /* Pages stored. */
+static long long zero_stores;  /* Of those, pages of zeros. */
+static long long stored_bytes; /* Compressed size of the rest. */
+static long long rejects;      /* Pages turned down. */
+
+/* Initializes compressed swap, with room for ZSWAP_POOL_PAGES
+   pages of compressed data.  If that is 0, or memory is short,
+   every zswap_store() fails. */
+void zswap_init(void) {
+  size_t slot_cnt = zswap_pool_pages * SLOTS_PER_PAGE;
+
+  list_init(&unbuddied);
+  lock_init(&zswap_lock);
+  if (slot_cnt == 0)
+    return;
+  entries = calloc_tagged(slot_cnt, sizeof *entries, MT_VM);
+  used_slots = bitmap_create(slot_cnt);
+  if (entries == NULL || used_slots == NULL) {
+    printf("zswap: out of memory, compressed swap disabled\n");
+    free(entries);
+    entries = NULL;
+    if (used_slots != NULL)
+      bitmap_destroy(used_slots);
+    used_slots = NULL;
+  }
+}
+
+/* Returns the number of slots, 0 if compressed swap is off. */
+size_t zswap_slot_cnt(void) { return used_slots != NULL ? bitmap_size(used_slots) : 0; }
+
+/* Returns true if KPAGE is all zeros. */
+static bool is_zero(const void* kpage) {
+  const uint32_t* p = kpage;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+/* Finds room for LEN bytes in the pool, adding a page to it if
+   need be, and points E at it.  Returns false if the pool is
+   full.  ZSWAP_LOCK must be held. */
+static bool place(struct zentry* e, size_t len) {
+  struct list_elem* el;
+  struct zpage* zp;
+
+  for (el = list_begin(&unbuddied); el != list_end(&unbuddied); el = list_next(el)) {
+    zp = list_entry(el, struct zpage, elem);
+    if (zp->first_len + zp->last_len + len <= PGSIZE) {
+      list_remove(&zp->elem);
+      e->zp = zp;
+      e->last = zp->last_len == 0;
+      if (e->last)
+        zp->last_len = len;
+      else
+        zp->first_len = len;
+      return true;
+    }
+  }
+
+  if (pool_cnt >= zswap_pool_pages)
+    return false;
+  zp = malloc_tagged(sizeof *zp, MT_VM);
+  if (zp == NULL)
+    return false;
+  zp->kpage = palloc_get_page(PAL_TAG(MT_VM));
+  if (zp->kpage == NULL) {
+    free(zp);
+    return false;
+  }
+  zp->first_len = len;
+  zp->last_len = 0;
+  list_push_back(&unbuddied, &zp->elem);
+  pool_cnt++;
+  e->zp = zp;
+  e->last = false;
+  return true;
+}
+
+/* Returns the address of E's compressed data. */
+static uint8_t* data(const struct zentry* e) {
+  return e->zp->kpage + (e->last ? PGSIZE - e->len : 0);
+}
+
+/* Compresses KPAGE into a free slot and stores the slot in
+   *SLOT.  Returns false, storing nothing, if compressed swap is
+   off or full or KPAGE does not compress well enough to be worth
+   keeping. */
+bool zswap_store(const void* kpage, size_t* slot) {
+  struct zentry* e;
+  size_t len;
+  bool success = false;
+
+  if (used_slots == NULL)
+    return false;
+
+  lock_acquire(&zswap_lock);
+  *slot = bitmap_scan_and_flip(used_slots, cursor, 1, false);
+  if (*slot == BITMAP_ERROR)
+    *slot = bitmap_scan_and_flip(used_slots, 0, 1, false);
+  if (*slot != BITMAP_ERROR) {
+    cursor = *slot + 1 < bitmap_size(used_slots) ? *slot + 1 : 0;
+    e = &entries[*slot];
+    if (is_zero(kpage)) {
+      e->zp = NULL;
+      e->len = 0;
+      zero_stores++;
+      success = true;
+    } else {
+      len = lzf_compress(kpage, PGSIZE, buffer, sizeof buffer, htab);
+      if (len != 0 && place(e, len)) {
+        e->len = len;
+        memcpy(data(e), buffer, len);
+        stored_bytes += len;
+        success = true;
+      }
+    }
+    if (!success)
+      bitmap_reset(used_slots, *slot);
+  }
+  if (success)
+    stores++;
+  else
+    rejects++;
+  lock_release(&zswap_lock);
+  return success;
+}
+
+/* Decompresses the page in SLOT into KPAGE.  SLOT stays in
+   use. */
+void zswap_load(size_t slot, void* kpage) {
+  struct zentry* e = &entries[slot];
+
+  lock_acquire(&zswap_lock);
+  ASSERT(bitmap_test(used_slots, slot));
+  if (e->zp == NULL)
+    memset(kpage, 0, PGSIZE);
+  else if (lzf_decompress(data(e), e->len, kpage, PGSIZE) != PGSIZE)
+    PANIC("zswap: slot %zu is corrupt", slot);
+  lock_release(&zswap_lock);
+}
+
+/* Frees SLOT and the pool space it takes. */
+void zswap_free(size_t slot) {
+  struct zentry* e = &entries[slot];
+  struct zpage* zp;
+
+  lock_acquire(&zswap_lock);
+  ASSERT(bitmap_test(used_slots, slot));
+  bitmap_reset(used_slots, slot);
+  zp = e->zp;
+  if (zp != NULL) {
+    bool was_full = zp->first_len != 0 && zp->last_len != 0;
+
+    if (e->last)
+      zp->last_len = 0;
+    else
+      zp->first_len = 0;
+    if (was_full)
+      list_push_back(&unbuddied, &zp->elem);
+    else {
+      list_remove(&zp->elem);
+      palloc_free_page(zp->kpage);
+      free(zp);
+      pool_cnt--;
+    }
+  }
+  lock_release(&zswap_lock);
+}
+
+/* Fills in the compressed swap members of *ST. */
+void zswap_get_stats(struct swapstat* st) {
+  lock_acquire(&zswap_lock);
+  st->zswap_stores = stores;
+  st->zswap_zero_stores = zero_stores;
+  st->zswap_bytes = stored_bytes;
+  lock_release(&zswap_lock);
+}
+
+/* Prints compressed swap statistics. */
+void zswap_print_stats(void) {
+  long long compressed = stores - zero_stores;
+
+  printf("Zswap: %lld pages stored (%lld of zeros), %lld turned down, "
+         "%lld kB compressed to %lld kB (%lld%%), %zu of %zu pool pages in use\n",
+         stores, zero_stores, rejects, compressed * PGSIZE / 1024, stored_bytes / 1024,
+         compressed > 0 ? stored_bytes * 100 / (compressed * PGSIZE) : 0, pool_cnt,
+         zswap_pool_pages);
+}
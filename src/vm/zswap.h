@@ -0,0 +1,21 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <memstat.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Default for zswap_pool_pages. */
+#define ZSWAP_POOL_DEFAULT 64
+
+extern size_t zswap_pool_pages;
+
+void zswap_init(void);
+size_t zswap_slot_cnt(void);
+bool zswap_store(const void* kpage, size_t* slot);
+void zswap_load(size_t slot, void* kpage);
+void zswap_free(size_t slot);
+void zswap_get_stats(struct swapstat*);
+void zswap_print_stats(void);
+
+#endif /* vm/zswap.h */